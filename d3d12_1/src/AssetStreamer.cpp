@@ -0,0 +1,357 @@
+#include "AssetStreamer.h"
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+
+// Sources
+MappedFileSource::MappedFileSource(std::string rootDirectory)
+	:
+	rootDirectory(std::move(rootDirectory))
+{}
+
+MappedFile MappedFileSource::Open(const std::string& path)
+{
+	if (rootDirectory.empty())
+	{
+		return MappedFile(path);
+	}
+	return MappedFile((std::filesystem::path(rootDirectory) / path).string());
+}
+
+ThrottledSource::ThrottledSource(AssetSource& inner, std::chrono::microseconds latency, std::size_t bytesPerSecond)
+	:
+	inner(inner),
+	latency(latency),
+	bytesPerSecond(bytesPerSecond)
+{}
+
+MappedFile ThrottledSource::Open(const std::string& path)
+{
+	MappedFile file = inner.Open(path);
+	auto delay = latency;
+	if (bytesPerSecond > 0u)
+	{
+		delay += std::chrono::microseconds(static_cast<std::int64_t>(static_cast<double>(file.GetSize()) * 1e6 / static_cast<double>(bytesPerSecond)));
+	}
+	std::this_thread::sleep_for(delay);
+	return file;
+}
+
+// Asset handle stuff
+AssetHandle::AssetHandle(Slot* pSlot) noexcept
+	:
+	pSlot(pSlot)
+{
+	pSlot->refCount.fetch_add(1u, std::memory_order_relaxed);
+}
+
+AssetHandle::AssetHandle(const AssetHandle& src) noexcept
+	:
+	pSlot(src.pSlot)
+{
+	if (pSlot)
+	{
+		pSlot->refCount.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+AssetHandle::AssetHandle(AssetHandle&& donor) noexcept
+	:
+	pSlot(std::exchange(donor.pSlot, nullptr))
+{}
+
+AssetHandle& AssetHandle::operator=(AssetHandle rhs) noexcept
+{
+	std::swap(pSlot, rhs.pSlot);
+	return *this;
+}
+
+AssetHandle::~AssetHandle()
+{
+	Release();
+}
+
+bool AssetHandle::IsValid() const noexcept
+{
+	return pSlot != nullptr;
+}
+
+AssetState AssetHandle::GetState() const noexcept
+{
+	assert(pSlot);
+	return pSlot->state.load(std::memory_order_acquire);
+}
+
+bool AssetHandle::IsReady() const noexcept
+{
+	return pSlot && GetState() == AssetState::Ready;
+}
+
+std::span<const std::byte> AssetHandle::GetBytes() const noexcept
+{
+	assert(IsReady());
+	return pSlot->file.GetBytes();
+}
+
+const std::string& AssetHandle::GetPath() const noexcept
+{
+	assert(pSlot);
+	return pSlot->path;
+}
+
+void AssetHandle::Release() noexcept
+{
+	if (pSlot)
+	{
+		// Stamp the time LRU eviction orders by before letting go: once the count hits 0, Update() may free the
+		// slot, so the decrement has to be the last touch. Every release stamps; the last one's time is what sticks.
+		pSlot->releasedAt.store(pSlot->clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		pSlot->refCount.fetch_sub(1u, std::memory_order_acq_rel);
+	}
+	pSlot = nullptr;
+}
+
+// Asset streamer stuff
+bool AssetStreamer::QueueOrder::operator()(const Slot* pLhs, const Slot* pRhs) const noexcept
+{
+	if (pLhs->priority != pRhs->priority)
+	{
+		return pLhs->priority > pRhs->priority;
+	}
+	return pLhs->sequence < pRhs->sequence;
+}
+
+AssetStreamer::AssetStreamer(AssetSource& source, std::size_t budgetBytes, unsigned int ioThreadCount)
+	:
+	source(source),
+	budgetBytes(budgetBytes)
+{
+	ioThreadCount = std::max(ioThreadCount, 1u);
+	ioThreads.reserve(ioThreadCount);
+	for (unsigned int i = 0u; i < ioThreadCount; i++)
+	{
+		ioThreads.emplace_back(&AssetStreamer::IoLoop, this);
+	}
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (auto& thread : ioThreads)
+	{
+		thread.join();
+	}
+	for ([[maybe_unused]] const auto& [path, pSlot] : slots)
+	{
+		assert(pSlot->refCount.load() == 0u && "asset handle outlived the streamer");
+	}
+}
+
+AssetHandle AssetStreamer::Request(const std::string& path, int priority)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	counters.requests++;
+	auto& pSlot = slots[path];
+	if (!pSlot)
+	{
+		pSlot = std::make_unique<Slot>(path, clock);
+		pSlot->priority = priority;
+		Enqueue(*pSlot);
+	}
+	else
+	{
+		Slot& slot = *pSlot;
+		switch (slot.state.load(std::memory_order_relaxed))
+		{
+		case AssetState::Queued:
+			if (priority > slot.priority)
+			{
+				queue.erase(&slot);
+				slot.priority = priority;
+				queue.insert(&slot);
+			}
+			break;
+		case AssetState::Loading:
+			// Wanted again before the cancelled read finished, so keep the result after all
+			slot.cancelRequested = false;
+			break;
+		case AssetState::Failed:
+		case AssetState::Cancelled:
+			slot.priority = priority;
+			Enqueue(slot);
+			break;
+		case AssetState::Ready:
+			break;
+		}
+	}
+	AssetHandle handle(pSlot.get());
+	lock.unlock();
+	workAvailable.notify_one();
+	return handle;
+}
+
+void AssetStreamer::SetPriority(const AssetHandle& handle, int priority)
+{
+	assert(handle.IsValid());
+	std::lock_guard<std::mutex> lock(mutex);
+	Slot& slot = *handle.pSlot;
+	if (slot.inQueue && slot.priority != priority)
+	{
+		// The set is ordered by priority, so it has to come out to change it
+		queue.erase(&slot);
+		slot.priority = priority;
+		queue.insert(&slot);
+	}
+}
+
+void AssetStreamer::Cancel(const AssetHandle& handle)
+{
+	assert(handle.IsValid());
+	std::lock_guard<std::mutex> lock(mutex);
+	Slot& slot = *handle.pSlot;
+	if (slot.inQueue)
+	{
+		queue.erase(&slot);
+		slot.inQueue = false;
+		slot.state.store(AssetState::Cancelled, std::memory_order_release);
+		counters.cancelled++;
+	}
+	else if (slot.state.load(std::memory_order_relaxed) == AssetState::Loading)
+	{
+		// Can't interrupt the read; the I/O thread drops the result when it's done
+		slot.cancelRequested = true;
+	}
+}
+
+void AssetStreamer::Update()
+{
+	clock.fetch_add(1u, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(mutex);
+	// Nothing can hand out a new reference to a slot at refCount 0 without this mutex, so these checks are stable
+	std::vector<Slot*> evictable;
+	for (auto it = slots.begin(); it != slots.end();)
+	{
+		Slot& slot = *it->second;
+		const AssetState state = slot.state.load(std::memory_order_relaxed);
+		if (slot.refCount.load(std::memory_order_acquire) == 0u)
+		{
+			if (state == AssetState::Failed || state == AssetState::Cancelled)
+			{
+				it = slots.erase(it);
+				continue;
+			}
+			if (state == AssetState::Ready)
+			{
+				evictable.push_back(&slot);
+			}
+		}
+		++it;
+	}
+	if (residentBytes <= budgetBytes)
+	{
+		return;
+	}
+	std::sort(evictable.begin(), evictable.end(), [](const Slot* pLhs, const Slot* pRhs)
+	{
+		return pLhs->releasedAt.load(std::memory_order_relaxed) < pRhs->releasedAt.load(std::memory_order_relaxed);
+	});
+	for (Slot* pSlot : evictable)
+	{
+		if (residentBytes <= budgetBytes)
+		{
+			break;
+		}
+		residentBytes -= pSlot->file.GetSize();
+		counters.evicted++;
+		// Copy the key, erasing destroys the slot it lives in
+		const std::string path = pSlot->path;
+		slots.erase(path);
+	}
+}
+
+void AssetStreamer::SetBudget(std::size_t budget)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	budgetBytes = budget;
+}
+
+AssetStreamer::Stats AssetStreamer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats stats = counters;
+	stats.queued = queue.size();
+	stats.residentBytes = residentBytes;
+	stats.budgetBytes = budgetBytes;
+	stats.resident = static_cast<std::size_t>(std::count_if(slots.begin(), slots.end(), [](const auto& entry)
+	{
+		return entry.second->state.load(std::memory_order_relaxed) == AssetState::Ready;
+	}));
+	return stats;
+}
+
+void AssetStreamer::Enqueue(Slot& slot)
+{
+	slot.sequence = nextSequence++;
+	slot.cancelRequested = false;
+	slot.inQueue = true;
+	slot.state.store(AssetState::Queued, std::memory_order_release);
+	queue.insert(&slot);
+}
+
+void AssetStreamer::IoLoop()
+{
+	for (;;)
+	{
+		Slot* pSlot = nullptr;
+		std::string path;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			pSlot = *queue.begin();
+			queue.erase(queue.begin());
+			pSlot->inQueue = false;
+			pSlot->state.store(AssetState::Loading, std::memory_order_release);
+			path = pSlot->path;
+		}
+		// A Loading slot is never erased, so pSlot stays valid without the lock
+		MappedFile file;
+		bool succeeded = true;
+		try
+		{
+			file = source.Open(path);
+		}
+		catch (const std::exception&)
+		{
+			succeeded = false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pSlot->cancelRequested)
+		{
+			pSlot->cancelRequested = false;
+			pSlot->state.store(AssetState::Cancelled, std::memory_order_release);
+			counters.cancelled++;
+		}
+		else if (succeeded)
+		{
+			residentBytes += file.GetSize();
+			counters.loaded++;
+			counters.bytesLoaded += file.GetSize();
+			pSlot->file = std::move(file);
+			// Release pairs with the acquire in AssetHandle::GetState, publishing file to the polling thread
+			pSlot->state.store(AssetState::Ready, std::memory_order_release);
+		}
+		else
+		{
+			pSlot->state.store(AssetState::Failed, std::memory_order_release);
+			counters.failed++;
+		}
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Where the streamer gets bytes from. Open() runs on I/O threads, so
+* implementations must be thread safe; failures are reported by throwing.
+*/
+class AssetSource
+{
+public:
+	virtual ~AssetSource() = default;
+	virtual MappedFile Open(const std::string& path) = 0;
+};
+
+// Files under a root directory, memory mapped
+class MappedFileSource : public AssetSource
+{
+public:
+	explicit MappedFileSource(std::string rootDirectory = {});
+	MappedFile Open(const std::string& path) override;
+private:
+	std::string rootDirectory;
+};
+
+// Wraps another source and makes it slow, to exercise streaming without a slow disk
+class ThrottledSource : public AssetSource
+{
+public:
+	ThrottledSource(AssetSource& inner, std::chrono::microseconds latency, std::size_t bytesPerSecond);
+	MappedFile Open(const std::string& path) override;
+private:
+	AssetSource& inner;
+	std::chrono::microseconds latency;
+	std::size_t bytesPerSecond;
+};
+
+enum class AssetState : std::uint8_t
+{
+	Queued,
+	Loading,
+	Ready,
+	Failed,
+	Cancelled
+};
+
+class AssetStreamer;
+
+/* Ref-counted reference to a streamed asset.
+* Polling (GetState/IsReady/GetBytes) is a single atomic load, safe to do
+* every frame from the game thread. Once Ready, the bytes stay valid for
+* as long as any handle to the asset exists. Handles must not outlive the
+* streamer.
+*/
+class AssetHandle
+{
+	friend class AssetStreamer;
+public:
+	AssetHandle() = default;
+	AssetHandle(const AssetHandle& src) noexcept;
+	AssetHandle(AssetHandle&& donor) noexcept;
+	AssetHandle& operator=(AssetHandle rhs) noexcept;
+	~AssetHandle();
+	bool IsValid() const noexcept;
+	AssetState GetState() const noexcept;
+	bool IsReady() const noexcept;
+	// Only valid once IsReady() has returned true
+	std::span<const std::byte> GetBytes() const noexcept;
+	const std::string& GetPath() const noexcept;
+private:
+	struct Slot;
+	explicit AssetHandle(Slot* pSlot) noexcept;
+	void Release() noexcept;
+private:
+	Slot* pSlot = nullptr;
+};
+
+/* Background asset loading with priorities, cancellation and a memory budget.
+* Requests for the same path share one asset. Queued requests are served
+* highest priority first (FIFO within a priority) by a few dedicated I/O
+* threads, and their priority can be changed until they start loading.
+*
+* Assets nobody holds a handle to stay resident as a cache until Update()
+* finds the resident total over budget, then the least recently released
+* ones are evicted. Referenced assets are never evicted, so the budget can
+* be exceeded if the game holds on to too much; GetStats() says so.
+*
+* Request/SetPriority/Cancel/Update are meant for the game thread.
+*/
+class AssetStreamer
+{
+public:
+	struct Stats
+	{
+		std::size_t requests = 0u;
+		std::size_t loaded = 0u;
+		std::size_t failed = 0u;
+		std::size_t cancelled = 0u;
+		std::size_t evicted = 0u;
+		std::size_t queued = 0u;
+		std::size_t resident = 0u;
+		std::size_t residentBytes = 0u;
+		std::size_t budgetBytes = 0u;
+		std::uint64_t bytesLoaded = 0u;
+	};
+public:
+	AssetStreamer(AssetSource& source, std::size_t budgetBytes, unsigned int ioThreadCount = 2u);
+	~AssetStreamer();
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+	// Higher priority loads first. Re-requesting a queued asset raises its priority if the new one is higher.
+	AssetHandle Request(const std::string& path, int priority = 0);
+	// No effect unless the asset is still queued
+	void SetPriority(const AssetHandle& handle, int priority);
+	// Cancels a queued or in-flight load for every holder of the asset; loaded assets are unaffected
+	void Cancel(const AssetHandle& handle);
+	// Once per frame: enforces the budget and forgets assets that are unreferenced and not resident
+	void Update();
+	void SetBudget(std::size_t budgetBytes);
+	Stats GetStats() const;
+private:
+	using Slot = AssetHandle::Slot;
+	// (priority, sequence) ordered highest priority, then oldest, first
+	struct QueueOrder
+	{
+		bool operator()(const Slot* pLhs, const Slot* pRhs) const noexcept;
+	};
+	void IoLoop();
+	void Enqueue(Slot& slot);
+private:
+	AssetSource& source;
+	mutable std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::unordered_map<std::string, std::unique_ptr<Slot>> slots;
+	std::set<Slot*, QueueOrder> queue;
+	std::uint64_t nextSequence = 0u;
+	// Advanced by Update(); stamps when an asset lost its last handle, for LRU
+	std::atomic<std::uint64_t> clock{ 0u };
+	std::size_t budgetBytes;
+	std::size_t residentBytes = 0u;
+	Stats counters;
+	bool stopping = false;
+	std::vector<std::thread> ioThreads;
+};
+
+struct AssetHandle::Slot
+{
+	Slot(std::string path, const std::atomic<std::uint64_t>& clock)
+		:
+		path(std::move(path)),
+		clock(clock)
+	{}
+	const std::string path;
+	const std::atomic<std::uint64_t>& clock;
+	std::atomic<AssetState> state{ AssetState::Queued };
+	std::atomic<std::uint32_t> refCount{ 0u };
+	std::atomic<std::uint64_t> releasedAt{ 0u };
+	// Everything below is guarded by the streamer's mutex, except file which is read-only once state is Ready
+	MappedFile file;
+	int priority = 0;
+	std::uint64_t sequence = 0u;
+	bool cancelRequested = false;
+	bool inQueue = false;
+};
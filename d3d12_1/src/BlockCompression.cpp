@@ -0,0 +1,278 @@
+#include "BlockCompression.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr std::uint16_t To565(int r, int g, int b) noexcept
+	{
+		return static_cast<std::uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+	}
+
+	// Replicates the top bits into the bottom ones, the same way hardware decoders expand
+	constexpr void Expand565(std::uint16_t c, int* pRgb) noexcept
+	{
+		const int r = c >> 11;
+		const int g = (c >> 5) & 0x3F;
+		const int b = c & 0x1F;
+		pRgb[0] = (r << 3) | (r >> 2);
+		pRgb[1] = (g << 2) | (g >> 4);
+		pRgb[2] = (b << 3) | (b >> 2);
+	}
+
+	void PutU16(std::uint8_t* pDest, std::uint16_t value) noexcept
+	{
+		pDest[0] = static_cast<std::uint8_t>(value);
+		pDest[1] = static_cast<std::uint8_t>(value >> 8);
+	}
+
+	std::uint16_t GetU16(const std::uint8_t* pSrc) noexcept
+	{
+		return static_cast<std::uint16_t>(pSrc[0] | pSrc[1] << 8);
+	}
+
+	// Palette for a color block; entry 3 is transparent black in 3-color mode
+	void BuildColorPalette(std::uint16_t c0, std::uint16_t c1, bool fourColor, int (*pPalette)[4]) noexcept
+	{
+		Expand565(c0, pPalette[0]);
+		Expand565(c1, pPalette[1]);
+		pPalette[0][3] = 255;
+		pPalette[1][3] = 255;
+		for (int k = 0; k < 3; k++)
+		{
+			if (fourColor)
+			{
+				pPalette[2][k] = (2 * pPalette[0][k] + pPalette[1][k]) / 3;
+				pPalette[3][k] = (pPalette[0][k] + 2 * pPalette[1][k]) / 3;
+			}
+			else
+			{
+				pPalette[2][k] = (pPalette[0][k] + pPalette[1][k]) / 2;
+				pPalette[3][k] = 0;
+			}
+		}
+		pPalette[2][3] = 255;
+		pPalette[3][3] = fourColor ? 255 : 0;
+	}
+
+	// The 8 byte color half shared by BC1 and BC3
+	void EncodeColorBlock(const std::uint8_t* pRgba, std::uint8_t* pBlock, bool allowAlpha) noexcept
+	{
+		unsigned int transparentMask = 0u;
+		int minColor[3] = { 255, 255, 255 };
+		int maxColor[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			const std::uint8_t* pPixel = pRgba + i * 4;
+			if (allowAlpha && pPixel[3] < 128u)
+			{
+				transparentMask |= 1u << i;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				minColor[k] = std::min<int>(minColor[k], pPixel[k]);
+				maxColor[k] = std::max<int>(maxColor[k], pPixel[k]);
+			}
+		}
+		if (transparentMask == 0xFFFFu)
+		{
+			// c0 <= c1 selects 3-color mode, index 3 is transparent
+			PutU16(pBlock, 0u);
+			PutU16(pBlock + 2, 0u);
+			pBlock[4] = pBlock[5] = pBlock[6] = pBlock[7] = 0xFFu;
+			return;
+		}
+		// Pull the endpoints in by 1/16 of the range; the extremes are rarely where the error is worst
+		for (int k = 0; k < 3; k++)
+		{
+			const int inset = (maxColor[k] - minColor[k]) >> 4;
+			minColor[k] += inset;
+			maxColor[k] -= inset;
+		}
+		// The box's min -> max corner only follows the colors when every channel rises together; a channel
+		// that falls while the widest one rises needs its ends swapped, or a red -> green ramp turns into
+		// black -> yellow
+		int axis = 0;
+		for (int k = 1; k < 3; k++)
+		{
+			if (maxColor[k] - minColor[k] > maxColor[axis] - minColor[axis])
+			{
+				axis = k;
+			}
+		}
+		int covariance[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			const std::uint8_t* pPixel = pRgba + i * 4;
+			if (!(transparentMask & (1u << i)))
+			{
+				const int d = 2 * pPixel[axis] - minColor[axis] - maxColor[axis];
+				for (int k = 0; k < 3; k++)
+				{
+					covariance[k] += d * (2 * pPixel[k] - minColor[k] - maxColor[k]);
+				}
+			}
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			if (covariance[k] < 0)
+			{
+				std::swap(minColor[k], maxColor[k]);
+			}
+		}
+		std::uint16_t c0 = To565(maxColor[0], maxColor[1], maxColor[2]);
+		std::uint16_t c1 = To565(minColor[0], minColor[1], minColor[2]);
+		// The endpoint order picks the mode: c0 > c1 is 4-color, otherwise 3-color + transparent
+		const bool fourColor = transparentMask == 0u;
+		if (fourColor ? c0 < c1 : c0 > c1)
+		{
+			std::swap(c0, c1);
+		}
+		int palette[4][4];
+		BuildColorPalette(c0, c1, fourColor && c0 != c1, palette);
+		std::uint32_t indices = 0u;
+		if (c0 != c1 || !fourColor)
+		{
+			const int candidates = fourColor ? 4 : 3;
+			for (int i = 0; i < 16; i++)
+			{
+				unsigned int best = 3u;
+				if (!(transparentMask & (1u << i)))
+				{
+					const std::uint8_t* pPixel = pRgba + i * 4;
+					int bestDistance = 1 << 30;
+					for (int p = 0; p < candidates; p++)
+					{
+						int distance = 0;
+						for (int k = 0; k < 3; k++)
+						{
+							const int d = pPixel[k] - palette[p][k];
+							distance += d * d;
+						}
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							best = static_cast<unsigned int>(p);
+						}
+					}
+				}
+				indices |= best << (i * 2);
+			}
+		}
+		PutU16(pBlock, c0);
+		PutU16(pBlock + 2, c1);
+		for (int b = 0; b < 4; b++)
+		{
+			pBlock[4 + b] = static_cast<std::uint8_t>(indices >> (b * 8));
+		}
+	}
+
+	// Interpolated alpha palette for a0 > a1 (the 8 value mode)
+	void BuildAlphaPalette(int a0, int a1, int* pPalette) noexcept
+	{
+		pPalette[0] = a0;
+		pPalette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; i++)
+			{
+				pPalette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+			{
+				pPalette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			}
+			pPalette[6] = 0;
+			pPalette[7] = 255;
+		}
+	}
+}
+
+void EncodeBc1Block(const std::uint8_t* pRgba, std::uint8_t* pBlock, bool allowAlpha) noexcept
+{
+	EncodeColorBlock(pRgba, pBlock, allowAlpha);
+}
+
+void EncodeBc3Block(const std::uint8_t* pRgba, std::uint8_t* pBlock) noexcept
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minAlpha = std::min<int>(minAlpha, pRgba[i * 4 + 3]);
+		maxAlpha = std::max<int>(maxAlpha, pRgba[i * 4 + 3]);
+	}
+	pBlock[0] = static_cast<std::uint8_t>(maxAlpha);
+	pBlock[1] = static_cast<std::uint8_t>(minAlpha);
+	std::uint64_t indices = 0u;
+	if (maxAlpha != minAlpha)
+	{
+		int palette[8];
+		BuildAlphaPalette(maxAlpha, minAlpha, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			const int alpha = pRgba[i * 4 + 3];
+			std::uint64_t best = 0u;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				const int distance = alpha > palette[p] ? alpha - palette[p] : palette[p] - alpha;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = static_cast<std::uint64_t>(p);
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+	for (int b = 0; b < 6; b++)
+	{
+		pBlock[2 + b] = static_cast<std::uint8_t>(indices >> (b * 8));
+	}
+	// BC3's color half is always decoded as 4-color, so no punch-through alpha
+	EncodeColorBlock(pRgba, pBlock + 8, false);
+}
+
+void DecodeBc1Block(const std::uint8_t* pBlock, std::uint8_t* pRgba) noexcept
+{
+	const std::uint16_t c0 = GetU16(pBlock);
+	const std::uint16_t c1 = GetU16(pBlock + 2);
+	int palette[4][4];
+	BuildColorPalette(c0, c1, c0 > c1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		const int index = (pBlock[4 + i / 4] >> ((i % 4) * 2)) & 3;
+		for (int k = 0; k < 4; k++)
+		{
+			pRgba[i * 4 + k] = static_cast<std::uint8_t>(palette[index][k]);
+		}
+	}
+}
+
+void DecodeBc3Block(const std::uint8_t* pBlock, std::uint8_t* pRgba) noexcept
+{
+	const std::uint16_t c0 = GetU16(pBlock + 8);
+	const std::uint16_t c1 = GetU16(pBlock + 10);
+	int colors[4][4];
+	BuildColorPalette(c0, c1, true, colors);
+	int alphas[8];
+	BuildAlphaPalette(pBlock[0], pBlock[1], alphas);
+	std::uint64_t alphaIndices = 0u;
+	for (int b = 0; b < 6; b++)
+	{
+		alphaIndices |= std::uint64_t(pBlock[2 + b]) << (b * 8);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		const int index = (pBlock[12 + i / 4] >> ((i % 4) * 2)) & 3;
+		for (int k = 0; k < 3; k++)
+		{
+			pRgba[i * 4 + k] = static_cast<std::uint8_t>(colors[index][k]);
+		}
+		pRgba[i * 4 + 3] = static_cast<std::uint8_t>(alphas[(alphaIndices >> (i * 3)) & 7u]);
+	}
+}
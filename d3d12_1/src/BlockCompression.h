@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+/* BC1 / BC3 (DXT1 / DXT5) block encoders.
+* Input is a 4x4 block of RGBA8 pixels, row major (64 bytes). Endpoints
+* come from the block's color bounding box, inset a little to cut down on
+* the error at the extremes, which is the usual fast real-time approach.
+* Quality is below an exhaustive offline compressor, but it's quick enough
+* to run at load time.
+*/
+
+constexpr unsigned int bc1BlockSize = 8u;
+constexpr unsigned int bc3BlockSize = 16u;
+
+// Pixels with alpha < 128 become transparent (3-color mode) when allowAlpha is set
+void EncodeBc1Block(const std::uint8_t* pRgba, std::uint8_t* pBlock, bool allowAlpha = true) noexcept;
+void EncodeBc3Block(const std::uint8_t* pRgba, std::uint8_t* pBlock) noexcept;
+// Mostly for checking the encoders; writes 16 RGBA8 pixels
+void DecodeBc1Block(const std::uint8_t* pBlock, std::uint8_t* pRgba) noexcept;
+void DecodeBc3Block(const std::uint8_t* pBlock, std::uint8_t* pRgba) noexcept;
@@ -0,0 +1,469 @@
+#include "CommandList.h"
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+// Command allocator stuff
+CommandAllocator::CommandAllocator(std::size_t pageSize)
+	:
+	pageSize(pageSize)
+{}
+
+void CommandAllocator::Reset() noexcept
+{
+	// Keep the pages around, they're handed out again in the same order
+	pagesInUse = 0u;
+	bytesUsed = 0u;
+}
+
+std::size_t CommandAllocator::GetPageCount() const noexcept
+{
+	return pages.size();
+}
+
+std::size_t CommandAllocator::GetBytesUsed() const noexcept
+{
+	return bytesUsed;
+}
+
+std::byte* CommandAllocator::AcquirePage()
+{
+	if (pagesInUse == pages.size())
+	{
+		pages.push_back(std::make_unique<std::byte[]>(pageSize));
+	}
+	return pages[pagesInUse++].get();
+}
+
+std::size_t CommandAllocator::GetPageSize() const noexcept
+{
+	return pageSize;
+}
+
+// Command list stuff
+CommandList::Iterator::Iterator(const std::vector<Span>& spans, std::size_t spanIndex) noexcept
+	:
+	pSpans(&spans),
+	spanIndex(spanIndex)
+{
+	SkipEmptySpans();
+}
+
+const CommandHeader& CommandList::Iterator::operator*() const noexcept
+{
+	return *reinterpret_cast<const CommandHeader*>((*pSpans)[spanIndex].pData + offset);
+}
+
+CommandList::Iterator& CommandList::Iterator::operator++() noexcept
+{
+	offset += (**this).size;
+	if (offset >= (*pSpans)[spanIndex].size)
+	{
+		spanIndex++;
+		offset = 0u;
+		SkipEmptySpans();
+	}
+	return *this;
+}
+
+bool CommandList::Iterator::operator!=(const Iterator& rhs) const noexcept
+{
+	return spanIndex != rhs.spanIndex || offset != rhs.offset;
+}
+
+const std::byte* CommandList::Iterator::GetPayload() const noexcept
+{
+	return (*pSpans)[spanIndex].pData + offset + payloadOffset;
+}
+
+void CommandList::Iterator::SkipEmptySpans() noexcept
+{
+	while (spanIndex < pSpans->size() && (*pSpans)[spanIndex].size == 0u)
+	{
+		spanIndex++;
+	}
+}
+
+void CommandList::Reset(CommandAllocator& alloc) noexcept
+{
+	pAllocator = &alloc;
+	spans.clear();
+	pCursor = nullptr;
+	pPageEnd = nullptr;
+	commandCount = 0u;
+	byteSize = 0u;
+	closed = false;
+}
+
+void CommandList::Close() noexcept
+{
+	assert(!closed && "command list closed twice");
+	closed = true;
+}
+
+bool CommandList::IsClosed() const noexcept
+{
+	return closed;
+}
+
+void CommandList::SetPipeline(PipelineId pipeline, PipelineKind kind)
+{
+	auto& cmd = Push<Commands::SetPipeline>();
+	cmd.pipeline = pipeline;
+	cmd.kind = kind;
+}
+
+void CommandList::SetVertexBuffer(std::uint32_t slot, ResourceId buffer, std::uint32_t offset, std::uint32_t stride)
+{
+	auto& cmd = Push<Commands::SetVertexBuffer>();
+	cmd.buffer = buffer;
+	cmd.slot = slot;
+	cmd.offset = offset;
+	cmd.stride = stride;
+}
+
+void CommandList::SetIndexBuffer(ResourceId buffer, std::uint32_t offset, bool is32Bit)
+{
+	auto& cmd = Push<Commands::SetIndexBuffer>();
+	cmd.buffer = buffer;
+	cmd.offset = offset;
+	cmd.is32Bit = is32Bit;
+}
+
+void CommandList::SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
+{
+	auto& cmd = Push<Commands::SetViewport>();
+	cmd.x = x;
+	cmd.y = y;
+	cmd.width = width;
+	cmd.height = height;
+	cmd.minDepth = minDepth;
+	cmd.maxDepth = maxDepth;
+}
+
+void CommandList::SetRootConstants(std::uint32_t rootIndex, const std::uint32_t* pValues, std::uint32_t count)
+{
+	if (count > Commands::SetRootConstants::maxCount)
+	{
+		throw CLEXCEPT("More than 64 root constants in one command");
+	}
+	auto& cmd = Push<Commands::SetRootConstants>(count * sizeof(std::uint32_t));
+	cmd.rootIndex = rootIndex;
+	cmd.count = count;
+	std::memcpy(&cmd + 1, pValues, count * sizeof(std::uint32_t));
+}
+
+void CommandList::Draw(std::uint32_t vertexCount, std::uint32_t instanceCount, std::uint32_t startVertex, std::uint32_t startInstance)
+{
+	auto& cmd = Push<Commands::Draw>();
+	cmd.vertexCount = vertexCount;
+	cmd.instanceCount = instanceCount;
+	cmd.startVertex = startVertex;
+	cmd.startInstance = startInstance;
+}
+
+void CommandList::DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex, std::uint32_t startInstance)
+{
+	auto& cmd = Push<Commands::DrawIndexed>();
+	cmd.indexCount = indexCount;
+	cmd.instanceCount = instanceCount;
+	cmd.startIndex = startIndex;
+	cmd.baseVertex = baseVertex;
+	cmd.startInstance = startInstance;
+}
+
+void CommandList::Dispatch(std::uint32_t groupsX, std::uint32_t groupsY, std::uint32_t groupsZ)
+{
+	auto& cmd = Push<Commands::Dispatch>();
+	cmd.groupsX = groupsX;
+	cmd.groupsY = groupsY;
+	cmd.groupsZ = groupsZ;
+}
+
+void CommandList::ResourceBarrier(ResourceId resource, ResourceState before, ResourceState after)
+{
+	auto& cmd = Push<Commands::Barrier>();
+	cmd.resource = resource;
+	cmd.before = before;
+	cmd.after = after;
+}
+
+CommandList::Iterator CommandList::begin() const noexcept
+{
+	return Iterator(spans, 0u);
+}
+
+CommandList::Iterator CommandList::end() const noexcept
+{
+	return Iterator(spans, spans.size());
+}
+
+std::size_t CommandList::GetCommandCount() const noexcept
+{
+	return commandCount;
+}
+
+std::size_t CommandList::GetByteSize() const noexcept
+{
+	return byteSize;
+}
+
+void* CommandList::Push(CommandType type, std::size_t payloadSize, std::size_t extraSize)
+{
+	assert(pAllocator != nullptr && "command list recorded without Reset()");
+	assert(!closed && "recording into a closed command list");
+	const std::size_t size = (payloadOffset + payloadSize + extraSize + commandAlignment - 1u) & ~(commandAlignment - 1u);
+	if (size > 0xFFFFu || size > pAllocator->GetPageSize())
+	{
+		throw CLEXCEPT("Command too large for a command allocator page");
+	}
+	// Commands never straddle pages, start a new one when this one is full
+	if (pCursor == nullptr || static_cast<std::size_t>(pPageEnd - pCursor) < size)
+	{
+		pCursor = pAllocator->AcquirePage();
+		pPageEnd = pCursor + pAllocator->GetPageSize();
+		spans.push_back({ pCursor, 0u });
+	}
+	CommandHeader* pHeader = reinterpret_cast<CommandHeader*>(pCursor);
+	pHeader->type = type;
+	pHeader->size = static_cast<std::uint16_t>(size);
+	void* pPayload = pCursor + payloadOffset;
+	pCursor += size;
+	spans.back().size += size;
+	byteSize += size;
+	pAllocator->bytesUsed += size;
+	commandCount++;
+	return pPayload;
+}
+
+// Command list exception stuff
+CommandList::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* CommandList::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* CommandList::Exception::GetType() const noexcept
+{
+	return "EggCeption: Command List Exception";
+}
+
+const std::string& CommandList::Exception::GetNote() const noexcept
+{
+	return note;
+}
+
+// Null executor stuff
+void NullExecutor::Execute(const CommandList& list)
+{
+	if (!list.IsClosed())
+	{
+		ReportError(0u, CommandType::SetPipeline, "command list executed before Close()");
+	}
+	// Per-list binding state
+	bool hasPipeline = false;
+	PipelineKind pipelineKind = PipelineKind::Graphics;
+	PipelineId pipeline = 0u;
+	bool hasIndexBuffer = false;
+	bool hasViewport = false;
+
+	std::size_t commandIndex = 0u;
+	for (auto it = list.begin(); it != list.end(); ++it, ++commandIndex)
+	{
+		const CommandHeader& header = *it;
+		stats.commandsExecuted++;
+		switch (header.type)
+		{
+			case CommandType::SetPipeline:
+			{
+				const auto& cmd = it.Get<Commands::SetPipeline>();
+				if (!hasPipeline || cmd.pipeline != pipeline || cmd.kind != pipelineKind)
+				{
+					stats.pipelineChanges++;
+				}
+				hasPipeline = true;
+				pipeline = cmd.pipeline;
+				pipelineKind = cmd.kind;
+			} break;
+			case CommandType::SetVertexBuffer:
+			{
+				const auto& cmd = it.Get<Commands::SetVertexBuffer>();
+				if (GetResourceState(cmd.buffer) != ResourceState::VertexBuffer)
+				{
+					ReportError(commandIndex, header.type, "vertex buffer not in VertexBuffer state");
+				}
+				if (cmd.stride == 0u)
+				{
+					ReportError(commandIndex, header.type, "vertex buffer stride is 0");
+				}
+			} break;
+			case CommandType::SetIndexBuffer:
+			{
+				const auto& cmd = it.Get<Commands::SetIndexBuffer>();
+				if (GetResourceState(cmd.buffer) != ResourceState::IndexBuffer)
+				{
+					ReportError(commandIndex, header.type, "index buffer not in IndexBuffer state");
+				}
+				if (cmd.offset % (cmd.is32Bit ? 4u : 2u) != 0u)
+				{
+					ReportError(commandIndex, header.type, "index buffer offset misaligned");
+				}
+				hasIndexBuffer = true;
+			} break;
+			case CommandType::SetViewport:
+			{
+				const auto& cmd = it.Get<Commands::SetViewport>();
+				if (!(cmd.width > 0.0f && cmd.height > 0.0f) || cmd.minDepth > cmd.maxDepth)
+				{
+					ReportError(commandIndex, header.type, "invalid viewport");
+				}
+				hasViewport = true;
+			} break;
+			case CommandType::SetRootConstants:
+			{
+				const auto& cmd = it.Get<Commands::SetRootConstants>();
+				if (!hasPipeline)
+				{
+					ReportError(commandIndex, header.type, "root constants set with no pipeline bound");
+				}
+				if (cmd.count == 0u)
+				{
+					ReportError(commandIndex, header.type, "empty root constants");
+				}
+				if (cmd.count > Commands::SetRootConstants::maxCount)
+				{
+					ReportError(commandIndex, header.type, "more than 64 root constants");
+				}
+			} break;
+			case CommandType::Draw:
+			case CommandType::DrawIndexed:
+			{
+				stats.draws++;
+				if (!hasPipeline || pipelineKind != PipelineKind::Graphics)
+				{
+					ReportError(commandIndex, header.type, "draw without a graphics pipeline");
+				}
+				if (!hasViewport)
+				{
+					ReportError(commandIndex, header.type, "draw without a viewport");
+				}
+				// No vertex buffer is fine: vertex pulling and fullscreen triangles draw from SV_VertexID alone
+				if (header.type == CommandType::DrawIndexed)
+				{
+					if (!hasIndexBuffer)
+					{
+						ReportError(commandIndex, header.type, "indexed draw without an index buffer");
+					}
+					if (it.Get<Commands::DrawIndexed>().instanceCount == 0u)
+					{
+						ReportError(commandIndex, header.type, "draw with 0 instances");
+					}
+				}
+				else if (it.Get<Commands::Draw>().instanceCount == 0u)
+				{
+					ReportError(commandIndex, header.type, "draw with 0 instances");
+				}
+			} break;
+			case CommandType::Dispatch:
+			{
+				stats.dispatches++;
+				const auto& cmd = it.Get<Commands::Dispatch>();
+				if (!hasPipeline || pipelineKind != PipelineKind::Compute)
+				{
+					ReportError(commandIndex, header.type, "dispatch without a compute pipeline");
+				}
+				if (cmd.groupsX == 0u || cmd.groupsY == 0u || cmd.groupsZ == 0u)
+				{
+					ReportError(commandIndex, header.type, "dispatch with 0 groups");
+				}
+			} break;
+			case CommandType::Barrier:
+			{
+				stats.barriers++;
+				const auto& cmd = it.Get<Commands::Barrier>();
+				if (cmd.before == cmd.after)
+				{
+					ReportError(commandIndex, header.type, "barrier with identical before/after states");
+				}
+				if (GetResourceState(cmd.resource) != cmd.before)
+				{
+					ReportError(commandIndex, header.type, "barrier 'before' state doesn't match tracked state");
+				}
+				SetResourceState(cmd.resource, cmd.after);
+			} break;
+			default:
+			{
+				ReportError(commandIndex, header.type, "unknown command");
+			} break;
+		}
+	}
+	stats.listsExecuted++;
+}
+
+void NullExecutor::SetResourceState(ResourceId resource, ResourceState state)
+{
+	if (state == ResourceState::Common)
+	{
+		resourceStates.erase(resource);
+	}
+	else
+	{
+		resourceStates[resource] = state;
+	}
+}
+
+ResourceState NullExecutor::GetResourceState(ResourceId resource) const noexcept
+{
+	const auto it = resourceStates.find(resource);
+	return it != resourceStates.end() ? it->second : ResourceState::Common;
+}
+
+const std::vector<NullExecutor::Error>& NullExecutor::GetErrors() const noexcept
+{
+	return errors;
+}
+
+const NullExecutor::Stats& NullExecutor::GetStats() const noexcept
+{
+	return stats;
+}
+
+void NullExecutor::ClearErrors() noexcept
+{
+	errors.clear();
+}
+
+void NullExecutor::ReportError(std::size_t commandIndex, CommandType type, const char* message)
+{
+	errors.push_back({ stats.listsExecuted, commandIndex, type, message });
+}
+
+// Command queue stuff
+CommandQueue::CommandQueue(CommandExecutor& executor) noexcept
+	:
+	executor(executor)
+{}
+
+void CommandQueue::ExecuteCommandLists(const CommandList* const* ppLists, std::size_t count)
+{
+	for (std::size_t i = 0u; i < count; i++)
+	{
+		executor.Execute(*ppLists[i]);
+	}
+	submittedLists += count;
+}
+
+std::size_t CommandQueue::GetSubmittedListCount() const noexcept
+{
+	return submittedLists;
+}
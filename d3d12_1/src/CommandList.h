@@ -0,0 +1,325 @@
+#pragma once
+
+#include "EggCeption.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/* D3D12-style command recording, independent of any graphics API.
+* A CommandList writes a compact, linear stream of POD commands into
+* memory owned by a CommandAllocator. Give every recording thread its own
+* allocator + list and nothing is shared while recording; submission order
+* is decided later by the order lists are handed to CommandQueue.
+*/
+
+// Opaque ids; the executor decides what they refer to
+using ResourceId = std::uint32_t;
+using PipelineId = std::uint32_t;
+
+enum class ResourceState : std::uint8_t
+{
+	Common,
+	VertexBuffer,
+	IndexBuffer,
+	RenderTarget,
+	DepthWrite,
+	ShaderResource,
+	UnorderedAccess,
+	CopySource,
+	CopyDest,
+	Present
+};
+
+enum class PipelineKind : std::uint8_t
+{
+	Graphics,
+	Compute
+};
+
+enum class CommandType : std::uint16_t
+{
+	SetPipeline,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetViewport,
+	SetRootConstants,
+	Draw,
+	DrawIndexed,
+	Dispatch,
+	Barrier
+};
+
+// Every command starts with this; size includes the header so the stream can be walked blind
+struct CommandHeader
+{
+	CommandType type;
+	std::uint16_t size;
+};
+
+namespace Commands
+{
+	struct SetPipeline
+	{
+		static constexpr CommandType type = CommandType::SetPipeline;
+		PipelineId pipeline;
+		PipelineKind kind;
+	};
+	struct SetVertexBuffer
+	{
+		static constexpr CommandType type = CommandType::SetVertexBuffer;
+		ResourceId buffer;
+		std::uint32_t slot;
+		std::uint32_t offset;
+		std::uint32_t stride;
+	};
+	struct SetIndexBuffer
+	{
+		static constexpr CommandType type = CommandType::SetIndexBuffer;
+		ResourceId buffer;
+		std::uint32_t offset;
+		bool is32Bit;
+	};
+	struct SetViewport
+	{
+		static constexpr CommandType type = CommandType::SetViewport;
+		float x, y, width, height;
+		float minDepth, maxDepth;
+	};
+	struct SetRootConstants
+	{
+		static constexpr CommandType type = CommandType::SetRootConstants;
+		static constexpr std::uint32_t maxCount = 64u;	// D3D12 root signature limit, in 32-bit values
+		std::uint32_t rootIndex;
+		std::uint32_t count;		// number of 32-bit values that follow this struct in the stream
+	};
+	struct Draw
+	{
+		static constexpr CommandType type = CommandType::Draw;
+		std::uint32_t vertexCount;
+		std::uint32_t instanceCount;
+		std::uint32_t startVertex;
+		std::uint32_t startInstance;
+	};
+	struct DrawIndexed
+	{
+		static constexpr CommandType type = CommandType::DrawIndexed;
+		std::uint32_t indexCount;
+		std::uint32_t instanceCount;
+		std::uint32_t startIndex;
+		std::int32_t baseVertex;
+		std::uint32_t startInstance;
+	};
+	struct Dispatch
+	{
+		static constexpr CommandType type = CommandType::Dispatch;
+		std::uint32_t groupsX, groupsY, groupsZ;
+	};
+	struct Barrier
+	{
+		static constexpr CommandType type = CommandType::Barrier;
+		ResourceId resource;
+		ResourceState before;
+		ResourceState after;
+	};
+}
+
+/* Backing memory for command lists, handed out in fixed-size pages.
+* Not thread safe - one allocator per recording thread. Reset() recycles
+* every page, so only call it once the lists recorded into it have been
+* executed (i.e. its frame's fence has completed).
+*/
+class CommandAllocator
+{
+	friend class CommandList;
+public:
+	explicit CommandAllocator(std::size_t pageSize = 64u * 1024u);
+	CommandAllocator(const CommandAllocator&) = delete;
+	CommandAllocator& operator=(const CommandAllocator&) = delete;
+	void Reset() noexcept;
+	std::size_t GetPageCount() const noexcept;
+	std::size_t GetBytesUsed() const noexcept;
+private:
+	// Returns a fresh page, reusing one from before the last Reset if possible
+	std::byte* AcquirePage();
+	std::size_t GetPageSize() const noexcept;
+private:
+	std::size_t pageSize;
+	std::vector<std::unique_ptr<std::byte[]>> pages;
+	std::size_t pagesInUse = 0u;
+	std::size_t bytesUsed = 0u;
+};
+
+class CommandList
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	// One contiguous run of commands (a page's worth)
+	struct Span
+	{
+		const std::byte* pData;
+		std::size_t size;
+	};
+	// Walks the command stream in recording order
+	class Iterator
+	{
+	public:
+		Iterator(const std::vector<Span>& spans, std::size_t spanIndex) noexcept;
+		const CommandHeader& operator*() const noexcept;
+		Iterator& operator++() noexcept;
+		bool operator!=(const Iterator& rhs) const noexcept;
+		// Payload of the current command, the caller must check the header type first
+		template<typename T>
+		const T& Get() const noexcept;
+		// Variable-length data recorded right after a payload of type T (e.g. root constant values)
+		template<typename T>
+		const void* GetTrailing() const noexcept;
+	private:
+		const std::byte* GetPayload() const noexcept;
+		void SkipEmptySpans() noexcept;
+	private:
+		const std::vector<Span>* pSpans;
+		std::size_t spanIndex;
+		std::size_t offset = 0u;
+	};
+public:
+	CommandList() = default;
+	CommandList(const CommandList&) = delete;
+	CommandList& operator=(const CommandList&) = delete;
+	// Starts recording into alloc, discarding whatever was recorded before
+	void Reset(CommandAllocator& alloc) noexcept;
+	void Close() noexcept;
+	bool IsClosed() const noexcept;
+	/****** RECORDING ******/
+	void SetPipeline(PipelineId pipeline, PipelineKind kind);
+	void SetVertexBuffer(std::uint32_t slot, ResourceId buffer, std::uint32_t offset, std::uint32_t stride);
+	void SetIndexBuffer(ResourceId buffer, std::uint32_t offset, bool is32Bit);
+	void SetViewport(float x, float y, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f);
+	void SetRootConstants(std::uint32_t rootIndex, const std::uint32_t* pValues, std::uint32_t count);
+	void Draw(std::uint32_t vertexCount, std::uint32_t instanceCount = 1u, std::uint32_t startVertex = 0u, std::uint32_t startInstance = 0u);
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount = 1u, std::uint32_t startIndex = 0u, std::int32_t baseVertex = 0, std::uint32_t startInstance = 0u);
+	void Dispatch(std::uint32_t groupsX, std::uint32_t groupsY = 1u, std::uint32_t groupsZ = 1u);
+	void ResourceBarrier(ResourceId resource, ResourceState before, ResourceState after);
+	/****** READING ******/
+	Iterator begin() const noexcept;
+	Iterator end() const noexcept;
+	std::size_t GetCommandCount() const noexcept;
+	std::size_t GetByteSize() const noexcept;
+private:
+	// Reserves header + payloadSize (+ extraSize trailing bytes) and returns where the payload goes.
+	// Throws if the command can't fit in one page or in the header's 16-bit size.
+	void* Push(CommandType type, std::size_t payloadSize, std::size_t extraSize = 0u);
+	template<typename T>
+	T& Push(std::size_t extraSize = 0u);
+private:
+	// Commands are padded to this so every payload is naturally aligned
+	static constexpr std::size_t commandAlignment = 4u;
+	static constexpr std::size_t payloadOffset = (sizeof(CommandHeader) + commandAlignment - 1u) & ~(commandAlignment - 1u);
+	CommandAllocator* pAllocator = nullptr;
+	std::vector<Span> spans;
+	std::byte* pCursor = nullptr;
+	std::byte* pPageEnd = nullptr;
+	std::size_t commandCount = 0u;
+	std::size_t byteSize = 0u;
+	bool closed = false;
+};
+
+#define CLEXCEPT(note) CommandList::Exception(__LINE__, __FILE__, (note))
+
+/* Consumer of recorded command lists.
+* A real backend translates the stream into API calls; NullExecutor just
+* replays it on the CPU and validates it.
+*/
+class CommandExecutor
+{
+public:
+	virtual ~CommandExecutor() = default;
+	virtual void Execute(const CommandList& list) = 0;
+};
+
+/* Validating executor that does no actual work.
+* Pipeline/buffer bindings are per list (like D3D12, nothing is inherited
+* between lists), while resource states carry across lists and submits.
+*/
+class NullExecutor : public CommandExecutor
+{
+public:
+	struct Error
+	{
+		std::size_t listIndex;		// lists executed before this one, across all submits
+		std::size_t commandIndex;	// position of the offending command within its list
+		CommandType type;
+		const char* message;
+	};
+	struct Stats
+	{
+		std::size_t listsExecuted = 0u;
+		std::size_t commandsExecuted = 0u;
+		std::size_t draws = 0u;
+		std::size_t dispatches = 0u;
+		std::size_t barriers = 0u;
+		std::size_t pipelineChanges = 0u;
+	};
+public:
+	void Execute(const CommandList& list) override;
+	// Resources start in Common unless told otherwise
+	void SetResourceState(ResourceId resource, ResourceState state);
+	ResourceState GetResourceState(ResourceId resource) const noexcept;
+	const std::vector<Error>& GetErrors() const noexcept;
+	const Stats& GetStats() const noexcept;
+	void ClearErrors() noexcept;
+private:
+	void ReportError(std::size_t commandIndex, CommandType type, const char* message);
+private:
+	// Ids are opaque and may be sparse; resources not in here are in Common
+	std::unordered_map<ResourceId, ResourceState> resourceStates;
+	std::vector<Error> errors;
+	Stats stats;
+};
+
+/* Submission point. Lists recorded on different threads are executed
+* strictly in the order they are passed here, which is what makes parallel
+* recording deterministic.
+*/
+class CommandQueue
+{
+public:
+	explicit CommandQueue(CommandExecutor& executor) noexcept;
+	void ExecuteCommandLists(const CommandList* const* ppLists, std::size_t count);
+	std::size_t GetSubmittedListCount() const noexcept;
+private:
+	CommandExecutor& executor;
+	std::size_t submittedLists = 0u;
+};
+
+template<typename T>
+inline const T& CommandList::Iterator::Get() const noexcept
+{
+	return *reinterpret_cast<const T*>(GetPayload());
+}
+
+template<typename T>
+inline const void* CommandList::Iterator::GetTrailing() const noexcept
+{
+	return GetPayload() + sizeof(T);
+}
+
+template<typename T>
+inline T& CommandList::Push(std::size_t extraSize)
+{
+	static_assert(std::is_trivially_copyable_v<T>, "commands must be POD");
+	static_assert(alignof(T) <= commandAlignment, "command payload over-aligned");
+	return *static_cast<T*>(Push(T::type, sizeof(T), extraSize));
+}
@@ -0,0 +1,249 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+// Null descriptor heap stuff
+NullDescriptorHeap::NullDescriptorHeap(std::uint32_t capacity, std::uint32_t incrementSize) noexcept
+	:
+	capacity(capacity),
+	incrementSize(incrementSize)
+{}
+
+std::uint32_t NullDescriptorHeap::GetCapacity() const noexcept
+{
+	return capacity;
+}
+
+std::uint64_t NullDescriptorHeap::GetCpuStart() const noexcept
+{
+	// Arbitrary, just recognizable in a debugger
+	return 0x0000100000000000ull;
+}
+
+std::uint64_t NullDescriptorHeap::GetGpuStart() const noexcept
+{
+	return 0x0000200000000000ull;
+}
+
+std::uint32_t NullDescriptorHeap::GetIncrementSize() const noexcept
+{
+	return incrementSize;
+}
+
+// Descriptor allocator stuff
+DescriptorAllocator::DescriptorAllocator(DescriptorHeap& heap, std::uint32_t persistentCount, std::uint32_t transientCountPerFrame, std::uint32_t frameCount)
+	:
+	heap(heap),
+	incrementSize(heap.GetIncrementSize()),
+	persistentCount(persistentCount),
+	nextFree(persistentCount, noBlock),
+	prevFree(persistentCount, noBlock),
+	blockOrder(persistentCount, 0u),
+	blockState(persistentCount, BlockState::Allocated),
+	blockRequested(persistentCount, 0u),
+	transientCountPerFrame(transientCountPerFrame),
+	frameCount(frameCount)
+{
+	assert(frameCount > 0u);
+	assert(static_cast<std::uint64_t>(persistentCount) + static_cast<std::uint64_t>(transientCountPerFrame) * frameCount <= heap.GetCapacity()
+		&& "descriptor heap too small for requested layout");
+	std::fill(std::begin(freeHeads), std::end(freeHeads), noBlock);
+	// Carve the persistent region into the biggest naturally aligned blocks that fit,
+	// so non power of 2 sizes work too
+	std::uint32_t offset = 0u;
+	while (offset < persistentCount)
+	{
+		std::uint32_t order = offset == 0u ? 31u : static_cast<std::uint32_t>(std::countr_zero(offset));
+		while ((1ull << order) > persistentCount - offset)
+		{
+			order--;
+		}
+		PushFree(offset, order);
+		offset += 1u << order;
+	}
+	transientBase = persistentCount;
+}
+
+DescriptorHandle DescriptorAllocator::Allocate(std::uint32_t count)
+{
+	assert(count > 0u);
+	const std::uint32_t order = OrderFor(count);
+	std::lock_guard<std::mutex> lock(persistentMutex);
+	// Smallest non-empty size class that fits
+	const std::uint32_t candidates = order < maxOrders ? nonEmptyOrders & ~((1u << order) - 1u) : 0u;
+	if (candidates == 0u)
+	{
+		failedAllocations++;
+		return DescriptorHandle();
+	}
+	std::uint32_t blockOrderFound = static_cast<std::uint32_t>(std::countr_zero(candidates));
+	const std::uint32_t index = freeHeads[blockOrderFound];
+	RemoveFree(index, blockOrderFound);
+	// Split down to the requested size, giving back the upper halves
+	while (blockOrderFound > order)
+	{
+		blockOrderFound--;
+		PushFree(index + (1u << blockOrderFound), blockOrderFound);
+	}
+	blockOrder[index] = static_cast<std::uint8_t>(order);
+	blockState[index] = BlockState::Allocated;
+	blockRequested[index] = count;
+	allocatedDescriptors += 1u << order;
+	requestedDescriptors += count;
+	return MakeHandle(index, count);
+}
+
+void DescriptorAllocator::Free(const DescriptorHandle& handle, std::uint64_t fenceValue)
+{
+	if (!handle.IsValid())
+	{
+		return;
+	}
+	// Transient ranges go away with their frame, and anything past the persistent region isn't ours to track
+	assert(handle.index < persistentCount && "freeing a transient or foreign descriptor range");
+	if (handle.index >= persistentCount)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(persistentMutex);
+	// A second free while the first is still pending would release the block twice and corrupt the free lists
+	assert(blockState[handle.index] == BlockState::Allocated && "descriptor range freed twice");
+	if (blockState[handle.index] != BlockState::Allocated)
+	{
+		return;
+	}
+	assert((pendingFrees.empty() || pendingFrees.back().fenceValue <= fenceValue) && "fence values must not go backwards");
+	blockState[handle.index] = BlockState::PendingFree;
+	pendingFrees.push_back({ handle.index, fenceValue });
+}
+
+void DescriptorAllocator::Retire(std::uint64_t completedFenceValue)
+{
+	std::lock_guard<std::mutex> lock(persistentMutex);
+	while (!pendingFrees.empty() && pendingFrees.front().fenceValue <= completedFenceValue)
+	{
+		ReleaseBlock(pendingFrees.front().index);
+		pendingFrees.pop_front();
+	}
+}
+
+void DescriptorAllocator::BeginFrame(std::uint32_t frameIndex) noexcept
+{
+	assert(frameIndex < frameCount);
+	transientHighWater = std::max(transientHighWater, std::min(transientOffset.load(), transientCountPerFrame));
+	transientBase = persistentCount + (frameIndex % frameCount) * transientCountPerFrame;
+	transientOffset.store(0u);
+}
+
+DescriptorHandle DescriptorAllocator::AllocateTransient(std::uint32_t count) noexcept
+{
+	const std::uint32_t offset = transientOffset.fetch_add(count);
+	if (offset > transientCountPerFrame || count > transientCountPerFrame - offset)
+	{
+		failedAllocations++;
+		return DescriptorHandle();
+	}
+	return MakeHandle(transientBase + offset, count);
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats() const
+{
+	Stats stats;
+	stats.transientCapacityPerFrame = transientCountPerFrame;
+	stats.transientHighWaterMark = std::max(transientHighWater, std::min(transientOffset.load(), transientCountPerFrame));
+	stats.failedAllocations = failedAllocations.load();
+	std::lock_guard<std::mutex> lock(persistentMutex);
+	stats.persistentCapacity = persistentCount;
+	stats.persistentAllocated = allocatedDescriptors;
+	stats.persistentRequested = requestedDescriptors;
+	stats.pendingFrees = static_cast<std::uint32_t>(pendingFrees.size());
+	if (nonEmptyOrders != 0u)
+	{
+		stats.largestFreeBlock = 1u << (31u - static_cast<std::uint32_t>(std::countl_zero(nonEmptyOrders)));
+	}
+	for (std::uint32_t order = 0u; order < maxOrders; order++)
+	{
+		for (std::uint32_t i = freeHeads[order]; i != noBlock; i = nextFree[i])
+		{
+			stats.freeBlockCount++;
+		}
+	}
+	return stats;
+}
+
+std::uint32_t DescriptorAllocator::GetIncrementSize() const noexcept
+{
+	return incrementSize;
+}
+
+DescriptorHandle DescriptorAllocator::MakeHandle(std::uint32_t index, std::uint32_t count) const noexcept
+{
+	DescriptorHandle handle;
+	handle.index = index;
+	handle.count = count;
+	handle.cpu = heap.GetCpuStart() + static_cast<std::uint64_t>(index) * incrementSize;
+	const std::uint64_t gpuStart = heap.GetGpuStart();
+	handle.gpu = gpuStart == 0u ? 0u : gpuStart + static_cast<std::uint64_t>(index) * incrementSize;
+	return handle;
+}
+
+void DescriptorAllocator::PushFree(std::uint32_t index, std::uint32_t order) noexcept
+{
+	blockOrder[index] = static_cast<std::uint8_t>(order);
+	blockState[index] = BlockState::Free;
+	prevFree[index] = noBlock;
+	nextFree[index] = freeHeads[order];
+	if (freeHeads[order] != noBlock)
+	{
+		prevFree[freeHeads[order]] = index;
+	}
+	freeHeads[order] = index;
+	nonEmptyOrders |= 1u << order;
+}
+
+void DescriptorAllocator::RemoveFree(std::uint32_t index, std::uint32_t order) noexcept
+{
+	if (prevFree[index] != noBlock)
+	{
+		nextFree[prevFree[index]] = nextFree[index];
+	}
+	else
+	{
+		freeHeads[order] = nextFree[index];
+	}
+	if (nextFree[index] != noBlock)
+	{
+		prevFree[nextFree[index]] = prevFree[index];
+	}
+	if (freeHeads[order] == noBlock)
+	{
+		nonEmptyOrders &= ~(1u << order);
+	}
+	blockState[index] = BlockState::Allocated;
+}
+
+void DescriptorAllocator::ReleaseBlock(std::uint32_t index) noexcept
+{
+	std::uint32_t order = blockOrder[index];
+	allocatedDescriptors -= 1u << order;
+	requestedDescriptors -= blockRequested[index];
+	// Merge with the buddy for as long as it's free and the same size
+	while (order + 1u < maxOrders)
+	{
+		const std::uint32_t buddy = index ^ (1u << order);
+		if (buddy >= persistentCount || blockState[buddy] != BlockState::Free || blockOrder[buddy] != order)
+		{
+			break;
+		}
+		RemoveFree(buddy, order);
+		index = std::min(index, buddy);
+		order++;
+	}
+	PushFree(index, order);
+}
+
+std::uint32_t DescriptorAllocator::OrderFor(std::uint32_t count) noexcept
+{
+	return static_cast<std::uint32_t>(std::bit_width(count - 1u));
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* What the descriptor allocator needs to know about a heap.
+* The D3D12 backend wraps an ID3D12DescriptorHeap; NullDescriptorHeap
+* just makes up addresses so the allocator can run without a device.
+*/
+class DescriptorHeap
+{
+public:
+	virtual ~DescriptorHeap() = default;
+	virtual std::uint32_t GetCapacity() const noexcept = 0;
+	virtual std::uint64_t GetCpuStart() const noexcept = 0;
+	// 0 for heaps that aren't shader visible
+	virtual std::uint64_t GetGpuStart() const noexcept = 0;
+	virtual std::uint32_t GetIncrementSize() const noexcept = 0;
+};
+
+class NullDescriptorHeap : public DescriptorHeap
+{
+public:
+	NullDescriptorHeap(std::uint32_t capacity, std::uint32_t incrementSize = 32u) noexcept;
+	std::uint32_t GetCapacity() const noexcept override;
+	std::uint64_t GetCpuStart() const noexcept override;
+	std::uint64_t GetGpuStart() const noexcept override;
+	std::uint32_t GetIncrementSize() const noexcept override;
+private:
+	std::uint32_t capacity;
+	std::uint32_t incrementSize;
+};
+
+// A contiguous range of descriptors in a heap
+struct DescriptorHandle
+{
+	std::uint64_t cpu = 0u;
+	std::uint64_t gpu = 0u;
+	std::uint32_t index = invalidIndex;	// first descriptor, relative to the heap start
+	std::uint32_t count = 0u;
+	static constexpr std::uint32_t invalidIndex = 0xFFFFFFFFu;
+	bool IsValid() const noexcept
+	{
+		return index != invalidIndex;
+	}
+	// Address of the i-th descriptor in the range
+	std::uint64_t CpuAt(std::uint32_t i, std::uint32_t incrementSize) const noexcept
+	{
+		return cpu + static_cast<std::uint64_t>(i) * incrementSize;
+	}
+	std::uint64_t GpuAt(std::uint32_t i, std::uint32_t incrementSize) const noexcept
+	{
+		return gpu + static_cast<std::uint64_t>(i) * incrementSize;
+	}
+};
+
+/* Splits one heap into a persistent region and per-frame transient regions.
+*
+* Persistent ranges (SRVs for loaded textures etc.) come from a buddy
+* allocator: sizes round up to a power of 2, free lists per size class plus a
+* bitmask of non-empty classes make alloc/free O(log2 capacity) worst case,
+* which is a handful of steps for any real heap. Freed ranges are held back
+* until the fence value passed to Free() has completed, so the GPU never sees
+* a descriptor get overwritten mid-frame.
+*
+* Transient ranges (per-draw descriptor tables) are bumped out of the current
+* frame's region and all dropped at once by BeginFrame() when that region
+* comes around again. Transient allocation is lock-free and can be called
+* from several recording threads.
+*/
+class DescriptorAllocator
+{
+public:
+	struct Stats
+	{
+		std::uint32_t persistentCapacity = 0u;
+		std::uint32_t persistentAllocated = 0u;		// in descriptors, after rounding up
+		std::uint32_t persistentRequested = 0u;		// in descriptors, as asked for
+		std::uint32_t largestFreeBlock = 0u;
+		std::uint32_t freeBlockCount = 0u;
+		std::uint32_t pendingFrees = 0u;
+		std::uint32_t transientCapacityPerFrame = 0u;
+		std::uint32_t transientHighWaterMark = 0u;
+		std::uint64_t failedAllocations = 0u;
+		// 0 = all free space in one block, -> 1 = free space shattered into small blocks
+		float GetFragmentation() const noexcept
+		{
+			const std::uint32_t freeSpace = persistentCapacity - persistentAllocated;
+			return freeSpace == 0u ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeSpace);
+		}
+	};
+public:
+	DescriptorAllocator(DescriptorHeap& heap, std::uint32_t persistentCount, std::uint32_t transientCountPerFrame, std::uint32_t frameCount);
+	DescriptorAllocator(const DescriptorAllocator&) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+	/****** PERSISTENT ******/
+	// Returns an invalid handle if there's no block big enough
+	DescriptorHandle Allocate(std::uint32_t count);
+	// Range is reusable once fenceValue has completed (see Retire)
+	void Free(const DescriptorHandle& handle, std::uint64_t fenceValue);
+	// Releases every deferred free whose fence is <= completedFenceValue
+	void Retire(std::uint64_t completedFenceValue);
+	/****** TRANSIENT ******/
+	// Switches to frameIndex's region and throws away everything allocated in it last time round
+	void BeginFrame(std::uint32_t frameIndex) noexcept;
+	DescriptorHandle AllocateTransient(std::uint32_t count) noexcept;
+	/****** INFO ******/
+	Stats GetStats() const;
+	std::uint32_t GetIncrementSize() const noexcept;
+private:
+	// Only meaningful at block starts
+	enum class BlockState : std::uint8_t
+	{
+		Allocated,
+		Free,
+		PendingFree		// freed, waiting on its fence
+	};
+	struct PendingFree
+	{
+		std::uint32_t index;
+		std::uint64_t fenceValue;
+	};
+	DescriptorHandle MakeHandle(std::uint32_t index, std::uint32_t count) const noexcept;
+	void PushFree(std::uint32_t index, std::uint32_t order) noexcept;
+	void RemoveFree(std::uint32_t index, std::uint32_t order) noexcept;
+	void ReleaseBlock(std::uint32_t index) noexcept;
+	static std::uint32_t OrderFor(std::uint32_t count) noexcept;
+private:
+	static constexpr std::uint32_t maxOrders = 32u;
+	static constexpr std::uint32_t noBlock = 0xFFFFFFFFu;
+	DescriptorHeap& heap;
+	std::uint32_t incrementSize;
+	// Persistent region: [0, persistentCount)
+	mutable std::mutex persistentMutex;
+	std::uint32_t persistentCount;
+	std::uint32_t freeHeads[maxOrders];
+	std::uint32_t nonEmptyOrders = 0u;			// bit n set -> freeHeads[n] has blocks
+	std::vector<std::uint32_t> nextFree;		// per block start, intrusive doubly-linked free lists
+	std::vector<std::uint32_t> prevFree;
+	std::vector<std::uint8_t> blockOrder;		// per block start
+	std::vector<BlockState> blockState;
+	std::vector<std::uint32_t> blockRequested;	// count asked for, for stats
+	std::deque<PendingFree> pendingFrees;		// fence values are non-decreasing
+	std::uint32_t allocatedDescriptors = 0u;
+	std::uint32_t requestedDescriptors = 0u;
+	// Transient region: frameCount slices of transientCountPerFrame after the persistent region
+	std::uint32_t transientCountPerFrame;
+	std::uint32_t frameCount;
+	std::uint32_t transientBase = 0u;
+	std::atomic<std::uint32_t> transientOffset{ 0u };
+	std::uint32_t transientHighWater = 0u;
+	std::atomic<std::uint64_t> failedAllocations{ 0u };
+};
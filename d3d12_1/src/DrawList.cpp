@@ -0,0 +1,216 @@
+#include "DrawList.h"
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace
+{
+	// Below this many draws per block the histogram/prefix overhead outweighs the extra threads
+	constexpr std::size_t minBlockSize = 16u * 1024u;
+}
+
+void DrawList::Reset() noexcept
+{
+	keys.clear();
+	items.clear();
+	order.clear();
+}
+
+void DrawList::Reserve(std::size_t count)
+{
+	keys.reserve(count);
+	items.reserve(count);
+	order.reserve(count);
+}
+
+std::uint32_t DrawList::Add(std::uint64_t key, const DrawItem& item)
+{
+	const std::uint32_t index = static_cast<std::uint32_t>(keys.size());
+	keys.push_back(key);
+	items.push_back(item);
+	order.push_back(index);
+	return index;
+}
+
+std::size_t DrawList::Size() const noexcept
+{
+	return keys.size();
+}
+
+void DrawList::Sort()
+{
+	SortImpl(nullptr);
+}
+
+void DrawList::Sort(ThreadPool& pool)
+{
+	SortImpl(&pool);
+}
+
+const std::vector<std::uint32_t>& DrawList::GetOrder() const noexcept
+{
+	return order;
+}
+
+const DrawItem& DrawList::GetItem(std::uint32_t index) const noexcept
+{
+	return items[index];
+}
+
+std::uint64_t DrawList::GetKey(std::uint32_t index) const noexcept
+{
+	return keys[index];
+}
+
+DrawList::StateChanges DrawList::CountStateChanges() const noexcept
+{
+	return CountStateChanges(order.data());
+}
+
+void DrawList::Record(CommandList& list) const
+{
+	const DrawItem* pLast = nullptr;
+	for (const std::uint32_t index : order)
+	{
+		const DrawItem& item = items[index];
+		const bool pipelineChanged = !pLast || item.pipeline != pLast->pipeline;
+		if (pipelineChanged)
+		{
+			list.SetPipeline(item.pipeline, PipelineKind::Graphics);
+		}
+		// Root arguments don't survive a root signature change, so rebind the material then too
+		if (!pLast || item.material != pLast->material || item.rootSignature != pLast->rootSignature)
+		{
+			list.SetRootConstants(0u, &item.material, 1u);
+		}
+		if (!pLast || item.vertexBuffer != pLast->vertexBuffer || item.vertexStride != pLast->vertexStride)
+		{
+			list.SetVertexBuffer(0u, item.vertexBuffer, 0u, item.vertexStride);
+		}
+		if (!pLast || item.indexBuffer != pLast->indexBuffer)
+		{
+			list.SetIndexBuffer(item.indexBuffer, 0u, true);
+		}
+		list.DrawIndexed(item.indexCount, 1u, item.startIndex, item.baseVertex);
+		pLast = &item;
+	}
+}
+
+const DrawList::Stats& DrawList::GetStats() const noexcept
+{
+	return stats;
+}
+
+void DrawList::SortImpl(ThreadPool* pPool)
+{
+	const std::size_t count = keys.size();
+	stats = {};
+	stats.unsorted = CountStateChanges(nullptr);
+	if (count == 0u)
+	{
+		return;
+	}
+	assert(count <= 0xFFFFFFFFu);
+
+	sortKeys.assign(keys.begin(), keys.end());
+	order.resize(count);
+	std::iota(order.begin(), order.end(), 0u);
+	scratchKeys.resize(count);
+	scratchOrder.resize(count);
+
+	std::size_t blockCount = 1u;
+	if (pPool && count >= 2u * minBlockSize)
+	{
+		blockCount = std::min<std::size_t>(pPool->GetConcurrency(), count / minBlockSize);
+	}
+	const std::size_t blockSize = (count + blockCount - 1u) / blockCount;
+	blockCount = (count + blockSize - 1u) / blockSize;
+	stats.blocks = blockCount;
+	const auto forEachBlock = [&](const auto& func)
+	{
+		if (blockCount > 1u)
+		{
+			pPool->ParallelFor(blockCount, 1u, [&](std::size_t begin, std::size_t end)
+			{
+				for (std::size_t block = begin; block < end; block++)
+				{
+					func(block, block * blockSize, std::min(block * blockSize + blockSize, count));
+				}
+			});
+		}
+		else
+		{
+			func(std::size_t(0u), std::size_t(0u), count);
+		}
+	};
+
+	// A byte that is the same in every key would be a pass that moves nothing
+	std::uint64_t differingBits = 0u;
+	for (const std::uint64_t key : keys)
+	{
+		differingBits |= key ^ keys[0];
+	}
+
+	for (unsigned int shift = 0u; shift < 64u; shift += radixBits)
+	{
+		if (((differingBits >> shift) & (radixSize - 1u)) == 0u)
+		{
+			continue;
+		}
+		stats.radixPasses++;
+		// Laid out [block][digit]
+		histograms.assign(blockCount * radixSize, 0u);
+		forEachBlock([&](std::size_t block, std::size_t begin, std::size_t end)
+		{
+			std::size_t* pHistogram = histograms.data() + block * radixSize;
+			for (std::size_t i = begin; i < end; i++)
+			{
+				pHistogram[(sortKeys[i] >> shift) & (radixSize - 1u)]++;
+			}
+		});
+		// Exclusive prefix sum digit-major, so every block's elements land after the previous block's for the same digit
+		std::size_t offset = 0u;
+		for (std::size_t digit = 0u; digit < radixSize; digit++)
+		{
+			for (std::size_t block = 0u; block < blockCount; block++)
+			{
+				std::size_t& slot = histograms[block * radixSize + digit];
+				const std::size_t digitCount = slot;
+				slot = offset;
+				offset += digitCount;
+			}
+		}
+		forEachBlock([&](std::size_t block, std::size_t begin, std::size_t end)
+		{
+			std::size_t* pOffsets = histograms.data() + block * radixSize;
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const std::size_t dest = pOffsets[(sortKeys[i] >> shift) & (radixSize - 1u)]++;
+				scratchKeys[dest] = sortKeys[i];
+				scratchOrder[dest] = order[i];
+			}
+		});
+		sortKeys.swap(scratchKeys);
+		order.swap(scratchOrder);
+	}
+
+	stats.sorted = CountStateChanges(order.data());
+}
+
+DrawList::StateChanges DrawList::CountStateChanges(const std::uint32_t* pOrder) const noexcept
+{
+	StateChanges changes;
+	const DrawItem* pLast = nullptr;
+	for (std::size_t i = 0u; i < items.size(); i++)
+	{
+		// nullptr means submission order
+		const DrawItem& item = items[pOrder ? pOrder[i] : i];
+		changes.pipelines += !pLast || item.pipeline != pLast->pipeline;
+		changes.rootSignatures += !pLast || item.rootSignature != pLast->rootSignature;
+		changes.materials += !pLast || item.material != pLast->material;
+		changes.vertexBuffers += !pLast || item.vertexBuffer != pLast->vertexBuffer;
+		changes.indexBuffers += !pLast || item.indexBuffer != pLast->indexBuffer;
+		pLast = &item;
+	}
+	return changes;
+}
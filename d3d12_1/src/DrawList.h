@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CommandList.h"
+#include "ThreadPool.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* 64-bit draw sort key. Sorting keys ascending orders draws by layer, then
+* pass, then pipeline, then material, then depth - so the expensive state
+* changes happen least often.
+*
+*   bits 60-63  layer      (e.g. world, overlay, UI)
+*   bits 56-59  pass
+*   bits 40-55  pipeline
+*   bits 24-39  material
+*   bits  0-23  depth      (quantized, front to back unless inverted)
+*
+* Translucent draws that need back-to-front order should go in their own
+* layer/pass with an inverted depth. Values have to fit their field: Make()
+* asserts, since a pipeline or material id wrapping around would sort draws
+* next to unrelated state. Ids past 16 bits need remapping to a dense
+* per-frame index first.
+*/
+namespace DrawKey
+{
+	constexpr unsigned int layerShift = 60u;
+	constexpr unsigned int passShift = 56u;
+	constexpr unsigned int pipelineShift = 40u;
+	constexpr unsigned int materialShift = 24u;
+	constexpr std::uint32_t layerMax = 0xFu;
+	constexpr std::uint32_t passMax = 0xFu;
+	constexpr std::uint32_t pipelineMax = 0xFFFFu;
+	constexpr std::uint32_t materialMax = 0xFFFFu;
+	constexpr std::uint32_t depthMax = (1u << 24u) - 1u;
+
+	constexpr std::uint64_t Make(std::uint32_t layer, std::uint32_t pass, std::uint32_t pipeline, std::uint32_t material, std::uint32_t depth) noexcept
+	{
+		assert(layer <= layerMax && pass <= passMax && "layer/pass out of range for a draw key");
+		assert(pipeline <= pipelineMax && material <= materialMax && "pipeline/material id too large for a draw key");
+		assert(depth <= depthMax && "depth not quantized");
+		// Still masked, so a bad field can't spill into its neighbours in release builds
+		return (std::uint64_t(layer & layerMax) << layerShift) |
+			(std::uint64_t(pass & passMax) << passShift) |
+			(std::uint64_t(pipeline & pipelineMax) << pipelineShift) |
+			(std::uint64_t(material & materialMax) << materialShift) |
+			std::uint64_t(depth & depthMax);
+	}
+	// depth01 is view depth normalized to [0, 1]; inverted makes far things sort first
+	constexpr std::uint32_t QuantizeDepth(float depth01, bool inverted = false) noexcept
+	{
+		depth01 = depth01 < 0.0f ? 0.0f : (depth01 > 1.0f ? 1.0f : depth01);
+		const std::uint32_t depth = static_cast<std::uint32_t>(depth01 * float(depthMax));
+		return inverted ? depthMax - depth : depth;
+	}
+	constexpr std::uint32_t GetLayer(std::uint64_t key) noexcept
+	{
+		return std::uint32_t(key >> layerShift) & layerMax;
+	}
+	constexpr std::uint32_t GetPass(std::uint64_t key) noexcept
+	{
+		return std::uint32_t(key >> passShift) & passMax;
+	}
+	constexpr std::uint32_t GetPipeline(std::uint64_t key) noexcept
+	{
+		return std::uint32_t(key >> pipelineShift) & pipelineMax;
+	}
+	constexpr std::uint32_t GetMaterial(std::uint64_t key) noexcept
+	{
+		return std::uint32_t(key >> materialShift) & materialMax;
+	}
+	constexpr std::uint32_t GetDepth(std::uint64_t key) noexcept
+	{
+		return std::uint32_t(key) & depthMax;
+	}
+}
+
+// Everything needed to issue one indexed draw
+struct DrawItem
+{
+	PipelineId pipeline = 0u;
+	std::uint32_t rootSignature = 0u;
+	std::uint32_t material = 0u;		// bound as a root constant (stand-in for a descriptor table)
+	ResourceId vertexBuffer = 0u;
+	std::uint32_t vertexStride = 0u;
+	ResourceId indexBuffer = 0u;
+	std::uint32_t indexCount = 0u;
+	std::uint32_t startIndex = 0u;
+	std::int32_t baseVertex = 0;
+};
+
+/* Per-frame list of draws that gets sorted by key before being recorded.
+* Sort() is an LSD radix sort of (key, draw index) pairs, 8 bits per pass,
+* skipping passes where every key has the same digit. With a pool the
+* input is split into blocks, each block builds its own histogram and
+* scatters its own elements, which keeps the sort stable and lock free.
+* Draws with equal keys keep submission order.
+*/
+class DrawList
+{
+public:
+	// Counted the way a backend would see them: the first draw binds everything, after that only differences count
+	struct StateChanges
+	{
+		std::size_t pipelines = 0u;
+		std::size_t rootSignatures = 0u;
+		std::size_t materials = 0u;
+		std::size_t vertexBuffers = 0u;
+		std::size_t indexBuffers = 0u;
+	};
+	struct Stats
+	{
+		StateChanges unsorted;		// in submission order
+		StateChanges sorted;
+		unsigned int radixPasses = 0u;	// out of 8, the rest were skipped
+		std::size_t blocks = 0u;
+	};
+public:
+	DrawList() = default;
+	DrawList(const DrawList&) = delete;
+	DrawList& operator=(const DrawList&) = delete;
+	void Reset() noexcept;
+	void Reserve(std::size_t count);
+	// Returns the draw's index in submission order
+	std::uint32_t Add(std::uint64_t key, const DrawItem& item);
+	std::size_t Size() const noexcept;
+	void Sort();
+	void Sort(ThreadPool& pool);
+	// Draw indices in sorted order (submission order until Sort() is called)
+	const std::vector<std::uint32_t>& GetOrder() const noexcept;
+	const DrawItem& GetItem(std::uint32_t index) const noexcept;
+	std::uint64_t GetKey(std::uint32_t index) const noexcept;
+	StateChanges CountStateChanges() const noexcept;
+	// Records the draws in current order, skipping redundant binds. Viewport etc. are up to the caller.
+	void Record(CommandList& list) const;
+	// Filled in by Sort()
+	const Stats& GetStats() const noexcept;
+private:
+	void SortImpl(ThreadPool* pPool);
+	StateChanges CountStateChanges(const std::uint32_t* pOrder) const noexcept;
+private:
+	static constexpr unsigned int radixBits = 8u;
+	static constexpr std::size_t radixSize = std::size_t(1u) << radixBits;
+	std::vector<std::uint64_t> keys;
+	std::vector<DrawItem> items;
+	std::vector<std::uint32_t> order;
+	// Sort scratch, kept around so steady-state frames don't allocate
+	std::vector<std::uint64_t> sortKeys;
+	std::vector<std::uint64_t> scratchKeys;
+	std::vector<std::uint32_t> scratchOrder;
+	std::vector<std::size_t> histograms;
+	Stats stats;
+};
@@ -0,0 +1,321 @@
+#include "Ecs.h"
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::size_t noOffset = ~std::size_t(0u);
+
+	std::vector<ComponentRegistry::Info>& RegisteredInfos()
+	{
+		static std::vector<ComponentRegistry::Info> infos;
+		return infos;
+	}
+
+	std::mutex& RegistryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+}
+
+// Component registry stuff
+const ComponentRegistry::Info& ComponentRegistry::GetInfo(ComponentId id) noexcept
+{
+	// Entries are reserved up front and only appended, so reading without the lock is fine
+	return RegisteredInfos()[id];
+}
+
+ComponentId ComponentRegistry::Register(const Info& info)
+{
+	std::lock_guard<std::mutex> lock(RegistryMutex());
+	auto& infos = RegisteredInfos();
+	if (infos.capacity() < maxComponents)
+	{
+		infos.reserve(maxComponents);
+	}
+	if (infos.size() >= maxComponents)
+	{
+		throw std::length_error("too many component types");
+	}
+	infos.push_back(info);
+	return static_cast<ComponentId>(infos.size() - 1u);
+}
+
+// Archetype stuff
+Archetype::Archetype(ComponentMask mask)
+	:
+	mask(mask)
+{
+	std::fill(std::begin(offsets), std::end(offsets), noOffset);
+	std::size_t bytesPerEntity = sizeof(Entity);
+	for (ComponentMask bits = mask; bits != 0u; bits &= bits - 1u)
+	{
+		const ComponentId id = static_cast<ComponentId>(std::countr_zero(bits));
+		components.push_back(id);
+		bytesPerEntity += ComponentRegistry::GetInfo(id).size;
+	}
+	// Start from the ideal capacity and back off until the arrays plus alignment padding fit
+	chunkCapacity = static_cast<std::uint32_t>(chunkSize / bytesPerEntity);
+	for (;; chunkCapacity--)
+	{
+		assert(chunkCapacity > 0u && "component set too big for a chunk");
+		std::size_t offset = sizeof(Entity) * chunkCapacity;
+		for (const ComponentId id : components)
+		{
+			const auto& info = ComponentRegistry::GetInfo(id);
+			offset = (offset + info.alignment - 1u) & ~(info.alignment - 1u);
+			offsets[id] = offset;
+			offset += info.size * chunkCapacity;
+		}
+		if (offset <= chunkSize)
+		{
+			break;
+		}
+	}
+}
+
+Archetype::~Archetype()
+{
+	for (std::size_t chunk = 0u; chunk < chunks.size(); chunk++)
+	{
+		for (std::uint32_t row = 0u; row < chunks[chunk].count; row++)
+		{
+			for (const ComponentId id : components)
+			{
+				ComponentRegistry::GetInfo(id).destroy(GetComponent(static_cast<std::uint32_t>(chunk), row, id));
+			}
+		}
+	}
+}
+
+ComponentMask Archetype::GetMask() const noexcept
+{
+	return mask;
+}
+
+std::uint32_t Archetype::GetChunkCapacity() const noexcept
+{
+	return chunkCapacity;
+}
+
+std::size_t Archetype::GetChunkCount() const noexcept
+{
+	return chunks.size();
+}
+
+std::size_t Archetype::GetEntityCount() const noexcept
+{
+	return entityCount;
+}
+
+std::uint32_t Archetype::GetChunkEntityCount(std::size_t chunk) const noexcept
+{
+	return chunks[chunk].count;
+}
+
+Entity* Archetype::GetEntities(std::size_t chunk) noexcept
+{
+	return reinterpret_cast<Entity*>(chunks[chunk].pMemory.get());
+}
+
+void* Archetype::GetComponentArray(std::size_t chunk, ComponentId id) noexcept
+{
+	if (offsets[id] == noOffset)
+	{
+		return nullptr;
+	}
+	return chunks[chunk].pMemory.get() + offsets[id];
+}
+
+std::pair<std::uint32_t, std::uint32_t> Archetype::AllocateRow(Entity entity)
+{
+	// Every chunk but the last one holding entities is full, and at most one empty spare follows it.
+	// With a spare, the chunk before it can still have room once RemoveRow has taken from it; fill that first.
+	std::size_t target = chunks.size();
+	if (!chunks.empty())
+	{
+		target = chunks.size() - 1u;
+		if (chunks[target].count == 0u && target > 0u && chunks[target - 1u].count < chunkCapacity)
+		{
+			target--;
+		}
+		else if (chunks[target].count == chunkCapacity)
+		{
+			target++;
+		}
+	}
+	if (target == chunks.size())
+	{
+		Chunk chunk;
+		chunk.pMemory.reset(static_cast<std::byte*>(::operator new(chunkSize, std::align_val_t(64))));
+		chunks.push_back(std::move(chunk));
+	}
+	const std::uint32_t chunk = static_cast<std::uint32_t>(target);
+	const std::uint32_t row = chunks[target].count++;
+	GetEntities(chunk)[row] = entity;
+	entityCount++;
+	return { chunk, row };
+}
+
+Entity Archetype::RemoveRow(std::uint32_t chunk, std::uint32_t row, bool destroyComponents) noexcept
+{
+	if (destroyComponents)
+	{
+		for (const ComponentId id : components)
+		{
+			ComponentRegistry::GetInfo(id).destroy(GetComponent(chunk, row, id));
+		}
+	}
+	// The final chunk may be an empty spare, the last entity is in the one before it then
+	std::uint32_t lastChunk = static_cast<std::uint32_t>(chunks.size() - 1u);
+	if (chunks[lastChunk].count == 0u)
+	{
+		lastChunk--;
+	}
+	const std::uint32_t lastRow = chunks[lastChunk].count - 1u;
+	Entity moved;
+	if (chunk != lastChunk || row != lastRow)
+	{
+		// Fill the hole with the archetype's last entity
+		for (const ComponentId id : components)
+		{
+			const auto& info = ComponentRegistry::GetInfo(id);
+			void* pLast = GetComponent(lastChunk, lastRow, id);
+			info.moveConstruct(GetComponent(chunk, row, id), pLast);
+			info.destroy(pLast);
+		}
+		moved = GetEntities(lastChunk)[lastRow];
+		GetEntities(chunk)[row] = moved;
+	}
+	chunks[lastChunk].count--;
+	entityCount--;
+	// Keep at most one empty chunk around as a spare
+	if (chunks[lastChunk].count == 0u && lastChunk + 1u < chunks.size())
+	{
+		chunks.pop_back();
+	}
+	return moved;
+}
+
+void* Archetype::GetComponent(std::uint32_t chunk, std::uint32_t row, ComponentId id) noexcept
+{
+	if (offsets[id] == noOffset)
+	{
+		return nullptr;
+	}
+	return chunks[chunk].pMemory.get() + offsets[id] + static_cast<std::size_t>(row) * ComponentRegistry::GetInfo(id).size;
+}
+
+// World stuff
+World::World() = default;
+
+World::~World() = default;
+
+Entity World::Create()
+{
+	const Entity entity = AllocateEntity();
+	Archetype& archetype = GetOrCreateArchetype(0u);
+	const auto [chunk, row] = archetype.AllocateRow(entity);
+	EntityRecord& record = records[entity.index];
+	record.pArchetype = &archetype;
+	record.chunk = chunk;
+	record.row = row;
+	return entity;
+}
+
+void World::Destroy(Entity entity) noexcept
+{
+	if (!IsAlive(entity))
+	{
+		return;
+	}
+	EntityRecord& record = records[entity.index];
+	const Entity moved = record.pArchetype->RemoveRow(record.chunk, record.row, true);
+	if (moved.IsValid())
+	{
+		records[moved.index].chunk = record.chunk;
+		records[moved.index].row = record.row;
+	}
+	record.pArchetype = nullptr;
+	// Bumping the generation invalidates every outstanding copy of this handle
+	record.generation++;
+	freeIndices.push_back(entity.index);
+}
+
+bool World::IsAlive(Entity entity) const noexcept
+{
+	return entity.index < records.size() && records[entity.index].pArchetype != nullptr && records[entity.index].generation == entity.generation;
+}
+
+World::Stats World::GetStats() const noexcept
+{
+	Stats stats;
+	stats.archetypes = archetypes.size();
+	stats.archetypeMoves = archetypeMoves;
+	for (const auto& [mask, pArchetype] : archetypes)
+	{
+		stats.entities += pArchetype->GetEntityCount();
+		stats.chunks += pArchetype->GetChunkCount();
+	}
+	return stats;
+}
+
+Archetype& World::GetOrCreateArchetype(ComponentMask mask)
+{
+	auto it = archetypes.find(mask);
+	if (it == archetypes.end())
+	{
+		it = archetypes.emplace(mask, std::make_unique<Archetype>(mask)).first;
+	}
+	return *it->second;
+}
+
+Entity World::AllocateEntity()
+{
+	Entity entity;
+	if (!freeIndices.empty())
+	{
+		entity.index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = static_cast<std::uint32_t>(records.size());
+		records.emplace_back();
+	}
+	entity.generation = records[entity.index].generation;
+	return entity;
+}
+
+void World::MoveEntity(Entity entity, ComponentMask newMask)
+{
+	EntityRecord& record = records[entity.index];
+	Archetype& source = *record.pArchetype;
+	Archetype& dest = GetOrCreateArchetype(newMask);
+	const auto [chunk, row] = dest.AllocateRow(entity);
+	// Carry over the components both archetypes share, destroy the ones being dropped
+	for (const ComponentId id : source.components)
+	{
+		const auto& info = ComponentRegistry::GetInfo(id);
+		void* pSrc = source.GetComponent(record.chunk, record.row, id);
+		if (void* pDest = dest.GetComponent(chunk, row, id))
+		{
+			info.moveConstruct(pDest, pSrc);
+		}
+		info.destroy(pSrc);
+	}
+	// Components are already destroyed (moved-from), so just swap-and-pop the row
+	const Entity moved = source.RemoveRow(record.chunk, record.row, false);
+	if (moved.IsValid())
+	{
+		records[moved.index].chunk = record.chunk;
+		records[moved.index].row = record.row;
+	}
+	record.pArchetype = &dest;
+	record.chunk = chunk;
+	record.row = row;
+	archetypeMoves++;
+}
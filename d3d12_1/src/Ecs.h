@@ -0,0 +1,328 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Archetype-based entity component store.
+* Entities with the same set of components share an Archetype, whose data
+* lives in fixed-size chunks laid out as structure-of-arrays: one entity id
+* array, then one tightly packed array per component. Queries walk the
+* chunks linearly, and can hand chunks out to worker threads.
+*
+* Adding/removing a component moves the entity to another archetype;
+* removal from a chunk is swap-and-pop with the archetype's last entity,
+* so chunks always stay dense. Structural changes (Create/Destroy/Add/Remove)
+* must not happen while a query is running.
+*/
+
+struct Entity
+{
+	std::uint32_t index = invalidIndex;
+	std::uint32_t generation = 0u;
+	static constexpr std::uint32_t invalidIndex = 0xFFFFFFFFu;
+	bool IsValid() const noexcept
+	{
+		return index != invalidIndex;
+	}
+	bool operator==(const Entity& rhs) const noexcept
+	{
+		return index == rhs.index && generation == rhs.generation;
+	}
+};
+
+using ComponentId = std::uint32_t;
+// One bit per component type
+using ComponentMask = std::uint64_t;
+
+/* Type-erased info about each component type, ids are handed out on first use.
+* Components must be nothrow move constructible so archetype moves can't fail halfway.
+*/
+class ComponentRegistry
+{
+public:
+	struct Info
+	{
+		std::size_t size;
+		std::size_t alignment;
+		void (*moveConstruct)(void* pDest, void* pSrc) noexcept;
+		void (*destroy)(void* pObject) noexcept;
+	};
+public:
+	static constexpr ComponentId maxComponents = 64u;
+	template<typename T>
+	static ComponentId GetId();
+	static const Info& GetInfo(ComponentId id) noexcept;
+private:
+	static ComponentId Register(const Info& info);
+};
+
+class Archetype
+{
+	friend class World;
+public:
+	// Fixed chunk size; small enough to sit in L2, big enough to amortize per-chunk overhead
+	static constexpr std::size_t chunkSize = 16u * 1024u;
+	struct Chunk
+	{
+		struct Deleter
+		{
+			void operator()(std::byte* p) const noexcept
+			{
+				::operator delete(p, std::align_val_t(64));
+			}
+		};
+		std::unique_ptr<std::byte, Deleter> pMemory;
+		std::uint32_t count = 0u;
+	};
+public:
+	Archetype(ComponentMask mask);
+	~Archetype();
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
+	ComponentMask GetMask() const noexcept;
+	std::uint32_t GetChunkCapacity() const noexcept;
+	std::size_t GetChunkCount() const noexcept;
+	std::size_t GetEntityCount() const noexcept;
+	std::uint32_t GetChunkEntityCount(std::size_t chunk) const noexcept;
+	Entity* GetEntities(std::size_t chunk) noexcept;
+	// Start of a component's array in a chunk, or nullptr if the archetype doesn't have it
+	void* GetComponentArray(std::size_t chunk, ComponentId id) noexcept;
+	template<typename T>
+	T* GetComponentArray(std::size_t chunk) noexcept;
+private:
+	// Appends an uninitialized row for entity; returns (chunk, row)
+	std::pair<std::uint32_t, std::uint32_t> AllocateRow(Entity entity);
+	// Swap-and-pop; returns the entity that was moved into the hole (invalid if none)
+	Entity RemoveRow(std::uint32_t chunk, std::uint32_t row, bool destroyComponents) noexcept;
+	void* GetComponent(std::uint32_t chunk, std::uint32_t row, ComponentId id) noexcept;
+private:
+	ComponentMask mask;
+	std::vector<ComponentId> components;
+	// Indexed by ComponentId; offset of that component's array inside a chunk (or ~0)
+	std::size_t offsets[ComponentRegistry::maxComponents];
+	std::uint32_t chunkCapacity = 0u;
+	std::vector<Chunk> chunks;
+	std::size_t entityCount = 0u;
+};
+
+class World
+{
+public:
+	struct Stats
+	{
+		std::size_t entities = 0u;
+		std::size_t archetypes = 0u;
+		std::size_t chunks = 0u;
+		std::uint64_t archetypeMoves = 0u;	// entities moved by Add/Remove
+	};
+public:
+	World();
+	~World();
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+	Entity Create();
+	template<typename... Ts>
+	Entity Create(Ts&&... components);
+	void Destroy(Entity entity) noexcept;
+	bool IsAlive(Entity entity) const noexcept;
+	template<typename T>
+	void Add(Entity entity, T&& component);
+	template<typename T>
+	void Remove(Entity entity);
+	template<typename T>
+	bool Has(Entity entity) const noexcept;
+	// nullptr if the entity is dead or lacks the component
+	template<typename T>
+	T* Get(Entity entity) noexcept;
+	/****** QUERIES ******/
+	// f(Entity, Ts&...) for every entity having all of Ts
+	template<typename... Ts, typename F>
+	void ForEach(F&& f);
+	// f(std::size_t count, const Entity*, Ts*...) once per chunk - the fast path for SIMD-friendly loops
+	template<typename... Ts, typename F>
+	void ForEachChunk(F&& f);
+	// Same as ForEachChunk, with chunks spread over the pool. f must be safe to call concurrently.
+	template<typename... Ts, typename F>
+	void ParallelForEachChunk(ThreadPool& pool, F&& f);
+	Stats GetStats() const noexcept;
+private:
+	struct EntityRecord
+	{
+		Archetype* pArchetype = nullptr;
+		std::uint32_t chunk = 0u;
+		std::uint32_t row = 0u;
+		std::uint32_t generation = 0u;
+	};
+	Archetype& GetOrCreateArchetype(ComponentMask mask);
+	Entity AllocateEntity();
+	// Moves entity to the archetype for newMask, carrying over the components both have
+	void MoveEntity(Entity entity, ComponentMask newMask);
+	template<typename... Ts>
+	static ComponentMask MaskOf();
+	template<typename... Ts, typename F>
+	void GatherChunks(F&& f);
+private:
+	std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> archetypes;
+	std::vector<EntityRecord> records;
+	std::vector<std::uint32_t> freeIndices;
+	std::uint64_t archetypeMoves = 0u;
+};
+
+/****************** Implementation ******************/
+
+template<typename T>
+inline ComponentId ComponentRegistry::GetId()
+{
+	using Type = std::remove_cvref_t<T>;
+	static_assert(std::is_nothrow_move_constructible_v<Type>, "components must be nothrow move constructible");
+	static const ComponentId id = Register({
+		sizeof(Type),
+		alignof(Type),
+		[](void* pDest, void* pSrc) noexcept { ::new (pDest) Type(std::move(*static_cast<Type*>(pSrc))); },
+		[](void* pObject) noexcept { static_cast<Type*>(pObject)->~Type(); }
+	});
+	return id;
+}
+
+template<typename T>
+inline T* Archetype::GetComponentArray(std::size_t chunk) noexcept
+{
+	return static_cast<T*>(GetComponentArray(chunk, ComponentRegistry::GetId<T>()));
+}
+
+template<typename... Ts>
+inline ComponentMask World::MaskOf()
+{
+	return (ComponentMask(0u) | ... | (ComponentMask(1u) << ComponentRegistry::GetId<Ts>()));
+}
+
+template<typename... Ts>
+inline Entity World::Create(Ts&&... components)
+{
+	const Entity entity = AllocateEntity();
+	Archetype& archetype = GetOrCreateArchetype(MaskOf<Ts...>());
+	const auto [chunk, row] = archetype.AllocateRow(entity);
+	EntityRecord& record = records[entity.index];
+	record.pArchetype = &archetype;
+	record.chunk = chunk;
+	record.row = row;
+	(::new (archetype.GetComponent(chunk, row, ComponentRegistry::GetId<Ts>())) std::remove_cvref_t<Ts>(std::forward<Ts>(components)), ...);
+	return entity;
+}
+
+template<typename T>
+inline void World::Add(Entity entity, T&& component)
+{
+	assert(IsAlive(entity));
+	using Type = std::remove_cvref_t<T>;
+	const ComponentId id = ComponentRegistry::GetId<Type>();
+	EntityRecord& record = records[entity.index];
+	if (record.pArchetype->GetMask() & (ComponentMask(1u) << id))
+	{
+		// Already there, just overwrite
+		*static_cast<Type*>(record.pArchetype->GetComponent(record.chunk, record.row, id)) = std::forward<T>(component);
+		return;
+	}
+	MoveEntity(entity, record.pArchetype->GetMask() | (ComponentMask(1u) << id));
+	::new (record.pArchetype->GetComponent(record.chunk, record.row, id)) Type(std::forward<T>(component));
+}
+
+template<typename T>
+inline void World::Remove(Entity entity)
+{
+	assert(IsAlive(entity));
+	const ComponentId id = ComponentRegistry::GetId<T>();
+	EntityRecord& record = records[entity.index];
+	if (!(record.pArchetype->GetMask() & (ComponentMask(1u) << id)))
+	{
+		return;
+	}
+	MoveEntity(entity, record.pArchetype->GetMask() & ~(ComponentMask(1u) << id));
+}
+
+template<typename T>
+inline bool World::Has(Entity entity) const noexcept
+{
+	return IsAlive(entity) && (records[entity.index].pArchetype->GetMask() & (ComponentMask(1u) << ComponentRegistry::GetId<T>())) != 0u;
+}
+
+template<typename T>
+inline T* World::Get(Entity entity) noexcept
+{
+	if (!IsAlive(entity))
+	{
+		return nullptr;
+	}
+	const EntityRecord& record = records[entity.index];
+	return static_cast<T*>(record.pArchetype->GetComponent(record.chunk, record.row, ComponentRegistry::GetId<T>()));
+}
+
+template<typename... Ts, typename F>
+inline void World::GatherChunks(F&& f)
+{
+	const ComponentMask required = MaskOf<Ts...>();
+	for (auto& [mask, pArchetype] : archetypes)
+	{
+		if ((mask & required) != required)
+		{
+			continue;
+		}
+		for (std::size_t chunk = 0u; chunk < pArchetype->GetChunkCount(); chunk++)
+		{
+			if (pArchetype->GetChunkEntityCount(chunk) > 0u)
+			{
+				f(*pArchetype, chunk);
+			}
+		}
+	}
+}
+
+template<typename... Ts, typename F>
+inline void World::ForEachChunk(F&& f)
+{
+	GatherChunks<Ts...>([&f](Archetype& archetype, std::size_t chunk)
+	{
+		f(static_cast<std::size_t>(archetype.GetChunkEntityCount(chunk)), archetype.GetEntities(chunk), archetype.GetComponentArray<Ts>(chunk)...);
+	});
+}
+
+template<typename... Ts, typename F>
+inline void World::ForEach(F&& f)
+{
+	ForEachChunk<Ts...>([&f](std::size_t count, const Entity* pEntities, Ts*... pArrays)
+	{
+		for (std::size_t i = 0u; i < count; i++)
+		{
+			f(pEntities[i], pArrays[i]...);
+		}
+	});
+}
+
+template<typename... Ts, typename F>
+inline void World::ParallelForEachChunk(ThreadPool& pool, F&& f)
+{
+	// Flatten the matching chunks first so work splits evenly regardless of archetype sizes
+	std::vector<std::pair<Archetype*, std::size_t>> work;
+	GatherChunks<Ts...>([&work](Archetype& archetype, std::size_t chunk)
+	{
+		work.emplace_back(&archetype, chunk);
+	});
+	pool.ParallelFor(work.size(), 1u, [&work, &f](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			Archetype& archetype = *work[i].first;
+			const std::size_t chunk = work[i].second;
+			f(static_cast<std::size_t>(archetype.GetChunkEntityCount(chunk)), archetype.GetEntities(chunk), archetype.GetComponentArray<Ts>(chunk)...);
+		}
+	});
+}
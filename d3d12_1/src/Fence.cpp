@@ -0,0 +1,44 @@
+#include "Fence.h"
+
+std::uint64_t Fence::Signal() noexcept
+{
+	return ++signaledValue;
+}
+
+void Fence::Complete(std::uint64_t value)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (value <= completedValue.load())
+		{
+			return;
+		}
+		completedValue.store(value);
+	}
+	completed.notify_all();
+}
+
+std::uint64_t Fence::GetCompletedValue() const noexcept
+{
+	return completedValue.load();
+}
+
+std::uint64_t Fence::GetSignaledValue() const noexcept
+{
+	return signaledValue.load();
+}
+
+bool Fence::IsComplete(std::uint64_t value) const noexcept
+{
+	return completedValue.load() >= value;
+}
+
+void Fence::Wait(std::uint64_t value)
+{
+	if (IsComplete(value))
+	{
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	completed.wait(lock, [this, value] { return completedValue.load() >= value; });
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/* CPU-side stand-in for ID3D12Fence.
+* Signal() hands out the next value on the CPU timeline (what you'd pass to
+* ID3D12CommandQueue::Signal), and whoever plays the GPU calls Complete()
+* once the work up to that value is done. Values only ever go up.
+*/
+class Fence
+{
+public:
+	Fence() = default;
+	Fence(const Fence&) = delete;
+	Fence& operator=(const Fence&) = delete;
+	// Returns the new value the GPU will eventually complete
+	std::uint64_t Signal() noexcept;
+	// GPU side - marks every value <= value as done and wakes waiters
+	void Complete(std::uint64_t value);
+	std::uint64_t GetCompletedValue() const noexcept;
+	// Last value handed out by Signal()
+	std::uint64_t GetSignaledValue() const noexcept;
+	bool IsComplete(std::uint64_t value) const noexcept;
+	// Blocks the calling thread until value has completed
+	void Wait(std::uint64_t value);
+private:
+	std::atomic<std::uint64_t> signaledValue{ 0u };
+	std::atomic<std::uint64_t> completedValue{ 0u };
+	std::mutex mutex;
+	std::condition_variable completed;
+};
@@ -0,0 +1,186 @@
+#include "FrameContext.h"
+#include <cassert>
+
+// Frame context stuff
+FrameContext::FrameContext(unsigned int index, std::size_t arenaSize)
+	:
+	index(index),
+	arena(arenaSize)
+{}
+
+unsigned int FrameContext::GetIndex() const noexcept
+{
+	return index;
+}
+
+std::uint64_t FrameContext::GetFenceValue() const noexcept
+{
+	return fenceValue;
+}
+
+LinearArena& FrameContext::GetArena() noexcept
+{
+	return arena;
+}
+
+CommandAllocator& FrameContext::GetCommandAllocator() noexcept
+{
+	return commandAllocator;
+}
+
+void FrameContext::DeferDestroy(std::function<void()> func)
+{
+	deferredDestroys.push_back(std::move(func));
+}
+
+void FrameContext::Recycle() noexcept
+{
+	for (auto& func : deferredDestroys)
+	{
+		func();
+	}
+	deferredDestroys.clear();
+	arena.Reset();
+	commandAllocator.Reset();
+}
+
+// Frame context manager stuff
+FrameContextManager::FrameContextManager(Fence& fence, unsigned int frameCount, std::size_t arenaSizePerFrame)
+	:
+	fence(fence)
+{
+	assert(frameCount >= 1u && frameCount <= 3u && "frames in flight should be 2 or 3");
+	contexts.reserve(frameCount);
+	for (unsigned int i = 0u; i < frameCount; i++)
+	{
+		contexts.push_back(std::make_unique<FrameContext>(i, arenaSizePerFrame));
+	}
+}
+
+FrameContextManager::~FrameContextManager()
+{
+	// Deferred destroys may release things the GPU is still using, so let it finish first
+	WaitIdle();
+}
+
+FrameContext& FrameContextManager::BeginFrame()
+{
+	assert(!inFrame && "BeginFrame called twice without EndFrame");
+	current = static_cast<unsigned int>(frameNumber % contexts.size());
+	FrameContext& context = *contexts[current];
+	// Only blocks when this context's previous submission (frameCount frames ago) hasn't finished
+	if (!fence.IsComplete(context.fenceValue))
+	{
+		stats.waits++;
+		const auto start = std::chrono::steady_clock::now();
+		fence.Wait(context.fenceValue);
+		stats.waitTime += std::chrono::steady_clock::now() - start;
+	}
+	stats.deferredDestroysRun += context.deferredDestroys.size();
+	context.Recycle();
+	inFrame = true;
+	stats.framesBegun++;
+	return context;
+}
+
+std::uint64_t FrameContextManager::EndFrame()
+{
+	assert(inFrame && "EndFrame called without BeginFrame");
+	FrameContext& context = *contexts[current];
+	context.fenceValue = fence.Signal();
+	inFrame = false;
+	frameNumber++;
+	return context.fenceValue;
+}
+
+FrameContext& FrameContextManager::Current() noexcept
+{
+	return *contexts[current];
+}
+
+unsigned int FrameContextManager::GetFrameCount() const noexcept
+{
+	return static_cast<unsigned int>(contexts.size());
+}
+
+void FrameContextManager::WaitIdle()
+{
+	for (auto& pContext : contexts)
+	{
+		fence.Wait(pContext->fenceValue);
+		stats.deferredDestroysRun += pContext->deferredDestroys.size();
+		pContext->Recycle();
+	}
+}
+
+const FrameContextManager::Stats& FrameContextManager::GetStats() const noexcept
+{
+	return stats;
+}
+
+// GPU timeline stuff
+GpuTimeline::GpuTimeline(Fence& fence, std::chrono::microseconds defaultDuration)
+	:
+	fence(fence),
+	defaultDuration(defaultDuration),
+	thread(&GpuTimeline::Run, this)
+{}
+
+GpuTimeline::~GpuTimeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	thread.join();
+}
+
+void GpuTimeline::Submit(std::uint64_t fenceValue)
+{
+	Submit(fenceValue, defaultDuration);
+}
+
+void GpuTimeline::Submit(std::uint64_t fenceValue, std::chrono::microseconds duration)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		work.push({ fenceValue, duration });
+		stats.submitted++;
+	}
+	workAvailable.notify_one();
+}
+
+GpuTimeline::Stats GpuTimeline::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void GpuTimeline::Run()
+{
+	for (;;)
+	{
+		Work item;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [this] { return stopping || !work.empty(); });
+			// Drain what's queued even when stopping, so nobody is left waiting on the fence
+			if (work.empty())
+			{
+				return;
+			}
+			item = work.front();
+			work.pop();
+		}
+		// Like a real queue, work runs back to back in submission order
+		if (item.duration.count() > 0)
+		{
+			std::this_thread::sleep_for(item.duration);
+		}
+		fence.Complete(item.fenceValue);
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.completed++;
+		stats.busyTime += item.duration;
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Fence.h"
+#include "MemoryArena.h"
+#include "CommandList.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/* Everything that belongs to one frame in flight.
+* It's handed out by FrameContextManager::BeginFrame() and must not be
+* touched again until the manager hands it out next time, by which point
+* the GPU is done with it.
+*/
+class FrameContext
+{
+	friend class FrameContextManager;
+public:
+	FrameContext(unsigned int index, std::size_t arenaSize);
+	FrameContext(const FrameContext&) = delete;
+	FrameContext& operator=(const FrameContext&) = delete;
+	unsigned int GetIndex() const noexcept;
+	// Fence value of the last time this context was submitted (0 = never)
+	std::uint64_t GetFenceValue() const noexcept;
+	LinearArena& GetArena() noexcept;
+	CommandAllocator& GetCommandAllocator() noexcept;
+	// Runs func once the GPU has finished this frame (i.e. next time the context comes round)
+	void DeferDestroy(std::function<void()> func);
+private:
+	// Called once the context's fence has completed
+	void Recycle() noexcept;
+private:
+	unsigned int index;
+	std::uint64_t fenceValue = 0u;
+	LinearArena arena;
+	CommandAllocator commandAllocator;
+	std::vector<std::function<void()>> deferredDestroys;
+};
+
+/* Owns frameCount (2 or 3) frame contexts and round-robins through them.
+* BeginFrame() only blocks when the CPU is frameCount frames ahead of the
+* GPU, which is what lets CPU work for frame N+1 overlap GPU work for N.
+*/
+class FrameContextManager
+{
+public:
+	struct Stats
+	{
+		std::uint64_t framesBegun = 0u;
+		std::uint64_t waits = 0u;				// BeginFrame had to block on the GPU
+		std::chrono::nanoseconds waitTime{ 0 };
+		std::uint64_t deferredDestroysRun = 0u;
+	};
+public:
+	FrameContextManager(Fence& fence, unsigned int frameCount = 2u, std::size_t arenaSizePerFrame = 1024u * 1024u);
+	~FrameContextManager();
+	FrameContextManager(const FrameContextManager&) = delete;
+	FrameContextManager& operator=(const FrameContextManager&) = delete;
+	FrameContext& BeginFrame();
+	// Signals the fence for the current frame; submit the returned value to the GPU queue
+	std::uint64_t EndFrame();
+	FrameContext& Current() noexcept;
+	unsigned int GetFrameCount() const noexcept;
+	// Blocks until the GPU is idle, then runs every pending deferred destroy
+	void WaitIdle();
+	const Stats& GetStats() const noexcept;
+private:
+	Fence& fence;
+	std::vector<std::unique_ptr<FrameContext>> contexts;
+	unsigned int current = 0u;
+	bool inFrame = false;
+	std::uint64_t frameNumber = 0u;
+	Stats stats;
+};
+
+/* Software "GPU" for running without a device.
+* Submitted fence values are worked through in order on a background
+* thread; each takes its simulated duration, then the fence is completed.
+* Good enough to exercise frame pacing and deferred deletion.
+*/
+class GpuTimeline
+{
+public:
+	struct Stats
+	{
+		std::uint64_t submitted = 0u;
+		std::uint64_t completed = 0u;
+		std::chrono::nanoseconds busyTime{ 0 };
+	};
+public:
+	GpuTimeline(Fence& fence, std::chrono::microseconds defaultDuration = std::chrono::microseconds(0));
+	~GpuTimeline();
+	GpuTimeline(const GpuTimeline&) = delete;
+	GpuTimeline& operator=(const GpuTimeline&) = delete;
+	void Submit(std::uint64_t fenceValue);
+	void Submit(std::uint64_t fenceValue, std::chrono::microseconds duration);
+	Stats GetStats() const;
+private:
+	void Run();
+private:
+	struct Work
+	{
+		std::uint64_t fenceValue;
+		std::chrono::microseconds duration;
+	};
+	Fence& fence;
+	std::chrono::microseconds defaultDuration;
+	mutable std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::queue<Work> work;
+	Stats stats;
+	bool stopping = false;
+	std::thread thread;
+};
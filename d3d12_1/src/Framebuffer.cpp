@@ -0,0 +1,282 @@
+#include "Framebuffer.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAMEBUFFER_SSE2
+#endif
+
+namespace
+{
+	// PNG helpers - we only ever write 8-bit RGB with stored (uncompressed) deflate blocks,
+	// which keeps the writer dependency-free and is plenty for golden images
+	const std::array<std::uint32_t, 256>& Crc32Table() noexcept
+	{
+		static const std::array<std::uint32_t, 256> table = []
+		{
+			std::array<std::uint32_t, 256> t{};
+			for (std::uint32_t n = 0u; n < 256u; n++)
+			{
+				std::uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				t[n] = c;
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	std::uint32_t Crc32(const std::uint8_t* pData, std::size_t size, std::uint32_t crc = 0u) noexcept
+	{
+		const auto& table = Crc32Table();
+		crc = ~crc;
+		for (std::size_t i = 0u; i < size; i++)
+		{
+			crc = table[(crc ^ pData[i]) & 0xFFu] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	void PutU32BE(std::vector<std::uint8_t>& out, std::uint32_t value)
+	{
+		out.push_back(static_cast<std::uint8_t>(value >> 24));
+		out.push_back(static_cast<std::uint8_t>(value >> 16));
+		out.push_back(static_cast<std::uint8_t>(value >> 8));
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	void WriteChunk(std::ofstream& file, const char* type, const std::vector<std::uint8_t>& data)
+	{
+		std::vector<std::uint8_t> chunk;
+		chunk.reserve(data.size() + 12u);
+		PutU32BE(chunk, static_cast<std::uint32_t>(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		// CRC covers type + data, not the length
+		PutU32BE(chunk, Crc32(chunk.data() + 4u, data.size() + 4u));
+		file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+	}
+}
+
+Framebuffer::Framebuffer(int width, int height)
+	:
+	width(width),
+	height(height),
+	color(static_cast<std::size_t>(width) * height),
+	depth(static_cast<std::size_t>(width) * height)
+{
+	assert(width > 0 && height > 0);
+}
+
+int Framebuffer::GetWidth() const noexcept
+{
+	return width;
+}
+
+int Framebuffer::GetHeight() const noexcept
+{
+	return height;
+}
+
+std::uint32_t* Framebuffer::GetColorRow(int y) noexcept
+{
+	return color.data() + static_cast<std::size_t>(y) * width;
+}
+
+float* Framebuffer::GetDepthRow(int y) noexcept
+{
+	return depth.data() + static_cast<std::size_t>(y) * width;
+}
+
+const std::uint32_t* Framebuffer::GetColorData() const noexcept
+{
+	return color.data();
+}
+
+std::uint32_t Framebuffer::GetPixel(int x, int y) const noexcept
+{
+	return color[static_cast<std::size_t>(y) * width + x];
+}
+
+void Framebuffer::Clear(std::uint32_t clearColor, float clearDepth) noexcept
+{
+	// Whole surface is contiguous, so this is just two long spans
+	FillSpan(color.data(), color.size(), clearColor);
+	FillSpan(reinterpret_cast<std::uint32_t*>(depth.data()), depth.size(), std::bit_cast<std::uint32_t>(clearDepth));
+}
+
+void Framebuffer::FillRect(int x0, int y0, int x1, int y1, std::uint32_t fillColor, float fillDepth) noexcept
+{
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, width);
+	y1 = std::min(y1, height);
+	if (x0 >= x1 || y0 >= y1)
+	{
+		return;
+	}
+	const std::size_t spanLength = static_cast<std::size_t>(x1 - x0);
+	const std::uint32_t depthBits = std::bit_cast<std::uint32_t>(fillDepth);
+	for (int y = y0; y < y1; y++)
+	{
+		FillSpan(GetColorRow(y) + x0, spanLength, fillColor);
+		FillSpan(reinterpret_cast<std::uint32_t*>(GetDepthRow(y)) + x0, spanLength, depthBits);
+	}
+}
+
+void Framebuffer::SavePpm(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw FBEXCEPT("Could not open " + path + " for writing");
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<std::uint8_t> row(static_cast<std::size_t>(width) * 3u);
+	for (int y = 0; y < height; y++)
+	{
+		const std::uint32_t* pSrc = color.data() + static_cast<std::size_t>(y) * width;
+		for (int x = 0; x < width; x++)
+		{
+			row[x * 3 + 0] = static_cast<std::uint8_t>(pSrc[x] >> 16);
+			row[x * 3 + 1] = static_cast<std::uint8_t>(pSrc[x] >> 8);
+			row[x * 3 + 2] = static_cast<std::uint8_t>(pSrc[x]);
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+	}
+	if (!file)
+	{
+		throw FBEXCEPT("Failed writing " + path);
+	}
+}
+
+void Framebuffer::SavePng(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw FBEXCEPT("Could not open " + path + " for writing");
+	}
+	static constexpr std::uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<std::uint8_t> header;
+	PutU32BE(header, static_cast<std::uint32_t>(width));
+	PutU32BE(header, static_cast<std::uint32_t>(height));
+	header.insert(header.end(), { 8u, 2u, 0u, 0u, 0u });	// 8 bit, truecolor, deflate, no filter, no interlace
+	WriteChunk(file, "IHDR", header);
+
+	// Raw scanlines: filter byte 0 followed by RGB
+	std::vector<std::uint8_t> raw;
+	raw.reserve(static_cast<std::size_t>(height) * (width * 3u + 1u));
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0u);
+		const std::uint32_t* pSrc = color.data() + static_cast<std::size_t>(y) * width;
+		for (int x = 0; x < width; x++)
+		{
+			raw.push_back(static_cast<std::uint8_t>(pSrc[x] >> 16));
+			raw.push_back(static_cast<std::uint8_t>(pSrc[x] >> 8));
+			raw.push_back(static_cast<std::uint8_t>(pSrc[x]));
+		}
+	}
+
+	// zlib stream made of stored blocks (max 65535 bytes each) + adler32
+	std::vector<std::uint8_t> zlib = { 0x78u, 0x01u };
+	std::size_t pos = 0u;
+	do
+	{
+		const std::size_t blockSize = std::min<std::size_t>(raw.size() - pos, 65535u);
+		const bool isFinal = pos + blockSize == raw.size();
+		zlib.push_back(isFinal ? 1u : 0u);
+		zlib.push_back(static_cast<std::uint8_t>(blockSize));
+		zlib.push_back(static_cast<std::uint8_t>(blockSize >> 8));
+		zlib.push_back(static_cast<std::uint8_t>(~blockSize));
+		zlib.push_back(static_cast<std::uint8_t>(~blockSize >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+		pos += blockSize;
+	} while (pos < raw.size());
+	std::uint32_t a = 1u;
+	std::uint32_t b = 0u;
+	for (const std::uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521u;
+		b = (b + a) % 65521u;
+	}
+	PutU32BE(zlib, (b << 16) | a);
+	WriteChunk(file, "IDAT", zlib);
+	WriteChunk(file, "IEND", {});
+	if (!file)
+	{
+		throw FBEXCEPT("Failed writing " + path);
+	}
+}
+
+std::uint32_t Framebuffer::PackColor(float red, float green, float blue, float alpha) noexcept
+{
+	const auto toByte = [](float c)
+	{
+		return static_cast<std::uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	};
+	return (toByte(alpha) << 24) | (toByte(red) << 16) | (toByte(green) << 8) | toByte(blue);
+}
+
+void Framebuffer::FillSpan(std::uint32_t* pDest, std::size_t count, std::uint32_t value) noexcept
+{
+	std::size_t i = 0u;
+#ifdef FRAMEBUFFER_SSE2
+	const __m128i wide = _mm_set1_epi32(static_cast<int>(value));
+	for (; i + 16u <= count; i += 16u)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), wide);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i + 4u), wide);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i + 8u), wide);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i + 12u), wide);
+	}
+	for (; i + 4u <= count; i += 4u)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), wide);
+	}
+#endif
+	// memcpy rather than a plain store since depth rows are really floats
+	for (; i < count; i++)
+	{
+		std::memcpy(pDest + i, &value, sizeof(value));
+	}
+}
+
+// Framebuffer Exceptions
+Framebuffer::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* Framebuffer::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* Framebuffer::Exception::GetType() const noexcept
+{
+	return "EggCeption: Framebuffer Exception";
+}
+
+const std::string& Framebuffer::Exception::GetNote() const noexcept
+{
+	return note;
+}
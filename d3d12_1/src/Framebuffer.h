@@ -0,0 +1,49 @@
+#pragma once
+
+#include "EggCeption.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* CPU-side color + depth target.
+* Color is packed 0xAARRGGBB (same layout as a 32bpp DIB) and depth is a
+* float in [0, 1], smaller is closer. Rows are tightly packed.
+*/
+class Framebuffer
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+public:
+	Framebuffer(int width, int height);
+	int GetWidth() const noexcept;
+	int GetHeight() const noexcept;
+	std::uint32_t* GetColorRow(int y) noexcept;
+	float* GetDepthRow(int y) noexcept;
+	const std::uint32_t* GetColorData() const noexcept;
+	std::uint32_t GetPixel(int x, int y) const noexcept;
+	void Clear(std::uint32_t color, float depth) noexcept;
+	// Fills [x0, x1) x [y0, y1) of both targets; used for per-tile clears
+	void FillRect(int x0, int y0, int x1, int y1, std::uint32_t color, float depth) noexcept;
+	// Dumps for golden-image comparisons
+	void SavePpm(const std::string& path) const;
+	void SavePng(const std::string& path) const;
+	static std::uint32_t PackColor(float red, float green, float blue, float alpha = 1.0f) noexcept;
+private:
+	static void FillSpan(std::uint32_t* pDest, std::size_t count, std::uint32_t value) noexcept;
+private:
+	int width;
+	int height;
+	std::vector<std::uint32_t> color;
+	std::vector<float> depth;
+};
+
+#define FBEXCEPT(note) Framebuffer::Exception(__LINE__, __FILE__, (note))
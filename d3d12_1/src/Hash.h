@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+/* 64-bit FNV-1a, for content hashes and cache keys.
+* Not cryptographic, but stable across runs, builds and platforms, so the
+* values can be written to disk. Feed fields one by one rather than whole
+* structs, so padding bytes never end up in the hash.
+*/
+class Fnv1a
+{
+public:
+	static constexpr std::uint64_t offsetBasis = 0xCBF29CE484222325ull;
+	static constexpr std::uint64_t prime = 0x100000001B3ull;
+public:
+	constexpr void Add(const void* pData, std::size_t size) noexcept
+	{
+		const auto* pBytes = static_cast<const unsigned char*>(pData);
+		for (std::size_t i = 0u; i < size; i++)
+		{
+			state = (state ^ pBytes[i]) * prime;
+		}
+	}
+	template<typename T>
+	constexpr void AddValue(const T& value) noexcept
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "hash struct fields individually");
+		Add(&value, sizeof(value));
+	}
+	// Length goes in first so ("ab", "c") and ("a", "bc") hash differently
+	constexpr void AddString(std::string_view s) noexcept
+	{
+		AddValue(static_cast<std::uint64_t>(s.size()));
+		Add(s.data(), s.size());
+	}
+	constexpr std::uint64_t Get() const noexcept
+	{
+		return state;
+	}
+private:
+	std::uint64_t state = offsetBasis;
+};
+
+inline std::uint64_t HashBytes(const void* pData, std::size_t size) noexcept
+{
+	Fnv1a hash;
+	hash.Add(pData, size);
+	return hash.Get();
+}
@@ -1,16 +1,34 @@
 #include "Window.h"
+#include "MemoryArena.h"
+#include "Fence.h"
+#include "UploadRing.h"
+#include "FrameContext.h"
 
 int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prevInstance, _In_ LPWSTR commandLine, _In_ int showCommand)
 {
 	try
 	{
 		Window window(800, 600, L"This is a test window");
-		MSG message;
-		BOOL g_result;
-		while ((g_result = GetMessage(&message, nullptr, 0, 0)) > 0)
+		using ArenaStringStream = std::basic_ostringstream<char, std::char_traits<char>, ArenaAllocator<char>>;
+		// No D3D12 queue yet, so GpuTimeline stands in for it and completes the fence.
+		// Declared before the frame manager so it outlives it (the manager waits on the GPU when destroyed).
+		// Each simulated frame takes one 60 Hz refresh, like a present waiting on vsync. BeginFrame blocks
+		// on the fence once two frames are queued, so the loop sleeps at the display rate instead of spinning.
+		Fence gpuFence;
+		GpuTimeline gpu(gpuFence, std::chrono::microseconds(16667));
+		FrameContextManager frames(gpuFence, 2u);
+		// Staging memory for CPU -> GPU uploads, recycled as the GPU fence advances
+		UploadRing uploadRing(4u * 1024u * 1024u, gpuFence);
+		while (true)
 		{
-			TranslateMessage(&message);
-			DispatchMessage(&message);
+			if (const auto exitCode = Window::ProcessMessages())
+			{
+				return *exitCode;
+			}
+
+			// Start of frame: blocks only if the GPU is 2 frames behind, then reclaim what it's done with
+			FrameContext& frame = frames.BeginFrame();
+			uploadRing.Retire(gpuFence.GetCompletedValue());
 
 			// TODO: Delete this test
 			while (!window.mouse.IsEmpty())
@@ -18,19 +36,20 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prevInstance, _I
 				const auto e = window.mouse.Read();
 				if (e.GetType() == Mouse::Event::Type::Move)
 				{
-					std::ostringstream oss;
+					ArenaStringStream oss(std::ios_base::out, ArenaAllocator<char>(frame.GetArena()));
 					oss << "Mouse position (" << e.GetXPos() << "," << e.GetYPos() << ")";
-					window.SetTitle(oss.str());
+					window.SetTitle(oss.str().c_str());
 				}
 			}
-		}
 
-		if (g_result == -1)
-		{
-			return -1;
-		}
+			window.Gfx().BeginFrame();
+			window.Gfx().ClearBuffer(0.0f, 0.0f, 0.0f);
+			window.Gfx().EndFrame();
 
-		return message.wParam;
+			const std::uint64_t frameFence = frames.EndFrame();
+			uploadRing.EndFrame(frameFence);
+			gpu.Submit(frameFence);
+		}
 	}
 	catch (const EggCeption& e)
 	{
@@ -46,4 +65,4 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prevInstance, _I
 		MessageBoxA(nullptr, "No details available", "Unknown Exception", MB_OK | MB_ICONEXCLAMATION);
 	}
 	return -1;
-}
\ No newline at end of file
+}
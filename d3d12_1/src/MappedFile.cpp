@@ -0,0 +1,179 @@
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <utility>
+
+#if defined(_WIN32)
+#include "WinDefines.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+	const HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		throw MFEXCEPT("Could not open " + path);
+	}
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(hFile, &fileSize))
+	{
+		CloseHandle(hFile);
+		throw MFEXCEPT("Could not get the size of " + path);
+	}
+	if (fileSize.QuadPart > 0)
+	{
+		// The view keeps the mapping alive, so both handles can go as soon as it exists
+		const HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+		CloseHandle(hFile);
+		if (!hMapping)
+		{
+			throw MFEXCEPT("Could not create a mapping for " + path);
+		}
+		void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0u, 0u, 0u);
+		CloseHandle(hMapping);
+		if (!pView)
+		{
+			throw MFEXCEPT("Could not map " + path);
+		}
+		pData = static_cast<const std::byte*>(pView);
+		size = static_cast<std::size_t>(fileSize.QuadPart);
+	}
+	else
+	{
+		CloseHandle(hFile);
+	}
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw MFEXCEPT("Could not open " + path);
+	}
+	struct stat info = {};
+	if (::fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		throw MFEXCEPT("Could not get the size of " + path);
+	}
+	if (info.st_size > 0)
+	{
+		void* pView = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping holds its own reference to the file
+		::close(fd);
+		if (pView == MAP_FAILED)
+		{
+			throw MFEXCEPT("Could not map " + path);
+		}
+		pData = static_cast<const std::byte*>(pView);
+		size = static_cast<std::size_t>(info.st_size);
+	}
+	else
+	{
+		::close(fd);
+	}
+#endif
+	open = true;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& donor) noexcept
+	:
+	pData(std::exchange(donor.pData, nullptr)),
+	size(std::exchange(donor.size, 0u)),
+	open(std::exchange(donor.open, false))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& donor) noexcept
+{
+	if (this != &donor)
+	{
+		Close();
+		pData = std::exchange(donor.pData, nullptr);
+		size = std::exchange(donor.size, 0u);
+		open = std::exchange(donor.open, false);
+	}
+	return *this;
+}
+
+bool MappedFile::IsOpen() const noexcept
+{
+	return open;
+}
+
+const std::byte* MappedFile::GetData() const noexcept
+{
+	return pData;
+}
+
+std::size_t MappedFile::GetSize() const noexcept
+{
+	return size;
+}
+
+std::span<const std::byte> MappedFile::GetBytes() const noexcept
+{
+	return { pData, size };
+}
+
+void MappedFile::Close() noexcept
+{
+	if (pData)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(pData);
+#else
+		::munmap(const_cast<std::byte*>(pData), size);
+#endif
+	}
+	pData = nullptr;
+	size = 0u;
+	open = false;
+}
+
+std::string MakeTempPath(const std::string& path)
+{
+	static std::atomic<std::uint64_t> counter{ 0u };
+#if defined(_WIN32)
+	const unsigned long processId = GetCurrentProcessId();
+#else
+	const unsigned long processId = static_cast<unsigned long>(::getpid());
+#endif
+	return path + "." + std::to_string(processId) + "." + std::to_string(counter.fetch_add(1u, std::memory_order_relaxed)) + ".tmp";
+}
+
+// Mapped file exception stuff
+MappedFile::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* MappedFile::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* MappedFile::Exception::GetType() const noexcept
+{
+	return "EggCeption: Mapped File Exception";
+}
+
+const std::string& MappedFile::Exception::GetNote() const noexcept
+{
+	return note;
+}
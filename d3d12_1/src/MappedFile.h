@@ -0,0 +1,51 @@
+#pragma once
+
+#include "EggCeption.h"
+#include <cstddef>
+#include <span>
+#include <string>
+
+/* Read-only memory mapping of a whole file.
+* The OS pages data in on first touch, so opening is cheap no matter how
+* big the file is, and the mapping starts on a page boundary, which makes
+* it safe to use aligned structures in place. Empty files map to an empty
+* span.
+*/
+class MappedFile
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(MappedFile&& donor) noexcept;
+	MappedFile& operator=(MappedFile&& donor) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool IsOpen() const noexcept;
+	const std::byte* GetData() const noexcept;
+	std::size_t GetSize() const noexcept;
+	std::span<const std::byte> GetBytes() const noexcept;
+private:
+	void Close() noexcept;
+private:
+	const std::byte* pData = nullptr;
+	std::size_t size = 0u;
+	bool open = false;
+};
+
+// A sibling of path to write before renaming it over path. Unique per process and per call,
+// so threads or processes writing the same file at once never share (or truncate) a temp file.
+std::string MakeTempPath(const std::string& path);
+
+#define MFEXCEPT(note) MappedFile::Exception(__LINE__, __FILE__, (note))
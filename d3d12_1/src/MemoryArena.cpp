@@ -0,0 +1,81 @@
+#include "MemoryArena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+LinearArena::LinearArena(std::size_t capacity)
+	:
+	memory(std::make_unique<std::byte[]>(capacity))
+{
+	stats.capacity = capacity;
+#ifdef _DEBUG
+	std::memset(memory.get(), deadPattern, capacity);
+#endif
+}
+
+void* LinearArena::TryAllocate(std::size_t size, std::size_t alignment) noexcept
+{
+	assert(alignment != 0u && (alignment & (alignment - 1u)) == 0u && "alignment must be a power of 2");
+	// Align the actual address, not just the offset, since the block itself is only max_align_t aligned
+	const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(memory.get());
+	const std::uintptr_t aligned = (base + offset + (alignment - 1u)) & ~static_cast<std::uintptr_t>(alignment - 1u);
+	const std::size_t start = static_cast<std::size_t>(aligned - base);
+	if (start > stats.capacity || size > stats.capacity - start)
+	{
+		stats.failedCount++;
+		return nullptr;
+	}
+	offset = start + size;
+	stats.used = offset;
+	stats.highWaterMark = std::max(stats.highWaterMark, offset);
+	stats.allocationCount++;
+	void* p = memory.get() + start;
+#ifdef _DEBUG
+	std::memset(p, cleanPattern, size);
+#endif
+	return p;
+}
+
+void* LinearArena::Allocate(std::size_t size, std::size_t alignment)
+{
+	void* p = TryAllocate(size, alignment);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+LinearArena::Marker LinearArena::GetMarker() const noexcept
+{
+	return offset;
+}
+
+void LinearArena::RewindTo(Marker marker) noexcept
+{
+	assert(marker <= offset && "marker is ahead of the arena");
+#ifdef _DEBUG
+	std::memset(memory.get() + marker, deadPattern, offset - marker);
+#endif
+	offset = marker;
+	stats.used = offset;
+}
+
+void LinearArena::Reset() noexcept
+{
+	RewindTo(0u);
+	stats.allocationCount = 0u;
+}
+
+bool LinearArena::Owns(const void* p) const noexcept
+{
+	const std::byte* pByte = static_cast<const std::byte*>(p);
+	return pByte >= memory.get() && pByte < memory.get() + stats.capacity;
+}
+
+const LinearArena::Stats& LinearArena::GetStats() const noexcept
+{
+	return stats;
+}
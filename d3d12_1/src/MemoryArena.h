@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/* Linear (bump) allocator for transient data.
+* Allocation just moves an offset forward inside one big block, and
+* everything is released at once with Reset(). There is no per-object
+* free - objects placed in the arena must be trivially destructible or
+* have their destructors called by whoever owns them.
+*/
+class LinearArena
+{
+public:
+	struct Stats
+	{
+		std::size_t capacity = 0u;
+		std::size_t used = 0u;				// bytes handed out since last Reset (incl. alignment padding)
+		std::size_t highWaterMark = 0u;		// largest "used" ever seen - use this to size the arena
+		std::size_t allocationCount = 0u;	// allocations since last Reset
+		std::size_t failedCount = 0u;		// allocations that didn't fit (lifetime)
+	};
+	// Marker to roll the arena back to an earlier point (scoped scratch allocations)
+	using Marker = std::size_t;
+public:
+	explicit LinearArena(std::size_t capacity);
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+	// Returns nullptr if the arena is exhausted
+	void* TryAllocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+	// Throws std::bad_alloc if the arena is exhausted
+	void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+	template<typename T>
+	T* AllocateArray(std::size_t count);
+	Marker GetMarker() const noexcept;
+	void RewindTo(Marker marker) noexcept;
+	void Reset() noexcept;
+	bool Owns(const void* p) const noexcept;
+	const Stats& GetStats() const noexcept;
+private:
+	// Debug-only fill patterns, same values the MSVC debug CRT uses
+	static constexpr unsigned char cleanPattern = 0xCD;	// freshly allocated, not yet written
+	static constexpr unsigned char deadPattern = 0xDD;	// released by Reset/RewindTo
+	std::unique_ptr<std::byte[]> memory;
+	std::size_t offset = 0u;
+	Stats stats;
+};
+
+/* STL allocator adapter so containers can live in a LinearArena.
+* deallocate() is a no-op; the memory comes back when the arena resets,
+* so the container must not outlive the arena's current frame.
+*/
+template<typename T>
+class ArenaAllocator
+{
+	template<typename U>
+	friend class ArenaAllocator;
+public:
+	using value_type = T;
+public:
+	explicit ArenaAllocator(LinearArena& arena) noexcept
+		:
+		pArena(&arena)
+	{}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+		:
+		pArena(other.pArena)
+	{}
+	T* allocate(std::size_t n)
+	{
+		return pArena->AllocateArray<T>(n);
+	}
+	void deallocate(T*, std::size_t) noexcept
+	{}
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& rhs) const noexcept
+	{
+		return pArena == rhs.pArena;
+	}
+	LinearArena& GetArena() const noexcept
+	{
+		return *pArena;
+	}
+private:
+	LinearArena* pArena;
+};
+
+template<typename T>
+inline T* LinearArena::AllocateArray(std::size_t count)
+{
+	if (count > static_cast<std::size_t>(-1) / sizeof(T))
+	{
+		throw std::bad_alloc();
+	}
+	return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+}
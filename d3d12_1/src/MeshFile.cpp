@@ -0,0 +1,211 @@
+#include "MeshFile.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static_assert(std::endian::native == std::endian::little, "mesh files are little endian");
+
+namespace
+{
+	constexpr std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment) noexcept
+	{
+		return (value + alignment - 1u) & ~(alignment - 1u);
+	}
+
+	// Overflow-safe check that [offset, offset + size) sits inside the file and starts aligned
+	bool SectionFits(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize, std::uint64_t alignment) noexcept
+	{
+		return offset % alignment == 0u && offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+// Mesh view stuff
+MeshView MeshView::Parse(std::span<const std::byte> bytes)
+{
+	if (bytes.size() < sizeof(MeshFileHeader))
+	{
+		throw MESHEXCEPT("File too small for a mesh header");
+	}
+	if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(MeshFileHeader) != 0u)
+	{
+		throw MESHEXCEPT("Mesh image is misaligned");
+	}
+	const auto* pHeader = reinterpret_cast<const MeshFileHeader*>(bytes.data());
+	if (std::memcmp(pHeader->magic, meshFileMagic, sizeof(meshFileMagic)) != 0)
+	{
+		throw MESHEXCEPT("Not a mesh file (bad magic)");
+	}
+	if (pHeader->version != meshFileVersion)
+	{
+		throw MESHEXCEPT("Unsupported mesh file version " + std::to_string(pHeader->version) + ", expected " + std::to_string(meshFileVersion));
+	}
+	if (pHeader->headerSize != sizeof(MeshFileHeader) || pHeader->vertexStride != sizeof(MeshVertex))
+	{
+		throw MESHEXCEPT("Mesh header or vertex layout doesn't match this build");
+	}
+	if (pHeader->fileSize != bytes.size())
+	{
+		throw MESHEXCEPT("Mesh file is truncated or has trailing data");
+	}
+	const std::uint64_t fileSize = pHeader->fileSize;
+	if (!SectionFits(pHeader->vertexOffset, std::uint64_t(pHeader->vertexCount) * sizeof(MeshVertex), fileSize, meshBlobAlignment) ||
+		!SectionFits(pHeader->indexOffset, std::uint64_t(pHeader->indexCount) * sizeof(std::uint32_t), fileSize, meshBlobAlignment) ||
+		!SectionFits(pHeader->submeshOffset, std::uint64_t(pHeader->submeshCount) * sizeof(MeshSubmesh), fileSize, meshBlobAlignment) ||
+		!SectionFits(pHeader->stringTableOffset, pHeader->stringTableSize, fileSize, 1u))
+	{
+		throw MESHEXCEPT("Mesh section out of bounds or misaligned");
+	}
+
+	MeshView view;
+	view.pHeader = pHeader;
+	view.vertices = { reinterpret_cast<const MeshVertex*>(bytes.data() + pHeader->vertexOffset), pHeader->vertexCount };
+	view.indices = { reinterpret_cast<const std::uint32_t*>(bytes.data() + pHeader->indexOffset), pHeader->indexCount };
+	view.submeshes = { reinterpret_cast<const MeshSubmesh*>(bytes.data() + pHeader->submeshOffset), pHeader->submeshCount };
+	view.strings = { reinterpret_cast<const char*>(bytes.data() + pHeader->stringTableOffset), pHeader->stringTableSize };
+	for (const MeshSubmesh& submesh : view.submeshes)
+	{
+		if (std::uint64_t(submesh.indexStart) + submesh.indexCount > pHeader->indexCount ||
+			std::uint64_t(submesh.nameOffset) + submesh.nameLength > pHeader->stringTableSize)
+		{
+			throw MESHEXCEPT("Mesh submesh table refers outside the file");
+		}
+	}
+	return view;
+}
+
+std::span<const MeshVertex> MeshView::GetVertices() const noexcept
+{
+	return vertices;
+}
+
+std::span<const std::uint32_t> MeshView::GetIndices() const noexcept
+{
+	return indices;
+}
+
+std::span<const MeshSubmesh> MeshView::GetSubmeshes() const noexcept
+{
+	return submeshes;
+}
+
+std::string_view MeshView::GetSubmeshName(std::size_t submesh) const noexcept
+{
+	return strings.substr(submeshes[submesh].nameOffset, submeshes[submesh].nameLength);
+}
+
+const MeshBounds& MeshView::GetBounds() const noexcept
+{
+	return pHeader->bounds;
+}
+
+bool MeshView::ValidateIndices() const noexcept
+{
+	// OR-reduce instead of early out so the loop vectorizes
+	const std::uint32_t vertexCount = static_cast<std::uint32_t>(vertices.size());
+	bool outOfRange = false;
+	for (const std::uint32_t index : indices)
+	{
+		outOfRange |= index >= vertexCount;
+	}
+	return !outOfRange;
+}
+
+// Mesh file stuff
+MeshFile::MeshFile(const std::string& path)
+	:
+	file(path),
+	view(MeshView::Parse(file.GetBytes()))
+{}
+
+const MeshView& MeshFile::View() const noexcept
+{
+	return view;
+}
+
+std::vector<std::byte> MeshFile::Serialize(const MeshData& mesh)
+{
+	std::string strings;
+	std::vector<MeshSubmesh> submeshes;
+	submeshes.reserve(mesh.submeshes.size());
+	for (const auto& submesh : mesh.submeshes)
+	{
+		submeshes.push_back({ submesh.indexStart, submesh.indexCount,
+			static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(submesh.material.size()), submesh.bounds });
+		strings += submesh.material;
+	}
+
+	MeshFileHeader header = {};
+	std::memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+	header.version = meshFileVersion;
+	header.headerSize = sizeof(MeshFileHeader);
+	header.vertexStride = sizeof(MeshVertex);
+	header.vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+	header.submeshCount = static_cast<std::uint32_t>(submeshes.size());
+	header.stringTableSize = static_cast<std::uint32_t>(strings.size());
+	header.vertexOffset = AlignUp(sizeof(MeshFileHeader), meshBlobAlignment);
+	header.indexOffset = AlignUp(header.vertexOffset + mesh.vertices.size() * sizeof(MeshVertex), meshBlobAlignment);
+	header.submeshOffset = AlignUp(header.indexOffset + mesh.indices.size() * sizeof(std::uint32_t), meshBlobAlignment);
+	header.stringTableOffset = header.submeshOffset + submeshes.size() * sizeof(MeshSubmesh);
+	header.fileSize = header.stringTableOffset + strings.size();
+	header.bounds = mesh.bounds;
+
+	// Zero-filled so the padding is deterministic and files diff cleanly
+	std::vector<std::byte> image(static_cast<std::size_t>(header.fileSize));
+	const auto put = [&image](std::uint64_t offset, const void* pData, std::size_t size)
+	{
+		if (size > 0u)
+		{
+			std::memcpy(image.data() + offset, pData, size);
+		}
+	};
+	put(0u, &header, sizeof(header));
+	put(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex));
+	put(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t));
+	put(header.submeshOffset, submeshes.data(), submeshes.size() * sizeof(MeshSubmesh));
+	put(header.stringTableOffset, strings.data(), strings.size());
+	return image;
+}
+
+void MeshFile::Write(const MeshData& mesh, const std::string& path)
+{
+	const std::vector<std::byte> image = Serialize(mesh);
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw MESHEXCEPT("Could not open " + path + " for writing");
+	}
+	file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+	if (!file)
+	{
+		throw MESHEXCEPT("Failed writing " + path);
+	}
+}
+
+// Mesh file exception stuff
+MeshFile::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* MeshFile::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* MeshFile::Exception::GetType() const noexcept
+{
+	return "EggCeption: Mesh File Exception";
+}
+
+const std::string& MeshFile::Exception::GetNote() const noexcept
+{
+	return note;
+}
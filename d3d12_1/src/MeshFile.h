@@ -0,0 +1,143 @@
+#pragma once
+
+#include "EggCeption.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/* Binary mesh container (.emesh), built to be memory mapped and used in place.
+*
+*   MeshFileHeader
+*   vertex blob     MeshVertex[vertexCount]
+*   index blob      uint32[indexCount]
+*   submesh table   MeshSubmesh[submeshCount]
+*   string table    material names, not null terminated
+*
+* The vertex, index and submesh blobs start on a meshBlobAlignment boundary,
+* and every section is located by a byte offset from the start of the file,
+* so nothing needs patching after load.
+* Little endian only. Bump meshFileVersion whenever any of these structs
+* change; older files are rejected rather than converted.
+*/
+
+constexpr char meshFileMagic[4] = { 'E', 'M', 'S', 'H' };
+constexpr std::uint32_t meshFileVersion = 1u;
+constexpr std::size_t meshBlobAlignment = 64u;
+
+struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct MeshBounds
+{
+	float min[3];
+	float max[3];
+};
+
+struct MeshSubmesh
+{
+	std::uint32_t indexStart;
+	std::uint32_t indexCount;
+	std::uint32_t nameOffset;	// into the string table
+	std::uint32_t nameLength;
+	MeshBounds bounds;
+};
+
+struct MeshFileHeader
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t headerSize;
+	std::uint32_t vertexStride;
+	std::uint64_t fileSize;
+	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	std::uint32_t submeshCount;
+	std::uint32_t stringTableSize;
+	std::uint64_t vertexOffset;
+	std::uint64_t indexOffset;
+	std::uint64_t submeshOffset;
+	std::uint64_t stringTableOffset;
+	MeshBounds bounds;
+};
+
+static_assert(std::is_trivially_copyable_v<MeshFileHeader> && std::is_trivially_copyable_v<MeshSubmesh> && std::is_trivially_copyable_v<MeshVertex>);
+static_assert(sizeof(MeshVertex) == 32u && sizeof(MeshSubmesh) == 40u && sizeof(MeshFileHeader) == 96u, "on-disk layout changed, bump meshFileVersion");
+
+// Owning, editable mesh; what importers produce and the writer consumes
+struct MeshData
+{
+	struct Submesh
+	{
+		std::string material;
+		std::uint32_t indexStart = 0u;
+		std::uint32_t indexCount = 0u;
+		MeshBounds bounds = {};
+	};
+	std::vector<MeshVertex> vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<Submesh> submeshes;
+	MeshBounds bounds = {};
+};
+
+/* Non-owning view of an .emesh image in memory.
+* Parse() checks the header and every table against the buffer size, so
+* the spans it hands out are always in bounds. Index values themselves
+* aren't scanned (that would touch the whole blob); call ValidateIndices()
+* for untrusted files.
+*/
+class MeshView
+{
+public:
+	MeshView() = default;
+	// bytes must stay alive as long as the view, and start 8-byte aligned (mappings and new[] are)
+	static MeshView Parse(std::span<const std::byte> bytes);
+	std::span<const MeshVertex> GetVertices() const noexcept;
+	std::span<const std::uint32_t> GetIndices() const noexcept;
+	std::span<const MeshSubmesh> GetSubmeshes() const noexcept;
+	std::string_view GetSubmeshName(std::size_t submesh) const noexcept;
+	const MeshBounds& GetBounds() const noexcept;
+	// True if every index refers to an existing vertex
+	bool ValidateIndices() const noexcept;
+private:
+	const MeshFileHeader* pHeader = nullptr;
+	std::span<const MeshVertex> vertices;
+	std::span<const std::uint32_t> indices;
+	std::span<const MeshSubmesh> submeshes;
+	std::string_view strings;
+};
+
+// An .emesh file mapped into memory; the view stays valid for the object's lifetime
+class MeshFile
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+public:
+	explicit MeshFile(const std::string& path);
+	const MeshView& View() const noexcept;
+	// Builds the .emesh image for mesh
+	static std::vector<std::byte> Serialize(const MeshData& mesh);
+	static void Write(const MeshData& mesh, const std::string& path);
+private:
+	MappedFile file;
+	MeshView view;
+};
+
+#define MESHEXCEPT(note) MeshFile::Exception(__LINE__, __FILE__, (note))
@@ -0,0 +1,330 @@
+#include "ObjImporter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+	// Zero-based position/uv/normal indices of one face corner, -1 if absent
+	struct CornerKey
+	{
+		std::int32_t position;
+		std::int32_t uv;
+		std::int32_t normal;
+		bool operator==(const CornerKey& rhs) const noexcept
+		{
+			return position == rhs.position && uv == rhs.uv && normal == rhs.normal;
+		}
+	};
+
+	struct CornerKeyHash
+	{
+		std::size_t operator()(const CornerKey& key) const noexcept
+		{
+			std::uint64_t h = static_cast<std::uint32_t>(key.position);
+			h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.uv);
+			h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.normal);
+			return static_cast<std::size_t>(h ^ (h >> 32u));
+		}
+	};
+
+	class ObjParser
+	{
+	public:
+		MeshData Parse(std::string_view text)
+		{
+			for (std::size_t lineStart = 0u; lineStart < text.size(); lineNumber++)
+			{
+				std::size_t lineEnd = text.find('\n', lineStart);
+				if (lineEnd == std::string_view::npos)
+				{
+					lineEnd = text.size();
+				}
+				line = text.substr(lineStart, lineEnd - lineStart);
+				lineStart = lineEnd + 1u;
+				if (const std::size_t comment = line.find('#'); comment != std::string_view::npos)
+				{
+					line = line.substr(0u, comment);
+				}
+				ParseLine();
+			}
+			Finish();
+			return std::move(mesh);
+		}
+	private:
+		void ParseLine()
+		{
+			const std::string_view keyword = NextToken();
+			if (keyword == "v")
+			{
+				positions.push_back(NextFloat());
+				positions.push_back(NextFloat());
+				positions.push_back(NextFloat());
+			}
+			else if (keyword == "vt")
+			{
+				uvs.push_back(NextFloat());
+				// v is optional in the spec
+				uvs.push_back(PeekToken().empty() ? 0.0f : NextFloat());
+			}
+			else if (keyword == "vn")
+			{
+				normals.push_back(NextFloat());
+				normals.push_back(NextFloat());
+				normals.push_back(NextFloat());
+			}
+			else if (keyword == "f")
+			{
+				ParseFace();
+			}
+			else if (keyword == "usemtl")
+			{
+				BeginSubmesh(std::string(Trim(line)));
+			}
+		}
+
+		void ParseFace()
+		{
+			corners.clear();
+			for (std::string_view token = NextToken(); !token.empty(); token = NextToken())
+			{
+				corners.push_back(GetVertex(ParseCorner(token)));
+			}
+			if (corners.size() < 3u)
+			{
+				Fail("face with fewer than 3 corners");
+			}
+			if (mesh.submeshes.empty())
+			{
+				BeginSubmesh({});
+			}
+			// Fan triangulation, fine for the convex polygons exporters write
+			for (std::size_t i = 1u; i + 1u < corners.size(); i++)
+			{
+				mesh.indices.push_back(corners[0]);
+				mesh.indices.push_back(corners[i]);
+				mesh.indices.push_back(corners[i + 1u]);
+			}
+			mesh.submeshes.back().indexCount = static_cast<std::uint32_t>(mesh.indices.size()) - mesh.submeshes.back().indexStart;
+		}
+
+		// "v", "v/t", "v//n" or "v/t/n"
+		CornerKey ParseCorner(std::string_view token)
+		{
+			CornerKey key = { -1, -1, -1 };
+			std::int32_t* fields[3] = { &key.position, &key.uv, &key.normal };
+			const std::size_t counts[3] = { positions.size() / 3u, uvs.size() / 2u, normals.size() / 3u };
+			for (int field = 0; field < 3 && !token.empty(); field++)
+			{
+				const std::size_t slash = std::min(token.find('/'), token.size());
+				const std::string_view part = token.substr(0u, slash);
+				token = token.substr(std::min(slash + 1u, token.size()));
+				if (part.empty())
+				{
+					if (field == 0)
+					{
+						Fail("face corner without a position");
+					}
+					continue;
+				}
+				std::int64_t index = 0;
+				const auto [pEnd, error] = std::from_chars(part.data(), part.data() + part.size(), index);
+				if (error != std::errc() || pEnd != part.data() + part.size() || index == 0)
+				{
+					Fail("bad face index");
+				}
+				// 1-based, or negative counting back from the latest element
+				index = index > 0 ? index - 1 : static_cast<std::int64_t>(counts[field]) + index;
+				if (index < 0 || index >= static_cast<std::int64_t>(counts[field]))
+				{
+					Fail("face index out of range");
+				}
+				*fields[field] = static_cast<std::int32_t>(index);
+			}
+			return key;
+		}
+
+		std::uint32_t GetVertex(const CornerKey& key)
+		{
+			const auto [it, inserted] = vertexLookup.try_emplace(key, static_cast<std::uint32_t>(mesh.vertices.size()));
+			if (inserted)
+			{
+				MeshVertex vertex = {};
+				std::copy_n(&positions[key.position * 3u], 3u, vertex.position);
+				if (key.uv >= 0)
+				{
+					vertex.uv[0] = uvs[key.uv * 2u];
+					// OBJ has v pointing up, D3D has it pointing down
+					vertex.uv[1] = 1.0f - uvs[key.uv * 2u + 1u];
+				}
+				if (key.normal >= 0)
+				{
+					std::copy_n(&normals[key.normal * 3u], 3u, vertex.normal);
+				}
+				mesh.vertices.push_back(vertex);
+			}
+			return it->second;
+		}
+
+		void BeginSubmesh(std::string material)
+		{
+			// A usemtl before any faces just renames the current submesh
+			if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0u)
+			{
+				mesh.submeshes.back().material = std::move(material);
+				return;
+			}
+			MeshData::Submesh submesh;
+			submesh.material = std::move(material);
+			submesh.indexStart = static_cast<std::uint32_t>(mesh.indices.size());
+			mesh.submeshes.push_back(std::move(submesh));
+		}
+
+		void Finish()
+		{
+			std::erase_if(mesh.submeshes, [](const MeshData::Submesh& submesh) { return submesh.indexCount == 0u; });
+			if (normals.empty())
+			{
+				GenerateNormals();
+			}
+			mesh.bounds = ComputeBounds(0u, mesh.indices.size());
+			for (auto& submesh : mesh.submeshes)
+			{
+				submesh.bounds = ComputeBounds(submesh.indexStart, submesh.indexCount);
+			}
+		}
+
+		// Area-weighted average of the adjacent face normals
+		void GenerateNormals()
+		{
+			for (std::size_t i = 0u; i + 2u < mesh.indices.size(); i += 3u)
+			{
+				MeshVertex& a = mesh.vertices[mesh.indices[i]];
+				MeshVertex& b = mesh.vertices[mesh.indices[i + 1u]];
+				MeshVertex& c = mesh.vertices[mesh.indices[i + 2u]];
+				float e0[3], e1[3];
+				for (int k = 0; k < 3; k++)
+				{
+					e0[k] = b.position[k] - a.position[k];
+					e1[k] = c.position[k] - a.position[k];
+				}
+				// OBJ faces wind counter-clockwise, so e0 x e1 points out of the front
+				const float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+				for (MeshVertex* pVertex : { &a, &b, &c })
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						pVertex->normal[k] += n[k];
+					}
+				}
+			}
+			for (MeshVertex& vertex : mesh.vertices)
+			{
+				const float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+				if (length > 0.0f)
+				{
+					for (float& component : vertex.normal)
+					{
+						component /= length;
+					}
+				}
+			}
+		}
+
+		MeshBounds ComputeBounds(std::size_t indexStart, std::size_t indexCount) const noexcept
+		{
+			if (indexCount == 0u)
+			{
+				return {};
+			}
+			MeshBounds bounds = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+			for (std::size_t i = indexStart; i < indexStart + indexCount; i++)
+			{
+				const MeshVertex& vertex = mesh.vertices[mesh.indices[i]];
+				for (int k = 0; k < 3; k++)
+				{
+					bounds.min[k] = std::min(bounds.min[k], vertex.position[k]);
+					bounds.max[k] = std::max(bounds.max[k], vertex.position[k]);
+				}
+			}
+			return bounds;
+		}
+
+		static std::string_view Trim(std::string_view s) noexcept
+		{
+			const std::size_t first = s.find_first_not_of(" \t\r");
+			if (first == std::string_view::npos)
+			{
+				return {};
+			}
+			return s.substr(first, s.find_last_not_of(" \t\r") - first + 1u);
+		}
+
+		std::string_view PeekToken() const noexcept
+		{
+			const std::size_t start = line.find_first_not_of(" \t\r");
+			if (start == std::string_view::npos)
+			{
+				return {};
+			}
+			const std::size_t end = std::min(line.find_first_of(" \t\r", start), line.size());
+			return line.substr(start, end - start);
+		}
+
+		std::string_view NextToken() noexcept
+		{
+			const std::string_view token = PeekToken();
+			if (!token.empty())
+			{
+				line = line.substr(token.data() + token.size() - line.data());
+			}
+			return token;
+		}
+
+		float NextFloat()
+		{
+			const std::string_view token = NextToken();
+			float value = 0.0f;
+			const auto [pEnd, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+			if (token.empty() || error != std::errc() || pEnd != token.data() + token.size())
+			{
+				Fail("expected a number");
+			}
+			return value;
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			throw MESHEXCEPT("OBJ line " + std::to_string(lineNumber) + ": " + message);
+		}
+	private:
+		MeshData mesh;
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+		std::unordered_map<CornerKey, std::uint32_t, CornerKeyHash> vertexLookup;
+		std::vector<std::uint32_t> corners;
+		std::string_view line;
+		std::size_t lineNumber = 1u;
+	};
+}
+
+MeshData ParseObj(std::string_view text)
+{
+	return ObjParser().Parse(text);
+}
+
+MeshData ImportObj(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw MESHEXCEPT("Could not open " + path);
+	}
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return ParseObj(contents.str());
+}
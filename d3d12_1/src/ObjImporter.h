@@ -0,0 +1,17 @@
+#pragma once
+
+#include "MeshFile.h"
+#include <string>
+#include <string_view>
+
+/* Wavefront OBJ to MeshData, for offline conversion to .emesh.
+* Handles v/vt/vn/f (polygons are fan triangulated, negative indices are
+* relative), and starts a new submesh on every usemtl. Identical
+* position/uv/normal triples are welded into one vertex. If the file has no
+* normals at all, smooth ones are generated. UVs are flipped to a top-left
+* origin; positions and winding are kept as authored. Everything else
+* (groups, smoothing groups, lines, mtllib) is ignored.
+* Malformed input throws MeshFile::Exception.
+*/
+MeshData ParseObj(std::string_view text);
+MeshData ImportObj(const std::string& path);
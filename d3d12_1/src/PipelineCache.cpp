@@ -0,0 +1,677 @@
+#include "PipelineCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+namespace
+{
+	// Bump when the file layout or Normalize() changes
+	constexpr std::uint32_t formatVersion = 1u;
+	constexpr char cacheMagic[4] = { 'E', 'P', 'S', 'O' };
+	constexpr std::uint32_t maxInputElements = 32u;
+
+	struct CacheHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t compilerVersion;
+		std::uint32_t entryCount;
+		std::uint32_t reserved;
+		std::uint64_t payloadSize;
+		std::uint64_t payloadHash;
+	};
+	static_assert(sizeof(CacheHeader) == 40u);
+
+	// One field list for hashing, writing and reading, so the three can't drift apart
+	template<typename Desc, typename Visitor>
+	void VisitDesc(Desc& desc, Visitor& visitor)
+	{
+		visitor.Value(desc.kind);
+		visitor.Value(desc.rootSignature);
+		visitor.Value(desc.vertexShader);
+		visitor.Value(desc.pixelShader);
+		visitor.Value(desc.computeShader);
+		visitor.Count(desc.inputLayout, maxInputElements);
+		for (auto& element : desc.inputLayout)
+		{
+			visitor.String(element.semantic);
+			visitor.Value(element.semanticIndex);
+			visitor.Value(element.format);
+			visitor.Value(element.slot);
+			visitor.Value(element.offset);
+		}
+		visitor.Value(desc.topology);
+		visitor.Value(desc.fill);
+		visitor.Value(desc.cull);
+		visitor.Value(desc.frontCounterClockwise);
+		visitor.Value(desc.depthBias);
+		visitor.Value(desc.slopeScaledDepthBias);
+		visitor.Value(desc.depthEnable);
+		visitor.Value(desc.depthWrite);
+		visitor.Value(desc.depthFunc);
+		visitor.Value(desc.renderTargetCount);
+		for (auto& format : desc.renderTargetFormats)
+		{
+			visitor.Value(format);
+		}
+		for (auto& blend : desc.blend)
+		{
+			visitor.Value(blend.enable);
+			visitor.Value(blend.src);
+			visitor.Value(blend.dest);
+			visitor.Value(blend.op);
+			visitor.Value(blend.srcAlpha);
+			visitor.Value(blend.destAlpha);
+			visitor.Value(blend.alphaOp);
+			visitor.Value(blend.writeMask);
+		}
+		visitor.Value(desc.depthFormat);
+		visitor.Value(desc.sampleCount);
+	}
+
+	class KeyVisitor
+	{
+	public:
+		template<typename T>
+		void Value(const T& value) noexcept
+		{
+			hash.AddValue(value);
+		}
+		void String(const std::string& s) noexcept
+		{
+			hash.AddString(s);
+		}
+		template<typename T>
+		void Count(const std::vector<T>& items, std::uint32_t) noexcept
+		{
+			hash.AddValue(static_cast<std::uint32_t>(items.size()));
+		}
+	public:
+		Fnv1a hash;
+	};
+
+	class WriteVisitor
+	{
+	public:
+		explicit WriteVisitor(std::vector<std::byte>& bytes) noexcept
+			:
+			bytes(bytes)
+		{}
+		template<typename T>
+		void Value(const T& value)
+		{
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+			Bytes(&value, sizeof(value));
+		}
+		void String(const std::string& s)
+		{
+			Value(static_cast<std::uint64_t>(s.size()));
+			Bytes(s.data(), s.size());
+		}
+		template<typename T>
+		void Count(const std::vector<T>& items, std::uint32_t)
+		{
+			Value(static_cast<std::uint32_t>(items.size()));
+		}
+		void Bytes(const void* pData, std::size_t size)
+		{
+			const auto* pBytes = static_cast<const std::byte*>(pData);
+			bytes.insert(bytes.end(), pBytes, pBytes + size);
+		}
+	private:
+		std::vector<std::byte>& bytes;
+	};
+
+	// Bounds-checked; throws on anything that would run off the end
+	class ReadVisitor
+	{
+	public:
+		explicit ReadVisitor(std::span<const std::byte> bytes) noexcept
+			:
+			bytes(bytes)
+		{}
+		template<typename T>
+		void Value(T& value)
+		{
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				// Any byte other than 0/1 would be an invalid bool
+				std::uint8_t byte;
+				Value(byte);
+				value = byte != 0u;
+			}
+			else
+			{
+				std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+			}
+		}
+		void String(std::string& s)
+		{
+			std::uint64_t size;
+			Value(size);
+			const std::span<const std::byte> chars = Take(size);
+			s.assign(reinterpret_cast<const char*>(chars.data()), chars.size());
+		}
+		template<typename T>
+		void Count(std::vector<T>& items, std::uint32_t limit)
+		{
+			std::uint32_t count;
+			Value(count);
+			if (count > limit)
+			{
+				throw PSOEXCEPT("Pipeline cache entry has too many elements");
+			}
+			items.resize(count);
+		}
+		std::span<const std::byte> Take(std::uint64_t size)
+		{
+			if (size > bytes.size() - offset)
+			{
+				throw PSOEXCEPT("Pipeline cache file is truncated");
+			}
+			const std::span<const std::byte> taken = bytes.subspan(offset, static_cast<std::size_t>(size));
+			offset += static_cast<std::size_t>(size);
+			return taken;
+		}
+		bool AtEnd() const noexcept
+		{
+			return offset == bytes.size();
+		}
+	private:
+		std::span<const std::byte> bytes;
+		std::size_t offset = 0u;
+	};
+
+	std::uint64_t HashNormalized(const PipelineDesc& normalized) noexcept
+	{
+		KeyVisitor visitor;
+		VisitDesc(normalized, visitor);
+		return visitor.hash.Get();
+	}
+}
+
+// Null compiler stuff
+NullPipelineCompiler::NullPipelineCompiler(std::chrono::microseconds compileTime, std::uint64_t version) noexcept
+	:
+	compileTime(compileTime),
+	version(version)
+{}
+
+PipelineCompiler::Result NullPipelineCompiler::Compile(const PipelineDesc& desc, std::span<const std::byte> cachedBlob)
+{
+	if (desc.kind == PipelineKind::Graphics && desc.vertexShader == 0u)
+	{
+		throw PSOEXCEPT("Graphics pipeline has no vertex shader");
+	}
+	if (desc.kind == PipelineKind::Compute && desc.computeShader == 0u)
+	{
+		throw PSOEXCEPT("Compute pipeline has no compute shader");
+	}
+	// The blob is just (version, key), enough to tell whether it belongs to this desc
+	const std::uint64_t identity[2] = { version, PipelineCache::ComputeKey(desc) };
+	if (!cachedBlob.empty())
+	{
+		if (cachedBlob.size() != sizeof(identity) || std::memcmp(cachedBlob.data(), identity, sizeof(identity)) != 0)
+		{
+			throw PSOEXCEPT("Cached blob is for a different pipeline or compiler version");
+		}
+		blobLoadCount.fetch_add(1u, std::memory_order_relaxed);
+	}
+	else
+	{
+		std::this_thread::sleep_for(compileTime);
+		compileCount.fetch_add(1u, std::memory_order_relaxed);
+	}
+	Result result;
+	result.pipeline = nextId.fetch_add(1u, std::memory_order_relaxed);
+	result.blob.resize(sizeof(identity));
+	std::memcpy(result.blob.data(), identity, sizeof(identity));
+	return result;
+}
+
+std::uint64_t NullPipelineCompiler::GetVersion() const noexcept
+{
+	return version;
+}
+
+std::size_t NullPipelineCompiler::GetCompileCount() const noexcept
+{
+	return compileCount.load(std::memory_order_relaxed);
+}
+
+std::size_t NullPipelineCompiler::GetBlobLoadCount() const noexcept
+{
+	return blobLoadCount.load(std::memory_order_relaxed);
+}
+
+// Pipeline cache stuff
+PipelineCache::Entry::Entry(PipelineDesc desc)
+	:
+	desc(std::move(desc)),
+	result(promise.get_future().share())
+{}
+
+PipelineCache::PipelineCache(PipelineCompiler& compiler, ThreadPool& pool, std::string cacheFile)
+	:
+	compiler(compiler),
+	pool(pool),
+	cacheFile(std::move(cacheFile))
+{
+	if (!this->cacheFile.empty())
+	{
+		Load();
+	}
+}
+
+PipelineCache::~PipelineCache()
+{
+	// Queued jobs point at entries
+	WaitForPrecompiles();
+}
+
+PipelineId PipelineCache::Get(const PipelineDesc& desc)
+{
+	const PipelineDesc normalized = Normalize(desc);
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+	Entry& entry = FindOrAdd(normalized);
+	if (!entry.started)
+	{
+		// Not compiled, or only queued for the pool: faster to do it here than to wait for the job
+		entry.started = true;
+		lock.unlock();
+		Compile(entry);
+		return entry.result.get();
+	}
+	if (entry.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		stats.hits++;
+	}
+	else
+	{
+		stats.waits++;
+	}
+	const std::shared_future<PipelineId> result = entry.result;
+	lock.unlock();
+	return result.get();
+}
+
+bool PipelineCache::TryGet(const PipelineDesc& desc, PipelineId& pipeline)
+{
+	const PipelineDesc normalized = Normalize(desc);
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+	Entry& entry = FindOrAdd(normalized);
+	if (entry.compiled || entry.failed)
+	{
+		stats.hits++;
+		const std::shared_future<PipelineId> result = entry.result;
+		lock.unlock();
+		pipeline = result.get();
+		return true;
+	}
+	StartBackground(entry);
+	return false;
+}
+
+void PipelineCache::Precompile(std::span<const PipelineDesc> descs)
+{
+	for (const PipelineDesc& desc : descs)
+	{
+		const PipelineDesc normalized = Normalize(desc);
+		std::lock_guard<std::mutex> lock(mutex);
+		StartBackground(FindOrAdd(normalized));
+	}
+}
+
+void PipelineCache::PrecompileRecorded()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& [key, entry] : entries)
+	{
+		if (entry.recorded)
+		{
+			StartBackground(entry);
+		}
+	}
+}
+
+void PipelineCache::WaitForPrecompiles()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	precompilesDone.wait(lock, [this] { return pendingPrecompiles == 0u; });
+}
+
+bool PipelineCache::Save() const
+{
+	if (cacheFile.empty())
+	{
+		return false;
+	}
+	std::vector<std::byte> payload;
+	WriteVisitor writer(payload);
+	CacheHeader header = {};
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& [key, entry] : entries)
+		{
+			// Recorded states that weren't used this session are kept, so the list doesn't shrink with every run
+			const std::vector<std::byte>* pBlob = nullptr;
+			if (entry.compiled)
+			{
+				pBlob = &entry.blob;
+			}
+			else if (entry.recorded && !entry.failed)
+			{
+				pBlob = &entry.diskBlob;
+			}
+			if (!pBlob)
+			{
+				continue;
+			}
+			writer.Value(key);
+			VisitDesc(entry.desc, writer);
+			writer.Value(static_cast<std::uint64_t>(pBlob->size()));
+			writer.Bytes(pBlob->data(), pBlob->size());
+			header.entryCount++;
+		}
+	}
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = formatVersion;
+	header.compilerVersion = compiler.GetVersion();
+	header.payloadSize = payload.size();
+	header.payloadHash = HashBytes(payload.data(), payload.size());
+
+	std::error_code error;
+	const std::filesystem::path directory = std::filesystem::path(cacheFile).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+	// Write to a temp file and rename, so a crash mid-write leaves the old cache intact.
+	// Its own temp file, so another cache (or another running copy of the game) saving the same file can't interleave with it.
+	const std::string tempPath = MakeTempPath(cacheFile);
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, cacheFile, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+PipelineCache::Stats PipelineCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+PipelineDesc PipelineCache::Normalize(const PipelineDesc& desc)
+{
+	PipelineDesc normalized;
+	normalized.kind = desc.kind;
+	normalized.rootSignature = desc.rootSignature;
+	if (desc.kind == PipelineKind::Compute)
+	{
+		// None of the fixed function state applies, so it all stays at defaults
+		normalized.computeShader = desc.computeShader;
+		return normalized;
+	}
+	normalized = desc;
+	normalized.computeShader = 0u;
+	// Semantics are case insensitive, and with explicit offsets element order doesn't matter
+	for (InputElement& element : normalized.inputLayout)
+	{
+		std::transform(element.semantic.begin(), element.semantic.end(), element.semantic.begin(), [](char c)
+		{
+			return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+		});
+	}
+	std::sort(normalized.inputLayout.begin(), normalized.inputLayout.end(), [](const InputElement& lhs, const InputElement& rhs)
+	{
+		return std::tie(lhs.slot, lhs.offset, lhs.semantic, lhs.semanticIndex) < std::tie(rhs.slot, rhs.offset, rhs.semantic, rhs.semanticIndex);
+	});
+	// -0.0f and 0.0f compare equal but hash differently
+	if (normalized.slopeScaledDepthBias == 0.0f)
+	{
+		normalized.slopeScaledDepthBias = 0.0f;
+	}
+	if (normalized.depthFormat == PixelFormat::Unknown)
+	{
+		normalized.depthEnable = false;
+	}
+	if (!normalized.depthEnable)
+	{
+		normalized.depthWrite = false;
+		normalized.depthFunc = CompareFunc::Less;
+	}
+	normalized.renderTargetCount = std::min(normalized.renderTargetCount, PipelineDesc::maxRenderTargets);
+	for (std::uint32_t i = 0u; i < PipelineDesc::maxRenderTargets; i++)
+	{
+		RenderTargetBlend& blend = normalized.blend[i];
+		if (i >= normalized.renderTargetCount)
+		{
+			normalized.renderTargetFormats[i] = PixelFormat::Unknown;
+			blend = {};
+		}
+		else if (!blend.enable)
+		{
+			const std::uint8_t writeMask = blend.writeMask;
+			blend = {};
+			blend.writeMask = writeMask;
+		}
+	}
+	normalized.sampleCount = std::max(normalized.sampleCount, 1u);
+	return normalized;
+}
+
+std::uint64_t PipelineCache::ComputeKey(const PipelineDesc& desc)
+{
+	return HashNormalized(Normalize(desc));
+}
+
+PipelineCache::Entry& PipelineCache::FindOrAdd(const PipelineDesc& normalized)
+{
+	const auto [it, added] = entries.try_emplace(HashNormalized(normalized), normalized);
+	if (!added && !(it->second.desc == normalized))
+	{
+		throw PSOEXCEPT("Two different pipeline descriptions hash to the same key");
+	}
+	return it->second;
+}
+
+void PipelineCache::StartBackground(Entry& entry)
+{
+	if (entry.started || entry.queued)
+	{
+		return;
+	}
+	entry.queued = true;
+	pendingPrecompiles++;
+	pool.Submit([this, &entry]
+	{
+		bool claimed = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			// Get() may have taken it over while the job sat in the queue
+			if (!entry.started)
+			{
+				entry.started = true;
+				claimed = true;
+			}
+		}
+		if (claimed)
+		{
+			Compile(entry);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.backgroundCompiles += claimed ? 1u : 0u;
+		if (--pendingPrecompiles == 0u)
+		{
+			precompilesDone.notify_all();
+		}
+	});
+}
+
+void PipelineCache::Compile(Entry& entry)
+{
+	try
+	{
+		PipelineCompiler::Result compiled;
+		bool fromBlob = false;
+		bool staleBlob = false;
+		if (!entry.diskBlob.empty())
+		{
+			try
+			{
+				compiled = compiler.Compile(entry.desc, entry.diskBlob);
+				fromBlob = true;
+			}
+			catch (const std::exception&)
+			{
+				staleBlob = true;
+			}
+		}
+		if (!fromBlob)
+		{
+			compiled = compiler.Compile(entry.desc, {});
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entry.blob = std::move(compiled.blob);
+			entry.compiled = true;
+			(fromBlob ? stats.blobCompiles : stats.compiles)++;
+			stats.staleBlobs += staleBlob ? 1u : 0u;
+		}
+		entry.promise.set_value(compiled.pipeline);
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entry.failed = true;
+			stats.failures++;
+		}
+		entry.promise.set_exception(std::current_exception());
+	}
+}
+
+void PipelineCache::Load()
+{
+	std::error_code error;
+	if (!std::filesystem::exists(cacheFile, error))
+	{
+		return;
+	}
+	struct Recorded
+	{
+		PipelineDesc desc;
+		std::vector<std::byte> blob;
+	};
+	std::vector<Recorded> recorded;
+	try
+	{
+		const MappedFile file(cacheFile);
+		const std::span<const std::byte> bytes = file.GetBytes();
+		CacheHeader header;
+		if (bytes.size() < sizeof(header))
+		{
+			throw PSOEXCEPT("Pipeline cache file is truncated");
+		}
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != formatVersion)
+		{
+			throw PSOEXCEPT("Not a pipeline cache file, or an older format");
+		}
+		if (header.compilerVersion != compiler.GetVersion())
+		{
+			throw PSOEXCEPT("Pipeline cache file is from a different compiler version");
+		}
+		const std::span<const std::byte> payload = bytes.subspan(sizeof(header));
+		if (header.payloadSize != payload.size() || header.payloadHash != HashBytes(payload.data(), payload.size()))
+		{
+			throw PSOEXCEPT("Pipeline cache file is corrupt");
+		}
+		// Parse everything before adding anything, so a bad file contributes no entries at all
+		ReadVisitor reader(payload);
+		for (std::uint32_t i = 0u; i < header.entryCount; i++)
+		{
+			Recorded& entry = recorded.emplace_back();
+			std::uint64_t key;
+			reader.Value(key);
+			VisitDesc(entry.desc, reader);
+			// A different key means Normalize() changed without a format version bump
+			if (key != HashNormalized(entry.desc) || !(Normalize(entry.desc) == entry.desc))
+			{
+				throw PSOEXCEPT("Pipeline cache entry doesn't match its key");
+			}
+			std::uint64_t blobSize;
+			reader.Value(blobSize);
+			const std::span<const std::byte> blob = reader.Take(blobSize);
+			entry.blob.assign(blob.begin(), blob.end());
+		}
+		if (!reader.AtEnd())
+		{
+			throw PSOEXCEPT("Pipeline cache file has trailing data");
+		}
+	}
+	catch (const std::exception&)
+	{
+		stats.cacheFileRejected = true;
+		return;
+	}
+	for (Recorded& r : recorded)
+	{
+		Entry& entry = FindOrAdd(r.desc);
+		entry.diskBlob = std::move(r.blob);
+		entry.recorded = true;
+	}
+	stats.recorded = recorded.size();
+}
+
+// Pipeline cache exception stuff
+PipelineCache::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* PipelineCache::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* PipelineCache::Exception::GetType() const noexcept
+{
+	return "EggCeption: Pipeline Cache Exception";
+}
+
+const std::string& PipelineCache::Exception::GetNote() const noexcept
+{
+	return note;
+}
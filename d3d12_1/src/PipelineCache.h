@@ -0,0 +1,284 @@
+#pragma once
+
+#include "CommandList.h"
+#include "EggCeption.h"
+#include "ThreadPool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class PixelFormat : std::uint8_t
+{
+	Unknown,
+	RGBA8,
+	RGBA8_SRGB,
+	BGRA8,
+	BGRA8_SRGB,
+	RGBA16F,
+	R32F,
+	D32F,
+	D24S8
+};
+
+enum class VertexFormat : std::uint8_t
+{
+	Float1,
+	Float2,
+	Float3,
+	Float4,
+	Half2,
+	Half4,
+	UByte4Norm
+};
+
+enum class Topology : std::uint8_t
+{
+	TriangleList,
+	TriangleStrip,
+	LineList,
+	PointList
+};
+
+enum class FillMode : std::uint8_t
+{
+	Solid,
+	Wireframe
+};
+
+enum class CullMode : std::uint8_t
+{
+	None,
+	Front,
+	Back
+};
+
+enum class CompareFunc : std::uint8_t
+{
+	Never,
+	Less,
+	Equal,
+	LessEqual,
+	Greater,
+	NotEqual,
+	GreaterEqual,
+	Always
+};
+
+enum class BlendFactor : std::uint8_t
+{
+	Zero,
+	One,
+	SrcColor,
+	InvSrcColor,
+	SrcAlpha,
+	InvSrcAlpha,
+	DestColor,
+	InvDestColor,
+	DestAlpha,
+	InvDestAlpha
+};
+
+enum class BlendOp : std::uint8_t
+{
+	Add,
+	Subtract,
+	RevSubtract,
+	Min,
+	Max
+};
+
+struct InputElement
+{
+	std::string semantic;
+	std::uint32_t semanticIndex = 0u;
+	VertexFormat format = VertexFormat::Float3;
+	std::uint32_t slot = 0u;
+	std::uint32_t offset = 0u;		// explicit, there's no append-aligned
+	bool operator==(const InputElement&) const = default;
+};
+
+struct RenderTargetBlend
+{
+	bool enable = false;
+	BlendFactor src = BlendFactor::One;
+	BlendFactor dest = BlendFactor::Zero;
+	BlendOp op = BlendOp::Add;
+	BlendFactor srcAlpha = BlendFactor::One;
+	BlendFactor destAlpha = BlendFactor::Zero;
+	BlendOp alphaOp = BlendOp::Add;
+	std::uint8_t writeMask = 0xFu;
+	bool operator==(const RenderTargetBlend&) const = default;
+};
+
+/* Everything a pipeline state object is created from, API independent.
+* Shaders and the root signature are referred to by a hash of their
+* bytecode (HashBytes), so the description stays small and comparable.
+*/
+struct PipelineDesc
+{
+	static constexpr std::uint32_t maxRenderTargets = 8u;
+	PipelineKind kind = PipelineKind::Graphics;
+	std::uint64_t rootSignature = 0u;
+	// 0 = stage not used
+	std::uint64_t vertexShader = 0u;
+	std::uint64_t pixelShader = 0u;
+	std::uint64_t computeShader = 0u;
+	std::vector<InputElement> inputLayout;
+	Topology topology = Topology::TriangleList;
+	FillMode fill = FillMode::Solid;
+	CullMode cull = CullMode::Back;
+	bool frontCounterClockwise = false;
+	std::int32_t depthBias = 0;
+	float slopeScaledDepthBias = 0.0f;
+	bool depthEnable = true;
+	bool depthWrite = true;
+	CompareFunc depthFunc = CompareFunc::Less;
+	std::uint32_t renderTargetCount = 1u;
+	std::array<PixelFormat, maxRenderTargets> renderTargetFormats = { PixelFormat::RGBA8 };
+	std::array<RenderTargetBlend, maxRenderTargets> blend = {};
+	PixelFormat depthFormat = PixelFormat::D32F;
+	std::uint32_t sampleCount = 1u;
+	bool operator==(const PipelineDesc&) const = default;
+};
+
+/* Turns a description into a pipeline the executor knows by id.
+* The D3D12 backend does CreateGraphics/ComputePipelineState, passing
+* cachedBlob as CachedPSO and returning GetCachedBlob(); NullPipelineCompiler
+* only pretends. Compile() is called from several threads at once.
+*/
+class PipelineCompiler
+{
+public:
+	struct Result
+	{
+		PipelineId pipeline = 0u;
+		std::vector<std::byte> blob;	// driver-specific, handed back as cachedBlob in later runs
+	};
+public:
+	virtual ~PipelineCompiler() = default;
+	// cachedBlob is empty or a blob this compiler returned before. Throw if it can't be used; the cache retries without it.
+	virtual Result Compile(const PipelineDesc& desc, std::span<const std::byte> cachedBlob) = 0;
+	// Must change whenever old blobs stop being usable (driver or compiler update); the disk cache is dropped on mismatch
+	virtual std::uint64_t GetVersion() const noexcept = 0;
+};
+
+// Takes compileTime per pipeline unless given a matching blob, which it accepts instantly
+class NullPipelineCompiler : public PipelineCompiler
+{
+public:
+	explicit NullPipelineCompiler(std::chrono::microseconds compileTime = {}, std::uint64_t version = 1u) noexcept;
+	Result Compile(const PipelineDesc& desc, std::span<const std::byte> cachedBlob) override;
+	std::uint64_t GetVersion() const noexcept override;
+	std::size_t GetCompileCount() const noexcept;
+	std::size_t GetBlobLoadCount() const noexcept;
+private:
+	std::chrono::microseconds compileTime;
+	std::uint64_t version;
+	std::atomic<PipelineId> nextId{ 1u };
+	std::atomic<std::size_t> compileCount{ 0u };
+	std::atomic<std::size_t> blobLoadCount{ 0u };
+};
+
+/* Desc -> PipelineId, compiling each distinct state once.
+* Descriptions are normalized first (fields the state ignores are reset,
+* input layouts put in a canonical order), so equivalent states share a
+* key. Concurrent requests for a state share one compile: whoever gets
+* there first compiles, everyone else waits on its future. Failures are
+* remembered and rethrown to every caller.
+*
+* With a cache file, every state compiled this session is written by
+* Save() along with the compiler's blob. The next session loads that list,
+* PrecompileRecorded() warms it all up on the pool before it's needed, and
+* compiling from the blob skips most of the driver's work. A file from a
+* different compiler version, or one that fails its checksum, is ignored.
+*/
+class PipelineCache
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	struct Stats
+	{
+		std::size_t requests = 0u;
+		std::size_t hits = 0u;				// already compiled
+		std::size_t waits = 0u;				// blocked on a compile another thread was doing
+		std::size_t compiles = 0u;			// from scratch
+		std::size_t blobCompiles = 0u;		// from a blob loaded off disk
+		std::size_t staleBlobs = 0u;		// rejected by the compiler, recompiled from scratch
+		std::size_t backgroundCompiles = 0u;
+		std::size_t failures = 0u;
+		std::size_t recorded = 0u;			// states loaded from the cache file
+		bool cacheFileRejected = false;
+	};
+public:
+	// Empty cacheFile disables the disk cache
+	PipelineCache(PipelineCompiler& compiler, ThreadPool& pool, std::string cacheFile = {});
+	~PipelineCache();
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+	// Blocks until the pipeline is compiled; throws if compiling fails
+	PipelineId Get(const PipelineDesc& desc);
+	// Doesn't wait: false if not compiled yet, in which case it gets compiled in the background. Throws if compiling failed.
+	bool TryGet(const PipelineDesc& desc, PipelineId& pipeline);
+	void Precompile(std::span<const PipelineDesc> descs);
+	// Precompiles every state loaded from the cache file
+	void PrecompileRecorded();
+	void WaitForPrecompiles();
+	// Writes the cache file; false if there is none or writing failed
+	bool Save() const;
+	Stats GetStats() const;
+	static PipelineDesc Normalize(const PipelineDesc& desc);
+	static std::uint64_t ComputeKey(const PipelineDesc& desc);
+private:
+	struct Entry
+	{
+		explicit Entry(PipelineDesc desc);
+		const PipelineDesc desc;	// normalized
+		// Set while loading the cache file, read-only after
+		std::vector<std::byte> diskBlob;
+		bool recorded = false;
+		// Guarded by mutex
+		std::vector<std::byte> blob;
+		bool queued = false;
+		bool started = false;
+		bool compiled = false;
+		bool failed = false;
+		std::promise<PipelineId> promise;
+		std::shared_future<PipelineId> result;
+	};
+	// These two expect the caller to hold mutex
+	Entry& FindOrAdd(const PipelineDesc& normalized);
+	void StartBackground(Entry& entry);
+	// Runs the compiler for an entry this thread has marked started, and fulfils its promise
+	void Compile(Entry& entry);
+	void Load();
+private:
+	PipelineCompiler& compiler;
+	ThreadPool& pool;
+	std::string cacheFile;
+	mutable std::mutex mutex;
+	std::condition_variable precompilesDone;
+	// Node based, so entries stay put while other threads hold references to them
+	std::unordered_map<std::uint64_t, Entry> entries;
+	std::size_t pendingPrecompiles = 0u;
+	Stats stats;
+};
+
+#define PSOEXCEPT(note) PipelineCache::Exception(__LINE__, __FILE__, (note))
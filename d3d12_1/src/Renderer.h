@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Backend-agnostic rendering interface owned by Window.
+* The D3D12 backend will implement this; until then (and on machines
+* with no GPU) SoftwareRenderer does.
+*/
+class Renderer
+{
+public:
+	// Clip-space position (pre perspective divide) plus a vertex color
+	struct Vertex
+	{
+		float x, y, z, w;
+		float r, g, b, a;
+	};
+public:
+	virtual ~Renderer() = default;
+	virtual void BeginFrame() = 0;
+	virtual void ClearBuffer(float red, float green, float blue) noexcept = 0;
+	// Triangle list; indices point into vertices
+	virtual void DrawIndexed(const Vertex* pVertices, std::size_t vertexCount, const std::uint32_t* pIndices, std::size_t indexCount) = 0;
+	virtual void EndFrame() = 0;
+	virtual int GetWidth() const noexcept = 0;
+	virtual int GetHeight() const noexcept = 0;
+};
@@ -0,0 +1,664 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+/* Header-only vector / matrix / quaternion math.
+* Stand-in for DirectXMath that also builds off Windows. Conventions follow
+* DirectXMath so code ports over easily: row vectors, v * M, row-major
+* storage, left-handed projection with depth in [0, 1].
+*
+* SSE2 is used on x86/x64, AVX additionally for batch transforms and matrix
+* multiply, NEON on ARM, and plain scalar code everywhere else (or with
+* SIMDMATH_FORCE_SCALAR).
+* Everything that doesn't need sqrt/trig is constexpr; at compile time the
+* scalar path is taken automatically.
+*/
+
+#if !defined(SIMDMATH_FORCE_SCALAR)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMDMATH_SSE
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define SIMDMATH_AVX
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMDMATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+struct Vec3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	constexpr Vec3() = default;
+	constexpr Vec3(float x, float y, float z) noexcept
+		:
+		x(x),
+		y(y),
+		z(z)
+	{}
+	constexpr Vec3 operator+(const Vec3& rhs) const noexcept
+	{
+		return { x + rhs.x, y + rhs.y, z + rhs.z };
+	}
+	constexpr Vec3 operator-(const Vec3& rhs) const noexcept
+	{
+		return { x - rhs.x, y - rhs.y, z - rhs.z };
+	}
+	constexpr Vec3 operator-() const noexcept
+	{
+		return { -x, -y, -z };
+	}
+	constexpr Vec3 operator*(float s) const noexcept
+	{
+		return { x * s, y * s, z * s };
+	}
+	constexpr float Dot(const Vec3& rhs) const noexcept
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z;
+	}
+	constexpr Vec3 Cross(const Vec3& rhs) const noexcept
+	{
+		return { y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x };
+	}
+	float Length() const noexcept
+	{
+		return std::sqrt(Dot(*this));
+	}
+	Vec3 Normalized() const noexcept
+	{
+		const float length = Length();
+		return length > 0.0f ? *this * (1.0f / length) : *this;
+	}
+};
+
+struct alignas(16) Vec4
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 0.0f;
+	constexpr Vec4() = default;
+	constexpr Vec4(float x, float y, float z, float w) noexcept
+		:
+		x(x),
+		y(y),
+		z(z),
+		w(w)
+	{}
+	constexpr Vec4(const Vec3& v, float w) noexcept
+		:
+		x(v.x),
+		y(v.y),
+		z(v.z),
+		w(w)
+	{}
+	constexpr Vec4 operator+(const Vec4& rhs) const noexcept
+	{
+		return { x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w };
+	}
+	constexpr Vec4 operator-(const Vec4& rhs) const noexcept
+	{
+		return { x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w };
+	}
+	constexpr Vec4 operator*(float s) const noexcept
+	{
+		return { x * s, y * s, z * s, w * s };
+	}
+	constexpr float Dot(const Vec4& rhs) const noexcept
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+	constexpr Vec3 Xyz() const noexcept
+	{
+		return { x, y, z };
+	}
+};
+
+struct alignas(16) Mat4
+{
+	float m[4][4] = {};
+
+	static constexpr Mat4 Identity() noexcept
+	{
+		Mat4 r;
+		r.m[0][0] = r.m[1][1] = r.m[2][2] = r.m[3][3] = 1.0f;
+		return r;
+	}
+	static constexpr Mat4 Translation(float x, float y, float z) noexcept
+	{
+		Mat4 r = Identity();
+		r.m[3][0] = x;
+		r.m[3][1] = y;
+		r.m[3][2] = z;
+		return r;
+	}
+	static constexpr Mat4 Scaling(float x, float y, float z) noexcept
+	{
+		Mat4 r;
+		r.m[0][0] = x;
+		r.m[1][1] = y;
+		r.m[2][2] = z;
+		r.m[3][3] = 1.0f;
+		return r;
+	}
+	static Mat4 RotationX(float angle) noexcept
+	{
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		Mat4 r = Identity();
+		r.m[1][1] = c;
+		r.m[1][2] = s;
+		r.m[2][1] = -s;
+		r.m[2][2] = c;
+		return r;
+	}
+	static Mat4 RotationY(float angle) noexcept
+	{
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		Mat4 r = Identity();
+		r.m[0][0] = c;
+		r.m[0][2] = -s;
+		r.m[2][0] = s;
+		r.m[2][2] = c;
+		return r;
+	}
+	static Mat4 RotationZ(float angle) noexcept
+	{
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		Mat4 r = Identity();
+		r.m[0][0] = c;
+		r.m[0][1] = s;
+		r.m[1][0] = -s;
+		r.m[1][1] = c;
+		return r;
+	}
+	// Left-handed, depth mapped to [0, 1] (same as XMMatrixPerspectiveFovLH)
+	static Mat4 PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ) noexcept
+	{
+		const float yScale = 1.0f / std::tan(fovY * 0.5f);
+		const float range = farZ / (farZ - nearZ);
+		Mat4 r;
+		r.m[0][0] = yScale / aspect;
+		r.m[1][1] = yScale;
+		r.m[2][2] = range;
+		r.m[2][3] = 1.0f;
+		r.m[3][2] = -range * nearZ;
+		return r;
+	}
+	static Mat4 LookAtLH(const Vec3& eye, const Vec3& target, const Vec3& up) noexcept
+	{
+		const Vec3 zAxis = (target - eye).Normalized();
+		const Vec3 xAxis = up.Cross(zAxis).Normalized();
+		const Vec3 yAxis = zAxis.Cross(xAxis);
+		Mat4 r = Identity();
+		r.m[0][0] = xAxis.x; r.m[1][0] = xAxis.y; r.m[2][0] = xAxis.z;
+		r.m[0][1] = yAxis.x; r.m[1][1] = yAxis.y; r.m[2][1] = yAxis.z;
+		r.m[0][2] = zAxis.x; r.m[1][2] = zAxis.y; r.m[2][2] = zAxis.z;
+		r.m[3][0] = -xAxis.Dot(eye);
+		r.m[3][1] = -yAxis.Dot(eye);
+		r.m[3][2] = -zAxis.Dot(eye);
+		return r;
+	}
+
+	constexpr Mat4 Transposed() const noexcept
+	{
+		Mat4 r;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				r.m[i][j] = m[j][i];
+			}
+		}
+		return r;
+	}
+	// this * rhs, i.e. apply this first, then rhs
+	constexpr Mat4 operator*(const Mat4& rhs) const noexcept;
+	constexpr Vec4 Transform(const Vec4& v) const noexcept;
+	constexpr Vec3 TransformPoint(const Vec3& p) const noexcept
+	{
+		return Transform(Vec4(p, 1.0f)).Xyz();
+	}
+	constexpr Vec3 TransformNormal(const Vec3& n) const noexcept
+	{
+		return Transform(Vec4(n, 0.0f)).Xyz();
+	}
+	constexpr float Determinant() const noexcept;
+	// General inverse; returns false (and leaves out untouched) for singular matrices
+	constexpr bool Inverse(Mat4& out) const noexcept;
+	// Reference implementations the SIMD paths are checked against
+	constexpr Mat4 MultiplyScalar(const Mat4& rhs) const noexcept;
+	constexpr bool InverseScalar(Mat4& out) const noexcept;
+};
+
+struct alignas(16) Quat
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 1.0f;
+	constexpr Quat() = default;
+	constexpr Quat(float x, float y, float z, float w) noexcept
+		:
+		x(x),
+		y(y),
+		z(z),
+		w(w)
+	{}
+	static Quat FromAxisAngle(const Vec3& axis, float angle) noexcept
+	{
+		const Vec3 n = axis.Normalized();
+		const float s = std::sin(angle * 0.5f);
+		return { n.x * s, n.y * s, n.z * s, std::cos(angle * 0.5f) };
+	}
+	// this * rhs rotates by this first, then rhs (same order as matrices)
+	constexpr Quat operator*(const Quat& rhs) const noexcept
+	{
+		return {
+			rhs.w * x + rhs.x * w + rhs.y * z - rhs.z * y,
+			rhs.w * y - rhs.x * z + rhs.y * w + rhs.z * x,
+			rhs.w * z + rhs.x * y - rhs.y * x + rhs.z * w,
+			rhs.w * w - rhs.x * x - rhs.y * y - rhs.z * z
+		};
+	}
+	constexpr Quat Conjugate() const noexcept
+	{
+		return { -x, -y, -z, w };
+	}
+	constexpr float Dot(const Quat& rhs) const noexcept
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+	Quat Normalized() const noexcept
+	{
+		const float length = std::sqrt(Dot(*this));
+		const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+		return { x * inv, y * inv, z * inv, w * inv };
+	}
+	constexpr Vec3 Rotate(const Vec3& v) const noexcept
+	{
+		// v' = v + 2w(q x v) + 2(q x (q x v))
+		const Vec3 q(x, y, z);
+		const Vec3 t = q.Cross(v) * 2.0f;
+		return v + t * w + q.Cross(t);
+	}
+	constexpr Mat4 ToMatrix() const noexcept
+	{
+		Mat4 r = Mat4::Identity();
+		r.m[0][0] = 1.0f - 2.0f * (y * y + z * z);
+		r.m[0][1] = 2.0f * (x * y + z * w);
+		r.m[0][2] = 2.0f * (x * z - y * w);
+		r.m[1][0] = 2.0f * (x * y - z * w);
+		r.m[1][1] = 1.0f - 2.0f * (x * x + z * z);
+		r.m[1][2] = 2.0f * (y * z + x * w);
+		r.m[2][0] = 2.0f * (x * z + y * w);
+		r.m[2][1] = 2.0f * (y * z - x * w);
+		r.m[2][2] = 1.0f - 2.0f * (x * x + y * y);
+		return r;
+	}
+	// Shortest-path spherical interpolation; t in [0, 1]
+	static Quat Slerp(const Quat& a, const Quat& b, float t) noexcept
+	{
+		float cosTheta = a.Dot(b);
+		// q and -q are the same rotation, pick the one on a's side of the hypersphere
+		const float sign = cosTheta < 0.0f ? -1.0f : 1.0f;
+		cosTheta *= sign;
+		float wa;
+		float wb;
+		// Nearly parallel -> sin(theta) ~ 0, fall back to normalized lerp
+		if (cosTheta > 0.9995f)
+		{
+			wa = 1.0f - t;
+			wb = t;
+		}
+		else
+		{
+			const float theta = std::acos(cosTheta);
+			const float invSin = 1.0f / std::sin(theta);
+			wa = std::sin((1.0f - t) * theta) * invSin;
+			wb = std::sin(t * theta) * invSin;
+		}
+		wb *= sign;
+		return Quat(
+			a.x * wa + b.x * wb,
+			a.y * wa + b.y * wb,
+			a.z * wa + b.z * wb,
+			a.w * wa + b.w * wb
+		).Normalized();
+	}
+};
+
+/****************** Implementation ******************/
+
+constexpr Mat4 Mat4::MultiplyScalar(const Mat4& rhs) const noexcept
+{
+	Mat4 r;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			r.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] + m[i][2] * rhs.m[2][j] + m[i][3] * rhs.m[3][j];
+		}
+	}
+	return r;
+}
+
+constexpr Mat4 Mat4::operator*(const Mat4& rhs) const noexcept
+{
+	if (std::is_constant_evaluated())
+	{
+		return MultiplyScalar(rhs);
+	}
+#if defined(SIMDMATH_AVX)
+	// Two result rows per register. Also keeps the stores 32 bytes wide: four 16 byte
+	// stores read back by a 32 byte copy of the result miss store forwarding.
+	Mat4 r;
+	const __m256 a01 = _mm256_loadu_ps(m[0]);
+	const __m256 a23 = _mm256_loadu_ps(m[2]);
+	const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs.m[0]));
+	const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs.m[1]));
+	const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs.m[2]));
+	const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs.m[3]));
+	__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+	__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), b2));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), b2));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), b3));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), b3));
+	_mm256_storeu_ps(r.m[0], r01);
+	_mm256_storeu_ps(r.m[2], r23);
+	return r;
+#elif defined(SIMDMATH_SSE)
+	Mat4 r;
+	const __m128 b0 = _mm_load_ps(rhs.m[0]);
+	const __m128 b1 = _mm_load_ps(rhs.m[1]);
+	const __m128 b2 = _mm_load_ps(rhs.m[2]);
+	const __m128 b3 = _mm_load_ps(rhs.m[3]);
+	for (int i = 0; i < 4; i++)
+	{
+		// Row i of the result is a linear combination of rhs's rows
+		__m128 row = _mm_mul_ps(_mm_set1_ps(m[i][0]), b0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][1]), b1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][2]), b2));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][3]), b3));
+		_mm_store_ps(r.m[i], row);
+	}
+	return r;
+#elif defined(SIMDMATH_NEON)
+	Mat4 r;
+	const float32x4_t b0 = vld1q_f32(rhs.m[0]);
+	const float32x4_t b1 = vld1q_f32(rhs.m[1]);
+	const float32x4_t b2 = vld1q_f32(rhs.m[2]);
+	const float32x4_t b3 = vld1q_f32(rhs.m[3]);
+	for (int i = 0; i < 4; i++)
+	{
+		float32x4_t row = vmulq_n_f32(b0, m[i][0]);
+		row = vmlaq_n_f32(row, b1, m[i][1]);
+		row = vmlaq_n_f32(row, b2, m[i][2]);
+		row = vmlaq_n_f32(row, b3, m[i][3]);
+		vst1q_f32(r.m[i], row);
+	}
+	return r;
+#else
+	return MultiplyScalar(rhs);
+#endif
+}
+
+constexpr Vec4 Mat4::Transform(const Vec4& v) const noexcept
+{
+	return {
+		v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0] + v.w * m[3][0],
+		v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1] + v.w * m[3][1],
+		v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2] + v.w * m[3][2],
+		v.x * m[0][3] + v.y * m[1][3] + v.z * m[2][3] + v.w * m[3][3]
+	};
+}
+
+constexpr float Mat4::Determinant() const noexcept
+{
+	// Laplace expansion along the 2x2 minors of the top and bottom row pairs
+	const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+	const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+constexpr bool Mat4::InverseScalar(Mat4& out) const noexcept
+{
+	const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+	const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (det == 0.0f)
+	{
+		return false;
+	}
+	const float inv = 1.0f / det;
+	out.m[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv;
+	out.m[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv;
+	out.m[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv;
+	out.m[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv;
+	out.m[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv;
+	out.m[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv;
+	out.m[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv;
+	out.m[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv;
+	out.m[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv;
+	out.m[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv;
+	out.m[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv;
+	out.m[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv;
+	out.m[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv;
+	out.m[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv;
+	out.m[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv;
+	out.m[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv;
+	return true;
+}
+
+#if defined(SIMDMATH_SSE)
+namespace SimdMathDetail
+{
+	template<int x, int y, int z, int w>
+	inline __m128 Swizzle(__m128 v) noexcept
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x));
+	}
+	template<int x, int y, int z, int w>
+	inline __m128 Shuffle(__m128 a, __m128 b) noexcept
+	{
+		return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+	}
+	// 2x2 matrices packed as (m00, m01, m10, m11)
+	// A * B
+	inline __m128 Mat2Mul(__m128 a, __m128 b) noexcept
+	{
+		return _mm_add_ps(_mm_mul_ps(a, Swizzle<0, 3, 0, 3>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+	}
+	// adj(A) * B
+	inline __m128 Mat2AdjMul(__m128 a, __m128 b) noexcept
+	{
+		return _mm_sub_ps(_mm_mul_ps(Swizzle<3, 3, 0, 0>(a), b), _mm_mul_ps(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+	}
+	// A * adj(B)
+	inline __m128 Mat2MulAdj(__m128 a, __m128 b) noexcept
+	{
+		return _mm_sub_ps(_mm_mul_ps(a, Swizzle<3, 0, 3, 0>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+	}
+}
+#endif
+
+constexpr bool Mat4::Inverse(Mat4& out) const noexcept
+{
+	if (std::is_constant_evaluated())
+	{
+		return InverseScalar(out);
+	}
+#if defined(SIMDMATH_SSE)
+	// Block-wise inverse over 2x2 sub-matrices A B / C D
+	using namespace SimdMathDetail;
+	const __m128 r0 = _mm_load_ps(m[0]);
+	const __m128 r1 = _mm_load_ps(m[1]);
+	const __m128 r2 = _mm_load_ps(m[2]);
+	const __m128 r3 = _mm_load_ps(m[3]);
+	const __m128 a = _mm_movelh_ps(r0, r1);
+	const __m128 b = _mm_movehl_ps(r1, r0);
+	const __m128 c = _mm_movelh_ps(r2, r3);
+	const __m128 d = _mm_movehl_ps(r3, r2);
+	// (|A|, |B|, |C|, |D|)
+	const __m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(Shuffle<0, 2, 0, 2>(r0, r2), Shuffle<1, 3, 1, 3>(r1, r3)),
+		_mm_mul_ps(Shuffle<1, 3, 1, 3>(r0, r2), Shuffle<0, 2, 0, 2>(r1, r3)));
+	const __m128 detA = Swizzle<0, 0, 0, 0>(detSub);
+	const __m128 detB = Swizzle<1, 1, 1, 1>(detSub);
+	const __m128 detC = Swizzle<2, 2, 2, 2>(detSub);
+	const __m128 detD = Swizzle<3, 3, 3, 3>(detSub);
+	const __m128 dc = Mat2AdjMul(d, c);
+	const __m128 ab = Mat2AdjMul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Mul(b, dc));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Mul(c, ab));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MulAdj(d, ab));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MulAdj(a, dc));
+	// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	__m128 tr = _mm_mul_ps(ab, Swizzle<0, 2, 1, 3>(dc));
+	tr = _mm_add_ps(tr, Swizzle<1, 0, 3, 2>(tr));
+	tr = _mm_add_ps(tr, Swizzle<2, 3, 0, 1>(tr));
+	const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+	if (_mm_cvtss_f32(detM) == 0.0f)
+	{
+		return false;
+	}
+	const __m128 rcpDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+	x = _mm_mul_ps(x, rcpDet);
+	y = _mm_mul_ps(y, rcpDet);
+	z = _mm_mul_ps(z, rcpDet);
+	w = _mm_mul_ps(w, rcpDet);
+	// Adjugate shuffle and block re-assembly in one go
+	_mm_store_ps(out.m[0], Shuffle<3, 1, 3, 1>(x, y));
+	_mm_store_ps(out.m[1], Shuffle<2, 0, 2, 0>(x, y));
+	_mm_store_ps(out.m[2], Shuffle<3, 1, 3, 1>(z, w));
+	_mm_store_ps(out.m[3], Shuffle<2, 0, 2, 0>(z, w));
+	return true;
+#else
+	// NEON has no cheap cross-lane shuffles for the block method; the scalar cofactor
+	// version vectorizes well enough there
+	return InverseScalar(out);
+#endif
+}
+
+/* Batch transform of points stored as separate x/y/z arrays (SoA).
+* Treats points as (x, y, z, 1) and drops w, so m should be affine.
+* Output arrays may alias the inputs.
+*/
+inline void TransformPointsSoA(const Mat4& m, const float* pX, const float* pY, const float* pZ,
+	float* pOutX, float* pOutY, float* pOutZ, std::size_t count) noexcept
+{
+	std::size_t i = 0u;
+#if defined(SIMDMATH_AVX)
+	{
+		// Broadcast each matrix element once, then 8 points per iteration
+		__m256 e[4][3];
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				e[r][c] = _mm256_set1_ps(m.m[r][c]);
+			}
+		}
+		for (; i + 8u <= count; i += 8u)
+		{
+			const __m256 x = _mm256_loadu_ps(pX + i);
+			const __m256 y = _mm256_loadu_ps(pY + i);
+			const __m256 z = _mm256_loadu_ps(pZ + i);
+			__m256 out[3];
+			for (int c = 0; c < 3; c++)
+			{
+				out[c] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, e[0][c]), _mm256_mul_ps(y, e[1][c])),
+					_mm256_add_ps(_mm256_mul_ps(z, e[2][c]), e[3][c]));
+			}
+			_mm256_storeu_ps(pOutX + i, out[0]);
+			_mm256_storeu_ps(pOutY + i, out[1]);
+			_mm256_storeu_ps(pOutZ + i, out[2]);
+		}
+	}
+#endif
+#if defined(SIMDMATH_SSE)
+	{
+		__m128 e[4][3];
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				e[r][c] = _mm_set1_ps(m.m[r][c]);
+			}
+		}
+		for (; i + 4u <= count; i += 4u)
+		{
+			const __m128 x = _mm_loadu_ps(pX + i);
+			const __m128 y = _mm_loadu_ps(pY + i);
+			const __m128 z = _mm_loadu_ps(pZ + i);
+			__m128 out[3];
+			for (int c = 0; c < 3; c++)
+			{
+				out[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e[0][c]), _mm_mul_ps(y, e[1][c])),
+					_mm_add_ps(_mm_mul_ps(z, e[2][c]), e[3][c]));
+			}
+			_mm_storeu_ps(pOutX + i, out[0]);
+			_mm_storeu_ps(pOutY + i, out[1]);
+			_mm_storeu_ps(pOutZ + i, out[2]);
+		}
+	}
+#elif defined(SIMDMATH_NEON)
+	for (; i + 4u <= count; i += 4u)
+	{
+		const float32x4_t x = vld1q_f32(pX + i);
+		const float32x4_t y = vld1q_f32(pY + i);
+		const float32x4_t z = vld1q_f32(pZ + i);
+		float32x4_t out[3];
+		for (int c = 0; c < 3; c++)
+		{
+			out[c] = vdupq_n_f32(m.m[3][c]);
+			out[c] = vmlaq_n_f32(out[c], x, m.m[0][c]);
+			out[c] = vmlaq_n_f32(out[c], y, m.m[1][c]);
+			out[c] = vmlaq_n_f32(out[c], z, m.m[2][c]);
+		}
+		vst1q_f32(pOutX + i, out[0]);
+		vst1q_f32(pOutY + i, out[1]);
+		vst1q_f32(pOutZ + i, out[2]);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float x = pX[i];
+		const float y = pY[i];
+		const float z = pZ[i];
+		pOutX[i] = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0];
+		pOutY[i] = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1];
+		pOutZ[i] = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2];
+	}
+}
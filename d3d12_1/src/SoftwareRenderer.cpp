@@ -0,0 +1,254 @@
+#include "SoftwareRenderer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, ThreadPool& pool)
+	:
+	pool(pool),
+	framebuffer(width, height),
+	tilesX((width + tileSize - 1) / tileSize),
+	tilesY((height + tileSize - 1) / tileSize),
+	tileBins(static_cast<std::size_t>(tilesX) * tilesY)
+{
+	framebuffer.Clear(0u, 1.0f);
+}
+
+void SoftwareRenderer::BeginFrame()
+{
+	triangles.clear();
+	for (auto& bin : tileBins)
+	{
+		bin.clear();
+	}
+	clearPending = false;
+	stats = Stats();
+}
+
+void SoftwareRenderer::ClearBuffer(float red, float green, float blue) noexcept
+{
+	// Anything drawn before the clear would be overwritten anyway, so just drop it.
+	// The clear itself is done per tile in EndFrame, by whichever thread owns the tile.
+	triangles.clear();
+	for (auto& bin : tileBins)
+	{
+		bin.clear();
+	}
+	clearPending = true;
+	clearColor = Framebuffer::PackColor(red, green, blue);
+}
+
+void SoftwareRenderer::DrawIndexed(const Vertex* pVertices, std::size_t vertexCount, const std::uint32_t* pIndices, std::size_t indexCount)
+{
+	assert(indexCount % 3u == 0u);
+	triangles.reserve(triangles.size() + indexCount / 3u);
+	for (std::size_t i = 0u; i + 2u < indexCount; i += 3u)
+	{
+		assert(pIndices[i] < vertexCount && pIndices[i + 1u] < vertexCount && pIndices[i + 2u] < vertexCount);
+		stats.trianglesSubmitted++;
+		SetupTriangle(pVertices[pIndices[i]], pVertices[pIndices[i + 1u]], pVertices[pIndices[i + 2u]]);
+	}
+}
+
+void SoftwareRenderer::EndFrame()
+{
+	// Bin: every triangle goes into each tile its bounding box touches
+	for (std::size_t i = 0u; i < triangles.size(); i++)
+	{
+		const Triangle& tri = triangles[i];
+		const int tx0 = tri.minX / tileSize;
+		const int ty0 = tri.minY / tileSize;
+		const int tx1 = tri.maxX / tileSize;
+		const int ty1 = tri.maxY / tileSize;
+		for (int ty = ty0; ty <= ty1; ty++)
+		{
+			for (int tx = tx0; tx <= tx1; tx++)
+			{
+				tileBins[static_cast<std::size_t>(ty) * tilesX + tx].push_back(static_cast<std::uint32_t>(i));
+				stats.tileBinEntries++;
+			}
+		}
+	}
+	// Tiles don't overlap, so they can be rasterized fully independently
+	pool.ParallelFor(tileBins.size(), 1u, [this](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t tile = begin; tile < end; tile++)
+		{
+			RasterizeTile(tile);
+		}
+	});
+	clearPending = false;
+}
+
+int SoftwareRenderer::GetWidth() const noexcept
+{
+	return framebuffer.GetWidth();
+}
+
+int SoftwareRenderer::GetHeight() const noexcept
+{
+	return framebuffer.GetHeight();
+}
+
+Framebuffer& SoftwareRenderer::GetFramebuffer() noexcept
+{
+	return framebuffer;
+}
+
+const SoftwareRenderer::Stats& SoftwareRenderer::GetStats() const noexcept
+{
+	return stats;
+}
+
+void SoftwareRenderer::SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2)
+{
+	const Vertex* verts[3] = { &v0, &v1, &v2 };
+	Triangle tri;
+	const float width = static_cast<float>(framebuffer.GetWidth());
+	const float height = static_cast<float>(framebuffer.GetHeight());
+	for (int i = 0; i < 3; i++)
+	{
+		const Vertex& v = *verts[i];
+		if (!(v.w > 1e-6f))
+		{
+			stats.trianglesRejected++;
+			return;
+		}
+		const float invW = 1.0f / v.w;
+		// NDC -> pixels, y flipped so +y is up in clip space
+		const float x = (v.x * invW * 0.5f + 0.5f) * width;
+		const float y = (0.5f - v.y * invW * 0.5f) * height;
+		// Also catches NaNs
+		if (!(std::abs(x) < guardBand && std::abs(y) < guardBand))
+		{
+			stats.trianglesRejected++;
+			return;
+		}
+		// Snap to the subpixel grid; everything about coverage is decided on these
+		tri.x[i] = static_cast<std::int32_t>(std::lround(x * subpixelOne));
+		tri.y[i] = static_cast<std::int32_t>(std::lround(y * subpixelOne));
+		tri.z[i] = v.z * invW;
+		tri.invW[i] = invW;
+		tri.color[i][0] = v.r * invW;
+		tri.color[i][1] = v.g * invW;
+		tri.color[i][2] = v.b * invW;
+		tri.color[i][3] = v.a * invW;
+	}
+
+	tri.area = std::int64_t(tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - std::int64_t(tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+	if (tri.area == 0)
+	{
+		stats.trianglesRejected++;
+		return;
+	}
+	// No culling, so just flip the winding of "backwards" triangles to keep edge functions positive inside
+	if (tri.area < 0)
+	{
+		std::swap(tri.x[1], tri.x[2]);
+		std::swap(tri.y[1], tri.y[2]);
+		std::swap(tri.z[1], tri.z[2]);
+		std::swap(tri.invW[1], tri.invW[2]);
+		std::swap(tri.color[1], tri.color[2]);
+		tri.area = -tri.area;
+	}
+
+	// Pixel x is sampled at x + 0.5, so these bounds are conservative by at most a pixel
+	tri.minX = std::max(0, std::min({ tri.x[0], tri.x[1], tri.x[2] }) >> subpixelBits);
+	tri.minY = std::max(0, std::min({ tri.y[0], tri.y[1], tri.y[2] }) >> subpixelBits);
+	tri.maxX = std::min(framebuffer.GetWidth() - 1, std::max({ tri.x[0], tri.x[1], tri.x[2] }) >> subpixelBits);
+	tri.maxY = std::min(framebuffer.GetHeight() - 1, std::max({ tri.y[0], tri.y[1], tri.y[2] }) >> subpixelBits);
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+	{
+		stats.trianglesRejected++;
+		return;
+	}
+	triangles.push_back(tri);
+}
+
+void SoftwareRenderer::RasterizeTile(std::size_t tileIndex) noexcept
+{
+	const int x0 = static_cast<int>(tileIndex % tilesX) * tileSize;
+	const int y0 = static_cast<int>(tileIndex / tilesX) * tileSize;
+	const int x1 = std::min(x0 + tileSize, framebuffer.GetWidth());
+	const int y1 = std::min(y0 + tileSize, framebuffer.GetHeight());
+	if (clearPending)
+	{
+		framebuffer.FillRect(x0, y0, x1, y1, clearColor, 1.0f);
+	}
+	for (const std::uint32_t triIndex : tileBins[tileIndex])
+	{
+		RasterizeTriangle(triangles[triIndex], x0, y0, x1, y1);
+	}
+}
+
+void SoftwareRenderer::RasterizeTriangle(const Triangle& tri, int x0, int y0, int x1, int y1) noexcept
+{
+	// Clip the triangle's bounds to this tile (x1/y1 exclusive)
+	x0 = std::max(x0, tri.minX);
+	y0 = std::max(y0, tri.minY);
+	x1 = std::min(x1, tri.maxX + 1);
+	y1 = std::min(y1, tri.maxY + 1);
+	if (x0 >= x1 || y0 >= y1)
+	{
+		return;
+	}
+
+	// Edge i is opposite vertex i; E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x),
+	// exact in 64 bits on the 28.4 grid so neighbouring triangles agree on every shared edge
+	std::int64_t stepX[3];
+	std::int64_t stepY[3];
+	std::int64_t rowStart[3];
+	std::int64_t bias[3];
+	const std::int64_t px = std::int64_t(x0) * subpixelOne + subpixelOne / 2;
+	const std::int64_t py = std::int64_t(y0) * subpixelOne + subpixelOne / 2;
+	for (int i = 0; i < 3; i++)
+	{
+		const int a = (i + 1) % 3;
+		const int b = (i + 2) % 3;
+		const std::int64_t dx = tri.x[b] - tri.x[a];
+		const std::int64_t dy = tri.y[b] - tri.y[a];
+		stepX[i] = -dy * subpixelOne;
+		stepY[i] = dx * subpixelOne;
+		rowStart[i] = dx * (py - tri.y[a]) - dy * (px - tri.x[a]);
+		// Top-left fill rule so pixels on shared edges are drawn exactly once: E == 0 only counts on top/left edges
+		const bool isTopLeft = dy < 0 || (dy == 0 && dx > 0);
+		bias[i] = isTopLeft ? 0 : 1;
+	}
+	const float rcpArea = 1.0f / static_cast<float>(tri.area);
+
+	for (int y = y0; y < y1; y++)
+	{
+		std::uint32_t* pColor = framebuffer.GetColorRow(y);
+		float* pDepth = framebuffer.GetDepthRow(y);
+		std::int64_t e0 = rowStart[0];
+		std::int64_t e1 = rowStart[1];
+		std::int64_t e2 = rowStart[2];
+		for (int x = x0; x < x1; x++)
+		{
+			if (e0 >= bias[0] && e1 >= bias[1] && e2 >= bias[2])
+			{
+				const float l0 = static_cast<float>(e0) * rcpArea;
+				const float l1 = static_cast<float>(e1) * rcpArea;
+				const float l2 = static_cast<float>(e2) * rcpArea;
+				const float z = l0 * tri.z[0] + l1 * tri.z[1] + l2 * tri.z[2];
+				if (z >= 0.0f && z <= 1.0f && z < pDepth[x])
+				{
+					const float w = 1.0f / (l0 * tri.invW[0] + l1 * tri.invW[1] + l2 * tri.invW[2]);
+					float c[4];
+					for (int k = 0; k < 4; k++)
+					{
+						c[k] = (l0 * tri.color[0][k] + l1 * tri.color[1][k] + l2 * tri.color[2][k]) * w;
+					}
+					pDepth[x] = z;
+					pColor[x] = Framebuffer::PackColor(c[0], c[1], c[2], c[3]);
+				}
+			}
+			e0 += stepX[0];
+			e1 += stepX[1];
+			e2 += stepX[2];
+		}
+		rowStart[0] += stepY[0];
+		rowStart[1] += stepY[1];
+		rowStart[2] += stepY[2];
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Framebuffer.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <vector>
+
+/* CPU reference implementation of Renderer.
+* Draws are only set up (transformed to screen space) when submitted.
+* EndFrame() bins them into screen tiles and rasterizes the tiles in
+* parallel, each tile walking its triangles in submission order, so output
+* is deterministic regardless of thread count. Used headless for golden
+* image tests and as a performance baseline without a GPU.
+*
+* Vertices are snapped to 28.4 fixed point and the edge functions are
+* evaluated exactly in 64-bit integers, so the top-left rule holds exactly
+* and meshes are watertight: shared edges are drawn exactly once.
+*
+* No near-plane clipping yet: triangles with any vertex at w <= 0 are dropped,
+* as are ones reaching past the guard band (far outside the screen), where
+* the fixed-point edge functions could overflow.
+*/
+class SoftwareRenderer : public Renderer
+{
+public:
+	struct Stats
+	{
+		std::size_t trianglesSubmitted = 0u;
+		std::size_t trianglesRejected = 0u;	// behind the camera, degenerate or off screen
+		std::size_t tileBinEntries = 0u;	// sum over tiles of triangles binned into them
+	};
+public:
+	SoftwareRenderer(int width, int height, ThreadPool& pool = ThreadPool::Default());
+	SoftwareRenderer(const SoftwareRenderer&) = delete;
+	SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+	void BeginFrame() override;
+	void ClearBuffer(float red, float green, float blue) noexcept override;
+	void DrawIndexed(const Vertex* pVertices, std::size_t vertexCount, const std::uint32_t* pIndices, std::size_t indexCount) override;
+	void EndFrame() override;
+	int GetWidth() const noexcept override;
+	int GetHeight() const noexcept override;
+	Framebuffer& GetFramebuffer() noexcept;
+	const Stats& GetStats() const noexcept;
+private:
+	// Screen-space triangle, wound so that its edge functions are positive inside
+	struct Triangle
+	{
+		std::int32_t x[3];	// 28.4 fixed point pixel coordinates
+		std::int32_t y[3];
+		std::int64_t area;	// twice the area, in 1/256ths of a pixel
+		float z[3];			// post-divide depth, interpolated linearly in screen space
+		float invW[3];		// for perspective-correct color
+		float color[3][4];	// premultiplied by invW
+		int minX, minY, maxX, maxY;	// inclusive pixel bounds, clamped to the screen
+	};
+	void SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
+	void RasterizeTile(std::size_t tileIndex) noexcept;
+	void RasterizeTriangle(const Triangle& tri, int x0, int y0, int x1, int y1) noexcept;
+private:
+	static constexpr int tileSize = 64;
+	static constexpr int subpixelBits = 4;
+	static constexpr int subpixelOne = 1 << subpixelBits;
+	// Snapped coordinates stay within +-2^27, so edge function products fit comfortably in 64 bits
+	static constexpr float guardBand = 8388608.0f;
+	ThreadPool& pool;
+	Framebuffer framebuffer;
+	int tilesX;
+	int tilesY;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<std::uint32_t>> tileBins;
+	bool clearPending = false;
+	std::uint32_t clearColor = 0u;
+	Stats stats;
+};
@@ -0,0 +1,791 @@
+#include "TexturePipeline.h"
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+namespace
+{
+	// Bump when the processing changes output, so old cache entries stop matching
+	constexpr std::uint32_t pipelineVersion = 2u;
+	constexpr char cacheMagic[4] = { 'E', 'T', 'E', 'X' };
+
+	struct CacheHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t format;
+		std::uint32_t srgb;
+		std::uint32_t mipCount;
+		std::uint32_t reserved;
+		std::uint64_t dataSize;
+	};
+	static_assert(sizeof(CacheHeader) == 48u && sizeof(Texture::Mip) == 32u && std::is_trivially_copyable_v<Texture::Mip>);
+
+	/****** DECODING ******/
+
+	// Bounds-checked little endian reads over the source bytes
+	class ByteReader
+	{
+	public:
+		explicit ByteReader(std::span<const std::byte> bytes) noexcept
+			:
+			bytes(bytes)
+		{}
+		std::span<const std::byte> Sub(std::size_t offset, std::size_t size) const
+		{
+			Check(offset, size);
+			return bytes.subspan(offset, size);
+		}
+		std::uint32_t U8(std::size_t offset) const
+		{
+			Check(offset, 1u);
+			return std::to_integer<std::uint32_t>(bytes[offset]);
+		}
+		std::uint32_t U16(std::size_t offset) const
+		{
+			return U8(offset) | U8(offset + 1u) << 8;
+		}
+		std::uint32_t U32(std::size_t offset) const
+		{
+			return U16(offset) | U16(offset + 2u) << 16;
+		}
+		std::size_t Size() const noexcept
+		{
+			return bytes.size();
+		}
+	private:
+		void Check(std::size_t offset, std::size_t size) const
+		{
+			if (offset > bytes.size() || size > bytes.size() - offset)
+			{
+				throw TEXEXCEPT("Image data is truncated");
+			}
+		}
+	private:
+		std::span<const std::byte> bytes;
+	};
+
+	constexpr std::uint32_t maxImageDimension = 16384u;
+
+	void CheckDimensions(std::int64_t width, std::int64_t height)
+	{
+		if (width <= 0 || height <= 0 || width > maxImageDimension || height > maxImageDimension)
+		{
+			throw TEXEXCEPT("Unsupported image dimensions " + std::to_string(width) + "x" + std::to_string(height));
+		}
+	}
+
+	// A BITMAPINFOHEADER-style DIB. Icons store the color bitmap then a 1bpp AND mask, with the height doubled.
+	Image DecodeDib(const ByteReader& dib, std::size_t pixelOffset, bool icon)
+	{
+		const std::uint32_t headerSize = dib.U32(0u);
+		if (headerSize < 40u)
+		{
+			throw TEXEXCEPT("Unsupported BMP header (OS/2 or core headers aren't handled)");
+		}
+		const std::int32_t width = static_cast<std::int32_t>(dib.U32(4u));
+		std::int32_t height = static_cast<std::int32_t>(dib.U32(8u));
+		const std::uint32_t bitCount = dib.U16(14u);
+		const std::uint32_t compression = dib.U32(16u);
+		std::uint32_t paletteSize = dib.U32(32u);
+		// Negative height means rows are stored top down
+		const bool topDown = height < 0;
+		height = topDown ? -height : height;
+		if (icon)
+		{
+			height /= 2;
+		}
+		CheckDimensions(width, height);
+		// BI_RGB, or BI_BITFIELDS which we only accept as the usual BGRA layout
+		if (compression != 0u && !(compression == 3u && bitCount == 32u))
+		{
+			throw TEXEXCEPT("Compressed BMPs aren't supported");
+		}
+		// The masks follow a 40 byte header, or are part of a V4/V5 one, which also has an alpha mask
+		bool alphaMasked = false;
+		if (compression == 3u)
+		{
+			const std::uint32_t alphaMask = headerSize >= 56u ? dib.U32(52u) : 0xFF000000u;
+			if (dib.U32(40u) != 0x00FF0000u || dib.U32(44u) != 0x0000FF00u || dib.U32(48u) != 0x000000FFu ||
+				(alphaMask != 0xFF000000u && alphaMask != 0u))
+			{
+				throw TEXEXCEPT("Only BGRA channel masks are supported for 32bpp BI_BITFIELDS BMPs");
+			}
+			alphaMasked = alphaMask == 0u;
+		}
+		if (bitCount != 1u && bitCount != 4u && bitCount != 8u && bitCount != 24u && bitCount != 32u)
+		{
+			throw TEXEXCEPT("Unsupported BMP bit depth " + std::to_string(bitCount));
+		}
+		if (bitCount <= 8u && paletteSize == 0u)
+		{
+			paletteSize = 1u << bitCount;
+		}
+		if (bitCount > 8u)
+		{
+			paletteSize = 0u;
+		}
+		const std::size_t paletteOffset = headerSize + (compression == 3u && headerSize == 40u ? 12u : 0u);
+		if (pixelOffset == 0u)
+		{
+			pixelOffset = paletteOffset + paletteSize * 4u;
+		}
+		const std::size_t rowSize = ((static_cast<std::size_t>(width) * bitCount + 31u) / 32u) * 4u;
+		const std::span<const std::byte> pixels = dib.Sub(pixelOffset, rowSize * height);
+		const ByteReader palette(dib.Sub(paletteOffset, paletteSize * 4u));
+
+		Image image;
+		image.width = static_cast<std::uint32_t>(width);
+		image.height = static_cast<std::uint32_t>(height);
+		image.rgba.resize(static_cast<std::size_t>(width) * height * 4u);
+		bool anyAlpha = false;
+		for (std::int32_t y = 0; y < height; y++)
+		{
+			const std::size_t srcRow = static_cast<std::size_t>(topDown ? y : height - 1 - y);
+			const ByteReader row(pixels.subspan(srcRow * rowSize, rowSize));
+			std::uint8_t* pDest = image.rgba.data() + static_cast<std::size_t>(y) * width * 4u;
+			for (std::int32_t x = 0; x < width; x++, pDest += 4)
+			{
+				std::uint32_t b, g, r, a = 255u;
+				if (bitCount <= 8u)
+				{
+					const std::size_t bit = static_cast<std::size_t>(x) * bitCount;
+					const std::uint32_t index = (row.U8(bit / 8u) >> (8u - bitCount - bit % 8u)) & ((1u << bitCount) - 1u);
+					if (index >= paletteSize)
+					{
+						throw TEXEXCEPT("BMP palette index out of range");
+					}
+					b = palette.U8(index * 4u);
+					g = palette.U8(index * 4u + 1u);
+					r = palette.U8(index * 4u + 2u);
+				}
+				else
+				{
+					const std::size_t offset = static_cast<std::size_t>(x) * (bitCount / 8u);
+					b = row.U8(offset);
+					g = row.U8(offset + 1u);
+					r = row.U8(offset + 2u);
+					if (bitCount == 32u)
+					{
+						a = row.U8(offset + 3u);
+						anyAlpha |= a != 0u;
+					}
+				}
+				pDest[0] = static_cast<std::uint8_t>(r);
+				pDest[1] = static_cast<std::uint8_t>(g);
+				pDest[2] = static_cast<std::uint8_t>(b);
+				pDest[3] = static_cast<std::uint8_t>(a);
+			}
+		}
+		// Plenty of 32bpp files leave the 4th byte at zero; treat those as opaque, same as an explicit empty alpha mask
+		if (bitCount == 32u && (!anyAlpha || alphaMasked))
+		{
+			for (std::size_t i = 3u; i < image.rgba.size(); i += 4u)
+			{
+				image.rgba[i] = 255u;
+			}
+		}
+		if (icon && bitCount < 32u)
+		{
+			// AND mask: a set bit means transparent
+			const std::size_t maskRowSize = ((static_cast<std::size_t>(width) + 31u) / 32u) * 4u;
+			const std::size_t maskOffset = pixelOffset + rowSize * height;
+			if (maskOffset + maskRowSize * height <= dib.Size())
+			{
+				for (std::int32_t y = 0; y < height; y++)
+				{
+					const ByteReader row(dib.Sub(maskOffset + static_cast<std::size_t>(height - 1 - y) * maskRowSize, maskRowSize));
+					for (std::int32_t x = 0; x < width; x++)
+					{
+						if ((row.U8(static_cast<std::size_t>(x) / 8u) >> (7u - x % 8u)) & 1u)
+						{
+							image.rgba[(static_cast<std::size_t>(y) * width + x) * 4u + 3u] = 0u;
+						}
+					}
+				}
+			}
+		}
+		return image;
+	}
+
+	Image DecodeIco(const ByteReader& file)
+	{
+		const std::uint32_t count = file.U16(4u);
+		if (count == 0u)
+		{
+			throw TEXEXCEPT("Icon has no images");
+		}
+		// Largest entry wins; a stored size of 0 means 256
+		std::size_t best = 0u;
+		std::uint32_t bestArea = 0u;
+		for (std::uint32_t i = 0u; i < count; i++)
+		{
+			const std::size_t entry = 6u + i * 16u;
+			const std::uint32_t w = file.U8(entry) ? file.U8(entry) : 256u;
+			const std::uint32_t h = file.U8(entry + 1u) ? file.U8(entry + 1u) : 256u;
+			if (w * h > bestArea)
+			{
+				bestArea = w * h;
+				best = entry;
+			}
+		}
+		const ByteReader dib(file.Sub(file.U32(best + 12u), file.U32(best + 8u)));
+		if (dib.U32(0u) == 0x474E5089u)
+		{
+			throw TEXEXCEPT("PNG-compressed icons aren't supported");
+		}
+		return DecodeDib(dib, 0u, true);
+	}
+
+	// Binary PPM (P6) with maxval 255, what Framebuffer::SavePpm writes
+	Image DecodePpm(const ByteReader& file)
+	{
+		std::size_t cursor = 2u;
+		const auto nextNumber = [&]() -> std::uint32_t
+		{
+			for (;;)
+			{
+				const std::uint32_t c = file.U8(cursor);
+				if (c == '#')
+				{
+					while (file.U8(cursor) != '\n')
+					{
+						cursor++;
+					}
+				}
+				else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+				{
+					cursor++;
+				}
+				else
+				{
+					break;
+				}
+			}
+			std::uint32_t value = 0u;
+			std::uint32_t digits = 0u;
+			for (std::uint32_t c = file.U8(cursor); c >= '0' && c <= '9' && digits < 9u; c = file.U8(++cursor), digits++)
+			{
+				value = value * 10u + (c - '0');
+			}
+			if (digits == 0u)
+			{
+				throw TEXEXCEPT("Malformed PPM header");
+			}
+			return value;
+		};
+		const std::uint32_t width = nextNumber();
+		const std::uint32_t height = nextNumber();
+		const std::uint32_t maxValue = nextNumber();
+		CheckDimensions(width, height);
+		if (maxValue != 255u)
+		{
+			throw TEXEXCEPT("Only 8-bit PPMs are supported");
+		}
+		// Exactly one whitespace byte separates the header from the pixels
+		const ByteReader pixels(file.Sub(cursor + 1u, static_cast<std::size_t>(width) * height * 3u));
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.rgba.resize(static_cast<std::size_t>(width) * height * 4u);
+		for (std::size_t i = 0u, count = static_cast<std::size_t>(width) * height; i < count; i++)
+		{
+			image.rgba[i * 4u] = static_cast<std::uint8_t>(pixels.U8(i * 3u));
+			image.rgba[i * 4u + 1u] = static_cast<std::uint8_t>(pixels.U8(i * 3u + 1u));
+			image.rgba[i * 4u + 2u] = static_cast<std::uint8_t>(pixels.U8(i * 3u + 2u));
+			image.rgba[i * 4u + 3u] = 255u;
+		}
+		return image;
+	}
+
+	/****** MIPS ******/
+
+	// sRGB <-> linear tables; the encode side is indexed by linear value quantized to 12 bits
+	constexpr std::size_t linearLevels = 4096u;
+	struct ColorTables
+	{
+		std::array<float, 256> srgbToLinear;
+		std::array<std::uint8_t, linearLevels> linearToSrgb;
+	};
+
+	const ColorTables& GetColorTables() noexcept
+	{
+		static const ColorTables tables = []
+		{
+			ColorTables t;
+			for (std::size_t i = 0u; i < 256u; i++)
+			{
+				const float c = static_cast<float>(i) / 255.0f;
+				t.srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (std::size_t i = 0u; i < linearLevels; i++)
+			{
+				const float l = static_cast<float>(i) / static_cast<float>(linearLevels - 1u);
+				const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				t.linearToSrgb[i] = static_cast<std::uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			return t;
+		}();
+		return tables;
+	}
+
+	// One row of float RGBA -> RGBA8, color through the sRGB curve if asked; alpha is always linear
+	void EncodeRow(const float* pSrc, std::uint8_t* pDest, std::uint32_t width, bool srgb) noexcept
+	{
+		const ColorTables& tables = GetColorTables();
+		const float colorScale = srgb ? static_cast<float>(linearLevels - 1u) : 255.0f;
+		for (std::uint32_t x = 0u; x < width; x++, pSrc += 4, pDest += 4)
+		{
+			std::int32_t q[4];
+#if defined(SIMDMATH_SSE)
+			const __m128 scale = _mm_setr_ps(colorScale, colorScale, colorScale, 255.0f);
+			const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), _mm_set1_ps(0.5f))));
+#elif defined(SIMDMATH_NEON)
+			const float scaleValues[4] = { colorScale, colorScale, colorScale, 255.0f };
+			const float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(pSrc), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+			vst1q_s32(q, vcvtq_s32_f32(vaddq_f32(vmulq_f32(clamped, vld1q_f32(scaleValues)), vdupq_n_f32(0.5f))));
+#else
+			for (int k = 0; k < 4; k++)
+			{
+				q[k] = static_cast<std::int32_t>(std::clamp(pSrc[k], 0.0f, 1.0f) * (k < 3 ? colorScale : 255.0f) + 0.5f);
+			}
+#endif
+			for (int k = 0; k < 3; k++)
+			{
+				pDest[k] = srgb ? tables.linearToSrgb[q[k]] : static_cast<std::uint8_t>(q[k]);
+			}
+			pDest[3] = static_cast<std::uint8_t>(q[3]);
+		}
+	}
+
+	// Source pixels feeding destination pixel i along one axis, and their weights. Even sizes are a plain 2-tap box.
+	// Odd sizes (2n + 1 -> n) take 3 taps weighted by how much of each source pixel the destination pixel covers,
+	// so the last row/column isn't dropped. A size of 1 stays 1.
+	struct FilterTaps
+	{
+		std::uint32_t first;
+		std::uint32_t count;
+		float weights[3];
+	};
+
+	FilterTaps GetFilterTaps(std::uint32_t srcSize, std::uint32_t destSize, std::uint32_t i) noexcept
+	{
+		if (srcSize == 1u)
+		{
+			return { 0u, 1u, { 1.0f, 0.0f, 0.0f } };
+		}
+		if (srcSize % 2u == 0u)
+		{
+			return { 2u * i, 2u, { 0.5f, 0.5f, 0.0f } };
+		}
+		const float scale = 1.0f / static_cast<float>(srcSize);
+		return { 2u * i, 3u, { static_cast<float>(destSize - i) * scale, static_cast<float>(destSize) * scale, static_cast<float>(i + 1u) * scale } };
+	}
+
+	// One destination row of the mip filter: a 2x2 box, widened to 3 taps along odd dimensions
+	void DownsampleRow(const float* pSrc, std::uint32_t srcWidth, std::uint32_t srcHeight, float* pDest, std::uint32_t destWidth, std::uint32_t destHeight, std::uint32_t y) noexcept
+	{
+		const FilterTaps rows = GetFilterTaps(srcHeight, destHeight, y);
+		const std::size_t rowStride = static_cast<std::size_t>(srcWidth) * 4u;
+		const float* pRow0 = pSrc + rows.first * rowStride;
+		for (std::uint32_t x = 0u; x < destWidth; x++, pDest += 4)
+		{
+			const FilterTaps cols = GetFilterTaps(srcWidth, destWidth, x);
+			const float* pTap = pRow0 + cols.first * 4u;
+			if (rows.count == 2u && cols.count == 2u)
+			{
+				// The common case, straight 2x2 average
+#if defined(SIMDMATH_SSE)
+				const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pTap), _mm_loadu_ps(pTap + 4)),
+					_mm_add_ps(_mm_loadu_ps(pTap + rowStride), _mm_loadu_ps(pTap + rowStride + 4)));
+				_mm_storeu_ps(pDest, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#elif defined(SIMDMATH_NEON)
+				const float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(pTap), vld1q_f32(pTap + 4)),
+					vaddq_f32(vld1q_f32(pTap + rowStride), vld1q_f32(pTap + rowStride + 4)));
+				vst1q_f32(pDest, vmulq_n_f32(sum, 0.25f));
+#else
+				for (int k = 0; k < 4; k++)
+				{
+					pDest[k] = (pTap[k] + pTap[4 + k] + pTap[rowStride + k] + pTap[rowStride + 4 + k]) * 0.25f;
+				}
+#endif
+				continue;
+			}
+			float sum[4] = {};
+			for (std::uint32_t r = 0u; r < rows.count; r++)
+			{
+				for (std::uint32_t c = 0u; c < cols.count; c++)
+				{
+					const float weight = rows.weights[r] * cols.weights[c];
+					const float* pPixel = pTap + r * rowStride + c * 4u;
+					for (int k = 0; k < 4; k++)
+					{
+						sum[k] += pPixel[k] * weight;
+					}
+				}
+			}
+			std::memcpy(pDest, sum, sizeof(sum));
+		}
+	}
+
+	// Rows per parallel job; about 64KB of float pixels for a 1K wide image
+	std::size_t RowGrain(std::uint32_t width) noexcept
+	{
+		return std::max<std::size_t>(1u, 16384u / std::max(width, 1u));
+	}
+}
+
+TexturePipeline::TexturePipeline(ThreadPool& pool, std::string cacheDirectory)
+	:
+	pool(pool),
+	cacheDirectory(std::move(cacheDirectory))
+{}
+
+Texture TexturePipeline::Build(const Image& image, const TextureSettings& settings)
+{
+	if (image.width == 0u || image.height == 0u || image.rgba.size() != static_cast<std::size_t>(image.width) * image.height * 4u)
+	{
+		throw TEXEXCEPT("Image size doesn't match its pixel data");
+	}
+	if (cacheDirectory.empty())
+	{
+		return Process(image, settings);
+	}
+	const std::uint64_t key = ComputeKey(image, settings);
+	Texture texture;
+	if (TryLoadCached(key, texture))
+	{
+		stats.cacheHits++;
+		return texture;
+	}
+	stats.cacheMisses++;
+	texture = Process(image, settings);
+	if (!StoreCached(key, texture))
+	{
+		stats.cacheWriteFailures++;
+	}
+	return texture;
+}
+
+Texture TexturePipeline::BuildFile(const std::string& path, const TextureSettings& settings)
+{
+	return Build(DecodeFile(path), settings);
+}
+
+const TexturePipeline::Stats& TexturePipeline::GetStats() const noexcept
+{
+	return stats;
+}
+
+Image TexturePipeline::Decode(std::span<const std::byte> bytes)
+{
+	const ByteReader file(bytes);
+	if (file.Size() >= 2u && file.U16(0u) == 0x4D42u)	// "BM"
+	{
+		const ByteReader dib(file.Sub(14u, file.Size() - 14u));
+		const std::size_t pixelOffset = file.U32(10u);
+		if (pixelOffset < 14u)
+		{
+			throw TEXEXCEPT("Bad BMP pixel offset");
+		}
+		return DecodeDib(dib, pixelOffset - 14u, false);
+	}
+	if (file.Size() >= 4u && file.U16(0u) == 0u && file.U16(2u) == 1u)
+	{
+		return DecodeIco(file);
+	}
+	if (file.Size() >= 2u && file.U8(0u) == 'P' && file.U8(1u) == '6')
+	{
+		return DecodePpm(file);
+	}
+	throw TEXEXCEPT("Unrecognized image format");
+}
+
+Image TexturePipeline::DecodeFile(const std::string& path)
+{
+	try
+	{
+		const MappedFile file(path);
+		return Decode(file.GetBytes());
+	}
+	catch (const Exception& e)
+	{
+		throw TEXEXCEPT(path + ": " + e.GetNote());
+	}
+	catch (const MappedFile::Exception& e)
+	{
+		throw TEXEXCEPT(e.GetNote());
+	}
+}
+
+std::uint64_t TexturePipeline::ComputeKey(const Image& image, const TextureSettings& settings) noexcept
+{
+	Fnv1a hash;
+	hash.AddValue(pipelineVersion);
+	hash.AddValue(image.width);
+	hash.AddValue(image.height);
+	hash.AddValue(settings.format);
+	hash.AddValue(settings.srgb);
+	hash.AddValue(settings.generateMips);
+	hash.Add(image.rgba.data(), image.rgba.size());
+	return hash.Get();
+}
+
+Texture TexturePipeline::Process(const Image& image, const TextureSettings& settings)
+{
+	const bool compressed = settings.format != TextureFormat::RGBA8;
+	if (compressed && (image.width % 4u != 0u || image.height % 4u != 0u))
+	{
+		throw TEXEXCEPT("Block compressed textures need dimensions that are a multiple of 4");
+	}
+	const std::uint32_t mipCount = settings.generateMips ? std::bit_width(std::max(image.width, image.height)) : 1u;
+	const unsigned int blockSize = settings.format == TextureFormat::BC1 ? bc1BlockSize : bc3BlockSize;
+
+	Texture texture;
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.format = settings.format;
+	texture.srgb = settings.srgb;
+	std::uint64_t dataSize = 0u;
+	for (std::uint32_t level = 0u; level < mipCount; level++)
+	{
+		Texture::Mip mip = {};
+		mip.width = std::max(image.width >> level, 1u);
+		mip.height = std::max(image.height >> level, 1u);
+		mip.rowPitch = compressed ? ((mip.width + 3u) / 4u) * blockSize : mip.width * 4u;
+		mip.rowCount = compressed ? (mip.height + 3u) / 4u : mip.height;
+		mip.offset = dataSize;
+		mip.size = static_cast<std::uint64_t>(mip.rowPitch) * mip.rowCount;
+		dataSize += mip.size;
+		texture.mips.push_back(mip);
+	}
+	texture.data.resize(static_cast<std::size_t>(dataSize));
+
+	// Build the RGBA8 chain: level 0 is the source as-is, each further level is filtered in float
+	std::vector<std::vector<std::uint8_t>> levels(mipCount);
+	levels[0] = image.rgba;
+	if (mipCount > 1u)
+	{
+		const ColorTables& tables = GetColorTables();
+		std::vector<float> current(image.rgba.size());
+		std::vector<float> next;
+		pool.ParallelFor(image.height, RowGrain(image.width), [&](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin * image.width * 4u; i < end * image.width * 4u; i++)
+			{
+				const std::uint8_t value = image.rgba[i];
+				current[i] = (settings.srgb && i % 4u != 3u) ? tables.srgbToLinear[value] : value / 255.0f;
+			}
+		});
+		for (std::uint32_t level = 1u; level < mipCount; level++)
+		{
+			const Texture::Mip& src = texture.mips[level - 1u];
+			const Texture::Mip& dest = texture.mips[level];
+			next.resize(static_cast<std::size_t>(dest.width) * dest.height * 4u);
+			levels[level].resize(next.size());
+			pool.ParallelFor(dest.height, RowGrain(dest.width), [&](std::size_t begin, std::size_t end)
+			{
+				for (std::size_t y = begin; y < end; y++)
+				{
+					float* pRow = next.data() + y * dest.width * 4u;
+					DownsampleRow(current.data(), src.width, src.height, pRow, dest.width, dest.height, static_cast<std::uint32_t>(y));
+					EncodeRow(pRow, levels[level].data() + y * dest.width * 4u, dest.width, settings.srgb);
+				}
+			});
+			current.swap(next);
+		}
+	}
+
+	// Final pass: every mip's rows (or rows of blocks) as one flat list, so the whole pool stays busy
+	std::vector<std::size_t> firstRow(mipCount + 1u, 0u);
+	for (std::uint32_t level = 0u; level < mipCount; level++)
+	{
+		firstRow[level + 1u] = firstRow[level] + texture.mips[level].rowCount;
+	}
+	pool.ParallelFor(firstRow.back(), compressed ? 8u : 64u, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t flatRow = begin; flatRow < end; flatRow++)
+		{
+			const std::uint32_t level = static_cast<std::uint32_t>(std::upper_bound(firstRow.begin(), firstRow.end(), flatRow) - firstRow.begin() - 1);
+			const Texture::Mip& mip = texture.mips[level];
+			const std::uint32_t row = static_cast<std::uint32_t>(flatRow - firstRow[level]);
+			const std::uint8_t* pSrc = levels[level].data();
+			std::uint8_t* pDest = texture.data.data() + mip.offset + static_cast<std::size_t>(row) * mip.rowPitch;
+			if (!compressed)
+			{
+				std::memcpy(pDest, pSrc + static_cast<std::size_t>(row) * mip.width * 4u, mip.rowPitch);
+				continue;
+			}
+			for (std::uint32_t blockX = 0u; blockX < (mip.width + 3u) / 4u; blockX++, pDest += blockSize)
+			{
+				// Gather the 4x4 block, clamping at the edges of mips smaller than a block
+				std::uint8_t block[64];
+				for (std::uint32_t y = 0u; y < 4u; y++)
+				{
+					const std::uint32_t srcY = std::min(row * 4u + y, mip.height - 1u);
+					for (std::uint32_t x = 0u; x < 4u; x++)
+					{
+						const std::uint32_t srcX = std::min(blockX * 4u + x, mip.width - 1u);
+						std::memcpy(block + (y * 4u + x) * 4u, pSrc + (static_cast<std::size_t>(srcY) * mip.width + srcX) * 4u, 4u);
+					}
+				}
+				if (settings.format == TextureFormat::BC1)
+				{
+					EncodeBc1Block(block, pDest);
+				}
+				else
+				{
+					EncodeBc3Block(block, pDest);
+				}
+			}
+		}
+	});
+	stats.texturesBuilt++;
+	return texture;
+}
+
+bool TexturePipeline::TryLoadCached(std::uint64_t key, Texture& texture) const
+{
+	const std::string path = GetCachePath(key);
+	std::error_code error;
+	if (!std::filesystem::exists(path, error))
+	{
+		return false;
+	}
+	MappedFile file;
+	try
+	{
+		file = MappedFile(path);
+	}
+	catch (const MappedFile::Exception&)
+	{
+		return false;
+	}
+	const std::span<const std::byte> bytes = file.GetBytes();
+	CacheHeader header;
+	if (bytes.size() < sizeof(header))
+	{
+		return false;
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != pipelineVersion || header.key != key ||
+		header.mipCount == 0u || header.mipCount > 32u || header.format > static_cast<std::uint32_t>(TextureFormat::BC3))
+	{
+		return false;
+	}
+	// Compared against what's left rather than summed, so a crafted dataSize can't wrap the total around
+	const std::size_t tableEnd = sizeof(header) + header.mipCount * sizeof(Texture::Mip);
+	if (bytes.size() < tableEnd || header.dataSize != bytes.size() - tableEnd)
+	{
+		return false;
+	}
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.format = static_cast<TextureFormat>(header.format);
+	texture.srgb = header.srgb != 0u;
+	texture.mips.resize(header.mipCount);
+	std::memcpy(texture.mips.data(), bytes.data() + sizeof(header), header.mipCount * sizeof(Texture::Mip));
+	for (const Texture::Mip& mip : texture.mips)
+	{
+		if (mip.offset > header.dataSize || mip.size > header.dataSize - mip.offset)
+		{
+			return false;
+		}
+	}
+	const std::byte* pData = bytes.data() + tableEnd;
+	texture.data.resize(static_cast<std::size_t>(header.dataSize));
+	std::memcpy(texture.data.data(), pData, texture.data.size());
+	return true;
+}
+
+bool TexturePipeline::StoreCached(std::uint64_t key, const Texture& texture) const
+{
+	CacheHeader header = {};
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = pipelineVersion;
+	header.key = key;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.format = static_cast<std::uint32_t>(texture.format);
+	header.srgb = texture.srgb ? 1u : 0u;
+	header.mipCount = static_cast<std::uint32_t>(texture.mips.size());
+	header.dataSize = texture.data.size();
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	// Write to a temp file and rename, so a crash or a concurrent reader never sees half a file.
+	// Two builds of the same texture (another thread or process) each get their own temp file; the last rename wins.
+	const std::string path = GetCachePath(key);
+	const std::string tempPath = MakeTempPath(path);
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(texture.mips.data()), static_cast<std::streamsize>(texture.mips.size() * sizeof(Texture::Mip)));
+		file.write(reinterpret_cast<const char*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+std::string TexturePipeline::GetCachePath(std::uint64_t key) const
+{
+	static constexpr char digits[] = "0123456789abcdef";
+	std::string name(16u, '0');
+	for (int i = 15; i >= 0; i--, key >>= 4u)
+	{
+		name[i] = digits[key & 0xFu];
+	}
+	return (std::filesystem::path(cacheDirectory) / (name + ".etex")).string();
+}
+
+// Texture pipeline exception stuff
+TexturePipeline::Exception::Exception(int line, const char* file, std::string note) noexcept
+	:
+	EggCeption(line, file),
+	note(std::move(note))
+{}
+
+const char* TexturePipeline::Exception::what() const noexcept
+{
+	std::ostringstream strStream;
+	strStream << GetType() << std::endl
+			  << "[Note] " << GetNote() << std::endl
+			  << GetOriginString();
+	whatBuffer = strStream.str();
+	return whatBuffer.c_str();
+}
+
+const char* TexturePipeline::Exception::GetType() const noexcept
+{
+	return "EggCeption: Texture Pipeline Exception";
+}
+
+const std::string& TexturePipeline::Exception::GetNote() const noexcept
+{
+	return note;
+}
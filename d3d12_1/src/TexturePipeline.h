@@ -0,0 +1,109 @@
+#pragma once
+
+#include "EggCeption.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Decoded source image, RGBA8, rows tightly packed top to bottom
+struct Image
+{
+	std::uint32_t width = 0u;
+	std::uint32_t height = 0u;
+	std::vector<std::uint8_t> rgba;
+};
+
+enum class TextureFormat : std::uint8_t
+{
+	RGBA8,
+	BC1,
+	BC3
+};
+
+struct TextureSettings
+{
+	TextureFormat format = TextureFormat::RGBA8;
+	// Color data is sRGB encoded: mips are filtered in linear space and the texture is meant for an _SRGB view
+	bool srgb = true;
+	bool generateMips = true;
+};
+
+// Ready-to-upload texture; every mip lives in data at its offset
+struct Texture
+{
+	struct Mip
+	{
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t rowPitch;		// bytes per row of pixels, or per row of 4x4 blocks for BC formats
+		std::uint32_t rowCount;		// rows of pixels or of blocks
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+	std::uint32_t width = 0u;
+	std::uint32_t height = 0u;
+	TextureFormat format = TextureFormat::RGBA8;
+	bool srgb = false;
+	std::vector<Mip> mips;
+	std::vector<std::uint8_t> data;
+};
+
+/* Image -> Texture: mip chain generation and optional BC1/BC3 compression.
+* Each mip is a 2x2 box filter of the one above (3 taps across odd sizes,
+* so edges aren't dropped), done in float (linear light for sRGB) with
+* SSE/NEON, split into row bands across the pool.
+* Once the chain exists, the 8-bit conversion / block compression of every
+* mip runs as one flat batch of bands, so small mips don't leave cores idle.
+*
+* With a cache directory, results are stored as <content hash>.etex, keyed
+* on the decoded pixels plus settings, so repeat runs skip the work. A
+* corrupt or stale cache file just counts as a miss. Call Build() from one
+* thread at a time; the parallelism is inside it.
+*/
+class TexturePipeline
+{
+public:
+	class Exception : public EggCeption
+	{
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	struct Stats
+	{
+		std::size_t cacheHits = 0u;
+		std::size_t cacheMisses = 0u;
+		std::size_t texturesBuilt = 0u;
+		std::size_t cacheWriteFailures = 0u;	// the texture is still returned, it just won't be cached
+	};
+public:
+	// Empty cacheDirectory disables caching
+	explicit TexturePipeline(ThreadPool& pool, std::string cacheDirectory = {});
+	TexturePipeline(const TexturePipeline&) = delete;
+	TexturePipeline& operator=(const TexturePipeline&) = delete;
+	Texture Build(const Image& image, const TextureSettings& settings);
+	Texture BuildFile(const std::string& path, const TextureSettings& settings);
+	const Stats& GetStats() const noexcept;
+	// BMP (1/4/8/24/32 bpp, uncompressed), ICO (BMP entries, largest one wins) and binary PPM
+	static Image Decode(std::span<const std::byte> bytes);
+	static Image DecodeFile(const std::string& path);
+	static std::uint64_t ComputeKey(const Image& image, const TextureSettings& settings) noexcept;
+private:
+	Texture Process(const Image& image, const TextureSettings& settings);
+	bool TryLoadCached(std::uint64_t key, Texture& texture) const;
+	bool StoreCached(std::uint64_t key, const Texture& texture) const;
+	std::string GetCachePath(std::uint64_t key) const;
+private:
+	ThreadPool& pool;
+	std::string cacheDirectory;
+	Stats stats;
+};
+
+#define TEXEXCEPT(note) TexturePipeline::Exception(__LINE__, __FILE__, (note))
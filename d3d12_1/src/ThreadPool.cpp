@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0u)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1u ? hardwareThreads - 1u : 1u;
+	}
+	workers.reserve(threadCount);
+	for (unsigned int i = 0u; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return jobs.empty() && activeJobs == 0u; });
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& func)
+{
+	if (count == 0u)
+	{
+		return;
+	}
+	grainSize = std::max<std::size_t>(grainSize, 1u);
+	const std::size_t rangeCount = (count + grainSize - 1u) / grainSize;
+	if (rangeCount == 1u)
+	{
+		func(0u, count);
+		return;
+	}
+
+	// Shared state lives on the heap so helpers that start late never touch a dead stack frame
+	struct Batch
+	{
+		std::atomic<std::size_t> nextRange{ 0u };
+		std::atomic<std::size_t> rangesDone{ 0u };
+		std::mutex doneMutex;
+		std::condition_variable doneSignal;
+	};
+	auto pBatch = std::make_shared<Batch>();
+	// Each helper (and the caller) keeps grabbing ranges until none are left
+	auto drain = [pBatch, count, grainSize, rangeCount, &func]()
+	{
+		std::size_t range;
+		while ((range = pBatch->nextRange.fetch_add(1u)) < rangeCount)
+		{
+			const std::size_t begin = range * grainSize;
+			func(begin, std::min(begin + grainSize, count));
+			if (pBatch->rangesDone.fetch_add(1u) + 1u == rangeCount)
+			{
+				std::lock_guard<std::mutex> lock(pBatch->doneMutex);
+				pBatch->doneSignal.notify_all();
+			}
+		}
+	};
+
+	const std::size_t helperCount = std::min<std::size_t>(workers.size(), rangeCount - 1u);
+	for (std::size_t i = 0u; i < helperCount; i++)
+	{
+		Submit(drain);
+	}
+	drain();
+
+	std::unique_lock<std::mutex> lock(pBatch->doneMutex);
+	pBatch->doneSignal.wait(lock, [&] { return pBatch->rangesDone.load() == rangeCount; });
+}
+
+unsigned int ThreadPool::GetConcurrency() const noexcept
+{
+	return static_cast<unsigned int>(workers.size()) + 1u;
+}
+
+ThreadPool& ThreadPool::Default()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+			activeJobs++;
+		}
+		job();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeJobs--;
+			if (jobs.empty() && activeJobs == 0u)
+			{
+				idle.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads pulling jobs off a shared queue.
+* ParallelFor() is the main entry point: it splits [0, count) into ranges,
+* hands them to the workers and also works on them from the calling thread,
+* then blocks until every range is done. Jobs must not throw.
+*/
+class ThreadPool
+{
+public:
+	// threadCount = 0 -> one worker per hardware thread, minus the caller
+	explicit ThreadPool(unsigned int threadCount = 0u);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	// Fire and forget - no way to wait on it besides WaitIdle()
+	void Submit(std::function<void()> job);
+	void WaitIdle();
+	// func(begin, end) is called for consecutive ranges of at most grainSize items
+	void ParallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& func);
+	// Workers + the calling thread
+	unsigned int GetConcurrency() const noexcept;
+	// Process-wide pool, created on first use
+	static ThreadPool& Default();
+private:
+	void WorkerLoop();
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable idle;
+	std::size_t activeJobs = 0u;
+	bool stopping = false;
+};
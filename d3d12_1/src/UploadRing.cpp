@@ -0,0 +1,127 @@
+#include "UploadRing.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+UploadRing::UploadRing(std::size_t capacity, Fence& fence)
+	:
+	fence(fence),
+	capacity((std::max<std::size_t>(capacity, 1u) + baseAlignment - 1u) & ~(baseAlignment - 1u)),
+	// Over-allocate so the usable part can start on a baseAlignment boundary
+	pStorage(std::make_unique<std::byte[]>(this->capacity + baseAlignment))
+{
+	const std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(pStorage.get());
+	pBase = pStorage.get() + (((raw + baseAlignment - 1u) & ~static_cast<std::uintptr_t>(baseAlignment - 1u)) - raw);
+	stats.capacity = this->capacity;
+}
+
+UploadRing::Allocation UploadRing::Allocate(std::size_t size, std::size_t alignment)
+{
+	assert(alignment != 0u && (alignment & (alignment - 1u)) == 0u && alignment <= baseAlignment);
+	if (size > capacity)
+	{
+		return AllocateDedicated(size, alignment);
+	}
+	Allocation allocation;
+	while (!TryAllocateFromRing(size, alignment, allocation))
+	{
+		if (frames.empty())
+		{
+			// The frame being recorded has filled the ring by itself - waiting won't help
+			return AllocateDedicated(size, alignment);
+		}
+		// Ring full: wait for the oldest frame in flight to finish on the GPU
+		stats.stalls++;
+		fence.Wait(frames.front().fenceValue);
+		Retire(fence.GetCompletedValue());
+	}
+	return allocation;
+}
+
+void UploadRing::EndFrame(std::uint64_t fenceValue)
+{
+	assert((frames.empty() || frames.back().fenceValue <= fenceValue) && "fence values must not go backwards");
+	frames.push_back({ head, fenceValue });
+	// Dedicated blocks from this frame are untagged and sit at the back
+	for (auto it = dedicated.rbegin(); it != dedicated.rend() && it->fenceValue == 0u; ++it)
+	{
+		it->fenceValue = fenceValue;
+	}
+}
+
+void UploadRing::Retire(std::uint64_t completedFenceValue)
+{
+	while (!frames.empty() && frames.front().fenceValue <= completedFenceValue)
+	{
+		tail = frames.front().head;
+		frames.pop_front();
+	}
+	while (!dedicated.empty() && dedicated.front().fenceValue != 0u && dedicated.front().fenceValue <= completedFenceValue)
+	{
+		stats.dedicatedBytesLive -= dedicated.front().size;
+		dedicated.pop_front();
+	}
+	UpdateUsage();
+}
+
+const UploadRing::Stats& UploadRing::GetStats() const noexcept
+{
+	return stats;
+}
+
+bool UploadRing::TryAllocateFromRing(std::size_t size, std::size_t alignment, Allocation& out) noexcept
+{
+	std::uint64_t position = (head + alignment - 1u) & ~static_cast<std::uint64_t>(alignment - 1u);
+	std::size_t offset = static_cast<std::size_t>(position % capacity);
+	// Allocations never wrap; skip the leftover at the end of the ring instead
+	std::uint64_t waste = 0u;
+	if (offset + size > capacity)
+	{
+		waste = capacity - offset;
+		position += waste;
+		offset = 0u;
+	}
+	if (position + size - tail > capacity)
+	{
+		return false;
+	}
+	stats.wrapWaste += waste;
+	head = position + size;
+	out.pCpu = pBase + offset;
+	out.gpuAddress = gpuBase + offset;
+	out.size = size;
+	out.isDedicated = false;
+	stats.allocations++;
+	stats.bytesAllocated += size;
+	UpdateUsage();
+	return true;
+}
+
+UploadRing::Allocation UploadRing::AllocateDedicated(std::size_t size, std::size_t alignment)
+{
+	DedicatedBlock block;
+	block.pMemory = std::make_unique<std::byte[]>(size + alignment);
+	block.size = size;
+	block.fenceValue = 0u;
+	const std::uintptr_t raw = reinterpret_cast<std::uintptr_t>(block.pMemory.get());
+	const std::size_t adjust = static_cast<std::size_t>(((raw + alignment - 1u) & ~static_cast<std::uintptr_t>(alignment - 1u)) - raw);
+
+	Allocation allocation;
+	allocation.pCpu = block.pMemory.get() + adjust;
+	// A real backend would create a committed upload buffer here and use its VA
+	allocation.gpuAddress = reinterpret_cast<std::uintptr_t>(allocation.pCpu);
+	allocation.size = size;
+	allocation.isDedicated = true;
+	dedicated.push_back(std::move(block));
+	stats.allocations++;
+	stats.bytesAllocated += size;
+	stats.dedicatedAllocations++;
+	stats.dedicatedBytesLive += size;
+	return allocation;
+}
+
+void UploadRing::UpdateUsage() noexcept
+{
+	stats.used = static_cast<std::size_t>(head - tail);
+	stats.highWaterMark = std::max(stats.highWaterMark, stats.used);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Fence.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+/* Staging allocator for CPU -> GPU uploads (constants, vertices, texels).
+* Sub-allocates from one big persistently mapped block used as a ring.
+* Everything allocated between two EndFrame() calls is tagged with that
+* frame's fence value, and Retire() moves the tail forward past frames whose
+* fence has completed. On the common path Allocate() is a couple of adds.
+*
+* If the ring is full, Allocate() waits on the oldest frame's fence (counted
+* as a stall). Requests bigger than the ring can ever hold go to a dedicated
+* block instead, freed through the same fence mechanism.
+*/
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		std::byte* pCpu = nullptr;
+		std::uint64_t gpuAddress = 0u;
+		std::size_t size = 0u;
+		bool isDedicated = false;	// came from the oversized fallback path
+	};
+	struct Stats
+	{
+		std::size_t capacity = 0u;
+		std::size_t used = 0u;				// bytes between tail and head, incl. padding
+		std::size_t highWaterMark = 0u;
+		std::uint64_t allocations = 0u;
+		std::uint64_t bytesAllocated = 0u;
+		std::uint64_t wrapWaste = 0u;		// bytes skipped at the end of the ring when wrapping
+		std::uint64_t stalls = 0u;			// times Allocate() had to wait on the fence
+		std::uint64_t dedicatedAllocations = 0u;
+		std::size_t dedicatedBytesLive = 0u;
+	};
+public:
+	// capacity is rounded up to a multiple of the base alignment
+	UploadRing(std::size_t capacity, Fence& fence);
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+	// alignment must be a power of 2, at most baseAlignment
+	Allocation Allocate(std::size_t size, std::size_t alignment = 256u);
+	// Tags everything allocated since the last EndFrame with fenceValue
+	void EndFrame(std::uint64_t fenceValue);
+	// Reclaims every frame whose fence value is <= completedFenceValue
+	void Retire(std::uint64_t completedFenceValue);
+	const Stats& GetStats() const noexcept;
+public:
+	// D3D12 wants 512 for texture data, a page covers everything
+	static constexpr std::size_t baseAlignment = 4096u;
+private:
+	struct FrameMark
+	{
+		std::uint64_t head;		// ring position at the end of the frame
+		std::uint64_t fenceValue;
+	};
+	struct DedicatedBlock
+	{
+		std::unique_ptr<std::byte[]> pMemory;
+		std::size_t size;
+		std::uint64_t fenceValue;	// 0 until the owning frame ends
+	};
+	bool TryAllocateFromRing(std::size_t size, std::size_t alignment, Allocation& out) noexcept;
+	Allocation AllocateDedicated(std::size_t size, std::size_t alignment);
+	void UpdateUsage() noexcept;
+private:
+	// Fake GPU VA of the ring, so addresses are recognizable in a debugger
+	static constexpr std::uint64_t gpuBase = 0x0000300000000000ull;
+	Fence& fence;
+	std::size_t capacity;
+	std::unique_ptr<std::byte[]> pStorage;
+	std::byte* pBase;
+	// Monotonic byte positions; offset in the ring is position % capacity
+	std::uint64_t head = 0u;
+	std::uint64_t tail = 0u;
+	std::deque<FrameMark> frames;
+	std::deque<DedicatedBlock> dedicated;
+	Stats stats;
+};
@@ -0,0 +1,489 @@
+#include "Visibility.h"
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	// Objects per parallel range; big enough that a range is worth a job, multiple of 8 to keep SIMD loops whole
+	constexpr std::size_t cullGrain = 16u * 1024u;
+
+	// Writes index + bit for every set bit of visibleMask, returns how many
+	inline std::size_t WriteVisible(unsigned int visibleMask, std::size_t index, std::uint32_t* pOut) noexcept
+	{
+		std::size_t n = 0u;
+		for (; visibleMask != 0u; visibleMask &= visibleMask - 1u)
+		{
+			pOut[n++] = static_cast<std::uint32_t>(index + std::countr_zero(visibleMask));
+		}
+		return n;
+	}
+
+#if defined(SIMDMATH_NEON)
+	inline unsigned int MoveMask(uint32x4_t m) noexcept
+	{
+		return (vgetq_lane_u32(m, 0) & 1u) | (vgetq_lane_u32(m, 1) & 2u) | (vgetq_lane_u32(m, 2) & 4u) | (vgetq_lane_u32(m, 3) & 8u);
+	}
+#endif
+
+	// Scalar tests; the SIMD paths do exactly the same arithmetic in the same order
+	inline float PlaneDistance(const Vec4& plane, float x, float y, float z) noexcept
+	{
+		return plane.x * x + plane.y * y + plane.z * z + plane.w;
+	}
+
+	std::size_t CullSpheresScalarRange(const Frustum& frustum, const BoundingSpheres& spheres, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept
+	{
+		const float* pX = spheres.GetX();
+		const float* pY = spheres.GetY();
+		const float* pZ = spheres.GetZ();
+		const float* pR = spheres.GetRadius();
+		std::size_t n = 0u;
+		for (std::size_t i = begin; i < end; i++)
+		{
+			bool culled = false;
+			for (const Vec4& plane : frustum.planes)
+			{
+				culled |= PlaneDistance(plane, pX[i], pY[i], pZ[i]) < -pR[i];
+			}
+			if (!culled)
+			{
+				pOut[n++] = static_cast<std::uint32_t>(i);
+			}
+		}
+		return n;
+	}
+
+	std::size_t CullBoxesScalarRange(const Frustum& frustum, const BoundingBoxes& boxes, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept
+	{
+		const float* pX = boxes.GetX();
+		const float* pY = boxes.GetY();
+		const float* pZ = boxes.GetZ();
+		const float* pEX = boxes.GetExtentX();
+		const float* pEY = boxes.GetExtentY();
+		const float* pEZ = boxes.GetExtentZ();
+		std::size_t n = 0u;
+		for (std::size_t i = begin; i < end; i++)
+		{
+			bool culled = false;
+			for (const Vec4& plane : frustum.planes)
+			{
+				// Projected half size of the box onto the plane normal
+				const float reach = std::fabs(plane.x) * pEX[i] + std::fabs(plane.y) * pEY[i] + std::fabs(plane.z) * pEZ[i];
+				culled |= PlaneDistance(plane, pX[i], pY[i], pZ[i]) + reach < 0.0f;
+			}
+			if (!culled)
+			{
+				pOut[n++] = static_cast<std::uint32_t>(i);
+			}
+		}
+		return n;
+	}
+
+	std::size_t CullSpheresRange(const Frustum& frustum, const BoundingSpheres& spheres, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept
+	{
+		[[maybe_unused]] const float* pX = spheres.GetX();
+		[[maybe_unused]] const float* pY = spheres.GetY();
+		[[maybe_unused]] const float* pZ = spheres.GetZ();
+		[[maybe_unused]] const float* pR = spheres.GetRadius();
+		std::size_t i = begin;
+		std::size_t n = 0u;
+#if defined(SIMDMATH_AVX)
+		{
+			__m256 p[6][4];
+			for (int k = 0; k < 6; k++)
+			{
+				p[k][0] = _mm256_set1_ps(frustum.planes[k].x);
+				p[k][1] = _mm256_set1_ps(frustum.planes[k].y);
+				p[k][2] = _mm256_set1_ps(frustum.planes[k].z);
+				p[k][3] = _mm256_set1_ps(frustum.planes[k].w);
+			}
+			const __m256 signBit = _mm256_set1_ps(-0.0f);
+			for (; i + 8u <= end; i += 8u)
+			{
+				const __m256 x = _mm256_loadu_ps(pX + i);
+				const __m256 y = _mm256_loadu_ps(pY + i);
+				const __m256 z = _mm256_loadu_ps(pZ + i);
+				const __m256 negR = _mm256_xor_ps(_mm256_loadu_ps(pR + i), signBit);
+				__m256 culled = _mm256_setzero_ps();
+				for (int k = 0; k < 6; k++)
+				{
+					const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[k][0], x), _mm256_mul_ps(p[k][1], y)), _mm256_mul_ps(p[k][2], z)), p[k][3]);
+					culled = _mm256_or_ps(culled, _mm256_cmp_ps(dist, negR, _CMP_LT_OQ));
+				}
+				n += WriteVisible(~static_cast<unsigned int>(_mm256_movemask_ps(culled)) & 0xFFu, i, pOut + n);
+			}
+		}
+#endif
+#if defined(SIMDMATH_SSE)
+		{
+			__m128 p[6][4];
+			for (int k = 0; k < 6; k++)
+			{
+				p[k][0] = _mm_set1_ps(frustum.planes[k].x);
+				p[k][1] = _mm_set1_ps(frustum.planes[k].y);
+				p[k][2] = _mm_set1_ps(frustum.planes[k].z);
+				p[k][3] = _mm_set1_ps(frustum.planes[k].w);
+			}
+			const __m128 signBit = _mm_set1_ps(-0.0f);
+			for (; i + 4u <= end; i += 4u)
+			{
+				const __m128 x = _mm_loadu_ps(pX + i);
+				const __m128 y = _mm_loadu_ps(pY + i);
+				const __m128 z = _mm_loadu_ps(pZ + i);
+				const __m128 negR = _mm_xor_ps(_mm_loadu_ps(pR + i), signBit);
+				__m128 culled = _mm_setzero_ps();
+				for (int k = 0; k < 6; k++)
+				{
+					const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p[k][0], x), _mm_mul_ps(p[k][1], y)), _mm_mul_ps(p[k][2], z)), p[k][3]);
+					culled = _mm_or_ps(culled, _mm_cmplt_ps(dist, negR));
+				}
+				n += WriteVisible(~static_cast<unsigned int>(_mm_movemask_ps(culled)) & 0xFu, i, pOut + n);
+			}
+		}
+#elif defined(SIMDMATH_NEON)
+		for (; i + 4u <= end; i += 4u)
+		{
+			const float32x4_t x = vld1q_f32(pX + i);
+			const float32x4_t y = vld1q_f32(pY + i);
+			const float32x4_t z = vld1q_f32(pZ + i);
+			const float32x4_t negR = vnegq_f32(vld1q_f32(pR + i));
+			uint32x4_t culled = vdupq_n_u32(0u);
+			for (const Vec4& plane : frustum.planes)
+			{
+				// Separate multiply and add rather than vmla, to round the same way as the scalar test
+				const float32x4_t dist = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, plane.x), vmulq_n_f32(y, plane.y)), vmulq_n_f32(z, plane.z)), vdupq_n_f32(plane.w));
+				culled = vorrq_u32(culled, vcltq_f32(dist, negR));
+			}
+			n += WriteVisible(~MoveMask(culled) & 0xFu, i, pOut + n);
+		}
+#endif
+		return n + CullSpheresScalarRange(frustum, spheres, i, end, pOut + n);
+	}
+
+	std::size_t CullBoxesRange(const Frustum& frustum, const BoundingBoxes& boxes, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept
+	{
+		[[maybe_unused]] const float* pX = boxes.GetX();
+		[[maybe_unused]] const float* pY = boxes.GetY();
+		[[maybe_unused]] const float* pZ = boxes.GetZ();
+		[[maybe_unused]] const float* pEX = boxes.GetExtentX();
+		[[maybe_unused]] const float* pEY = boxes.GetExtentY();
+		[[maybe_unused]] const float* pEZ = boxes.GetExtentZ();
+		std::size_t i = begin;
+		std::size_t n = 0u;
+#if defined(SIMDMATH_AVX)
+		{
+			// Plane normals and their absolute values, the latter for projecting the extents
+			__m256 p[6][4];
+			__m256 a[6][3];
+			for (int k = 0; k < 6; k++)
+			{
+				const Vec4& plane = frustum.planes[k];
+				p[k][0] = _mm256_set1_ps(plane.x);
+				p[k][1] = _mm256_set1_ps(plane.y);
+				p[k][2] = _mm256_set1_ps(plane.z);
+				p[k][3] = _mm256_set1_ps(plane.w);
+				a[k][0] = _mm256_set1_ps(std::fabs(plane.x));
+				a[k][1] = _mm256_set1_ps(std::fabs(plane.y));
+				a[k][2] = _mm256_set1_ps(std::fabs(plane.z));
+			}
+			const __m256 zero = _mm256_setzero_ps();
+			for (; i + 8u <= end; i += 8u)
+			{
+				const __m256 x = _mm256_loadu_ps(pX + i);
+				const __m256 y = _mm256_loadu_ps(pY + i);
+				const __m256 z = _mm256_loadu_ps(pZ + i);
+				const __m256 ex = _mm256_loadu_ps(pEX + i);
+				const __m256 ey = _mm256_loadu_ps(pEY + i);
+				const __m256 ez = _mm256_loadu_ps(pEZ + i);
+				__m256 culled = zero;
+				for (int k = 0; k < 6; k++)
+				{
+					const __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[k][0], ex), _mm256_mul_ps(a[k][1], ey)), _mm256_mul_ps(a[k][2], ez));
+					const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p[k][0], x), _mm256_mul_ps(p[k][1], y)), _mm256_mul_ps(p[k][2], z)), p[k][3]);
+					culled = _mm256_or_ps(culled, _mm256_cmp_ps(_mm256_add_ps(dist, reach), zero, _CMP_LT_OQ));
+				}
+				n += WriteVisible(~static_cast<unsigned int>(_mm256_movemask_ps(culled)) & 0xFFu, i, pOut + n);
+			}
+		}
+#endif
+#if defined(SIMDMATH_SSE)
+		{
+			__m128 p[6][4];
+			__m128 a[6][3];
+			for (int k = 0; k < 6; k++)
+			{
+				const Vec4& plane = frustum.planes[k];
+				p[k][0] = _mm_set1_ps(plane.x);
+				p[k][1] = _mm_set1_ps(plane.y);
+				p[k][2] = _mm_set1_ps(plane.z);
+				p[k][3] = _mm_set1_ps(plane.w);
+				a[k][0] = _mm_set1_ps(std::fabs(plane.x));
+				a[k][1] = _mm_set1_ps(std::fabs(plane.y));
+				a[k][2] = _mm_set1_ps(std::fabs(plane.z));
+			}
+			const __m128 zero = _mm_setzero_ps();
+			for (; i + 4u <= end; i += 4u)
+			{
+				const __m128 x = _mm_loadu_ps(pX + i);
+				const __m128 y = _mm_loadu_ps(pY + i);
+				const __m128 z = _mm_loadu_ps(pZ + i);
+				const __m128 ex = _mm_loadu_ps(pEX + i);
+				const __m128 ey = _mm_loadu_ps(pEY + i);
+				const __m128 ez = _mm_loadu_ps(pEZ + i);
+				__m128 culled = zero;
+				for (int k = 0; k < 6; k++)
+				{
+					const __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[k][0], ex), _mm_mul_ps(a[k][1], ey)), _mm_mul_ps(a[k][2], ez));
+					const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p[k][0], x), _mm_mul_ps(p[k][1], y)), _mm_mul_ps(p[k][2], z)), p[k][3]);
+					culled = _mm_or_ps(culled, _mm_cmplt_ps(_mm_add_ps(dist, reach), zero));
+				}
+				n += WriteVisible(~static_cast<unsigned int>(_mm_movemask_ps(culled)) & 0xFu, i, pOut + n);
+			}
+		}
+#elif defined(SIMDMATH_NEON)
+		for (; i + 4u <= end; i += 4u)
+		{
+			const float32x4_t x = vld1q_f32(pX + i);
+			const float32x4_t y = vld1q_f32(pY + i);
+			const float32x4_t z = vld1q_f32(pZ + i);
+			const float32x4_t ex = vld1q_f32(pEX + i);
+			const float32x4_t ey = vld1q_f32(pEY + i);
+			const float32x4_t ez = vld1q_f32(pEZ + i);
+			uint32x4_t culled = vdupq_n_u32(0u);
+			for (const Vec4& plane : frustum.planes)
+			{
+				const float32x4_t reach = vaddq_f32(vaddq_f32(vmulq_n_f32(ex, std::fabs(plane.x)), vmulq_n_f32(ey, std::fabs(plane.y))), vmulq_n_f32(ez, std::fabs(plane.z)));
+				const float32x4_t dist = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, plane.x), vmulq_n_f32(y, plane.y)), vmulq_n_f32(z, plane.z)), vdupq_n_f32(plane.w));
+				culled = vorrq_u32(culled, vcltq_f32(vaddq_f32(dist, reach), vdupq_n_f32(0.0f)));
+			}
+			n += WriteVisible(~MoveMask(culled) & 0xFu, i, pOut + n);
+		}
+#endif
+		return n + CullBoxesScalarRange(frustum, boxes, i, end, pOut + n);
+	}
+
+	// Each range writes its results at its own offset in pVisible, then the ranges are packed down in order
+	template<typename F>
+	std::size_t ParallelCull(ThreadPool& pool, std::size_t count, std::uint32_t* pVisible, F&& cullRange)
+	{
+		if (count <= cullGrain)
+		{
+			return cullRange(std::size_t(0u), count, pVisible);
+		}
+		std::vector<std::size_t> rangeCounts((count + cullGrain - 1u) / cullGrain);
+		pool.ParallelFor(count, cullGrain, [&](std::size_t begin, std::size_t end)
+		{
+			rangeCounts[begin / cullGrain] = cullRange(begin, end, pVisible + begin);
+		});
+		std::size_t total = rangeCounts[0];
+		for (std::size_t range = 1u; range < rangeCounts.size(); range++)
+		{
+			// Destination never runs past the source, so a forward move is safe
+			std::memmove(pVisible + total, pVisible + range * cullGrain, rangeCounts[range] * sizeof(std::uint32_t));
+			total += rangeCounts[range];
+		}
+		return total;
+	}
+}
+
+// Frustum stuff
+Frustum Frustum::FromViewProjection(const Mat4& viewProj) noexcept
+{
+	// Clip space coordinates are dot products with the matrix columns (Gribb/Hartmann)
+	const auto& m = viewProj.m;
+	const auto column = [&m](int c) { return Vec4(m[0][c], m[1][c], m[2][c], m[3][c]); };
+	const Vec4 c0 = column(0);
+	const Vec4 c1 = column(1);
+	const Vec4 c2 = column(2);
+	const Vec4 c3 = column(3);
+	Frustum frustum;
+	frustum.planes[Left] = c3 + c0;
+	frustum.planes[Right] = c3 - c0;
+	frustum.planes[Bottom] = c3 + c1;
+	frustum.planes[Top] = c3 - c1;
+	frustum.planes[Near] = c2;
+	frustum.planes[Far] = c3 - c2;
+	for (Vec4& plane : frustum.planes)
+	{
+		plane = plane * (1.0f / plane.Xyz().Length());
+	}
+	return frustum;
+}
+
+// Bounding sphere stuff
+std::uint32_t BoundingSpheres::Add(const Vec3& center, float r)
+{
+	x.push_back(center.x);
+	y.push_back(center.y);
+	z.push_back(center.z);
+	radius.push_back(r);
+	return static_cast<std::uint32_t>(x.size() - 1u);
+}
+
+void BoundingSpheres::Set(std::uint32_t index, const Vec3& center, float r) noexcept
+{
+	assert(index < x.size());
+	x[index] = center.x;
+	y[index] = center.y;
+	z[index] = center.z;
+	radius[index] = r;
+}
+
+void BoundingSpheres::Reserve(std::size_t count)
+{
+	x.reserve(count);
+	y.reserve(count);
+	z.reserve(count);
+	radius.reserve(count);
+}
+
+void BoundingSpheres::Clear() noexcept
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+std::size_t BoundingSpheres::Size() const noexcept
+{
+	return x.size();
+}
+
+const float* BoundingSpheres::GetX() const noexcept
+{
+	return x.data();
+}
+
+const float* BoundingSpheres::GetY() const noexcept
+{
+	return y.data();
+}
+
+const float* BoundingSpheres::GetZ() const noexcept
+{
+	return z.data();
+}
+
+const float* BoundingSpheres::GetRadius() const noexcept
+{
+	return radius.data();
+}
+
+// Bounding box stuff
+std::uint32_t BoundingBoxes::Add(const Vec3& min, const Vec3& max)
+{
+	x.push_back(0.0f);
+	y.push_back(0.0f);
+	z.push_back(0.0f);
+	extentX.push_back(0.0f);
+	extentY.push_back(0.0f);
+	extentZ.push_back(0.0f);
+	const std::uint32_t index = static_cast<std::uint32_t>(x.size() - 1u);
+	Set(index, min, max);
+	return index;
+}
+
+void BoundingBoxes::Set(std::uint32_t index, const Vec3& min, const Vec3& max) noexcept
+{
+	assert(index < x.size());
+	x[index] = (min.x + max.x) * 0.5f;
+	y[index] = (min.y + max.y) * 0.5f;
+	z[index] = (min.z + max.z) * 0.5f;
+	extentX[index] = (max.x - min.x) * 0.5f;
+	extentY[index] = (max.y - min.y) * 0.5f;
+	extentZ[index] = (max.z - min.z) * 0.5f;
+}
+
+void BoundingBoxes::Reserve(std::size_t count)
+{
+	x.reserve(count);
+	y.reserve(count);
+	z.reserve(count);
+	extentX.reserve(count);
+	extentY.reserve(count);
+	extentZ.reserve(count);
+}
+
+void BoundingBoxes::Clear() noexcept
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+std::size_t BoundingBoxes::Size() const noexcept
+{
+	return x.size();
+}
+
+const float* BoundingBoxes::GetX() const noexcept
+{
+	return x.data();
+}
+
+const float* BoundingBoxes::GetY() const noexcept
+{
+	return y.data();
+}
+
+const float* BoundingBoxes::GetZ() const noexcept
+{
+	return z.data();
+}
+
+const float* BoundingBoxes::GetExtentX() const noexcept
+{
+	return extentX.data();
+}
+
+const float* BoundingBoxes::GetExtentY() const noexcept
+{
+	return extentY.data();
+}
+
+const float* BoundingBoxes::GetExtentZ() const noexcept
+{
+	return extentZ.data();
+}
+
+// Culling stuff
+std::size_t CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible) noexcept
+{
+	return CullSpheresRange(frustum, spheres, 0u, spheres.Size(), pVisible);
+}
+
+std::size_t CullSpheres(ThreadPool& pool, const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible)
+{
+	return ParallelCull(pool, spheres.Size(), pVisible, [&](std::size_t begin, std::size_t end, std::uint32_t* pOut)
+	{
+		return CullSpheresRange(frustum, spheres, begin, end, pOut);
+	});
+}
+
+std::size_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible) noexcept
+{
+	return CullSpheresScalarRange(frustum, spheres, 0u, spheres.Size(), pVisible);
+}
+
+std::size_t CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible) noexcept
+{
+	return CullBoxesRange(frustum, boxes, 0u, boxes.Size(), pVisible);
+}
+
+std::size_t CullBoxes(ThreadPool& pool, const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible)
+{
+	return ParallelCull(pool, boxes.Size(), pVisible, [&](std::size_t begin, std::size_t end, std::uint32_t* pOut)
+	{
+		return CullBoxesRange(frustum, boxes, begin, end, pOut);
+	});
+}
+
+std::size_t CullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible) noexcept
+{
+	return CullBoxesScalarRange(frustum, boxes, 0u, boxes.Size(), pVisible);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Batch frustum culling over structure-of-arrays bounds.
+* Bounds are kept as separate x/y/z/... arrays so the SIMD paths can test
+* 8 (AVX) or 4 (SSE/NEON) objects against all six planes at once. Results
+* are written as a compact, ascending list of visible object indices.
+*
+* Culling is conservative: objects straddling a plane count as visible, and
+* boxes that are outside the frustum without being fully behind any single
+* plane (near its corners) are kept too.
+*/
+
+struct Frustum
+{
+	// Planes are (nx, ny, nz, d) with normals pointing inward and normalized; inside means dot(n, p) + d >= 0
+	enum Side { Left, Right, Bottom, Top, Near, Far };
+	Vec4 planes[6];
+	// Extracts the planes of a view * projection matrix (row vectors, depth in [0, 1]), i.e. in world space
+	static Frustum FromViewProjection(const Mat4& viewProj) noexcept;
+};
+
+class BoundingSpheres
+{
+public:
+	// Returns the new object's index
+	std::uint32_t Add(const Vec3& center, float radius);
+	void Set(std::uint32_t index, const Vec3& center, float radius) noexcept;
+	void Reserve(std::size_t count);
+	void Clear() noexcept;
+	std::size_t Size() const noexcept;
+	const float* GetX() const noexcept;
+	const float* GetY() const noexcept;
+	const float* GetZ() const noexcept;
+	const float* GetRadius() const noexcept;
+private:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+};
+
+// Axis-aligned boxes, stored as center + half extents
+class BoundingBoxes
+{
+public:
+	std::uint32_t Add(const Vec3& min, const Vec3& max);
+	void Set(std::uint32_t index, const Vec3& min, const Vec3& max) noexcept;
+	void Reserve(std::size_t count);
+	void Clear() noexcept;
+	std::size_t Size() const noexcept;
+	const float* GetX() const noexcept;
+	const float* GetY() const noexcept;
+	const float* GetZ() const noexcept;
+	const float* GetExtentX() const noexcept;
+	const float* GetExtentY() const noexcept;
+	const float* GetExtentZ() const noexcept;
+private:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+};
+
+/* The Cull* functions write visible indices to pVisible, which must have room
+* for Size() entries, and return how many were written. The pool overloads
+* split big sets into ranges culled concurrently, then close the gaps so the
+* output is identical to the single-threaded version.
+* The *Scalar versions are one object at a time and serve as the reference.
+*/
+std::size_t CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible) noexcept;
+std::size_t CullSpheres(ThreadPool& pool, const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible);
+std::size_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, std::uint32_t* pVisible) noexcept;
+std::size_t CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible) noexcept;
+std::size_t CullBoxes(ThreadPool& pool, const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible);
+std::size_t CullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, std::uint32_t* pVisible) noexcept;
@@ -1,6 +1,7 @@
 #include "Window.h"
 #include <sstream>
 #include "resource.h"
+#include "SoftwareRenderer.h"
 
 // Window class stuff
 Window::WindowClass Window::WindowClass::winClass;
@@ -76,6 +77,8 @@ Window::Window(int width, int height, const wchar_t* name) noexcept
 	}
 	// Show window
 	ShowWindow(handle, SW_SHOWDEFAULT);
+	// Create graphics object - CPU backend until the D3D12 one exists
+	pGfx = std::make_unique<SoftwareRenderer>(width, height);
 }
 
 Window::~Window()
@@ -85,12 +88,38 @@ Window::~Window()
 
 void Window::SetTitle(const std::string& title)
 {
-	if (SetWindowTextA(handle, title.c_str()) == 0)
+	SetTitle(title.c_str());
+}
+
+void Window::SetTitle(const char* title)
+{
+	if (SetWindowTextA(handle, title) == 0)
 	{
 		throw EGGCEPT_LAST_EXCEPT();
 	}
 }
 
+Renderer& Window::Gfx()
+{
+	return *pGfx;
+}
+
+std::optional<int> Window::ProcessMessages() noexcept
+{
+	MSG message;
+	// PeekMessage instead of GetMessage so the frame loop keeps running when the queue is empty
+	while (PeekMessage(&message, nullptr, 0, 0, PM_REMOVE))
+	{
+		if (message.message == WM_QUIT)
+		{
+			return static_cast<int>(message.wParam);
+		}
+		TranslateMessage(&message);
+		DispatchMessage(&message);
+	}
+	return {};
+}
+
 // This function is mainly to install/set up a pointer to our instance in the Win32 side
 LRESULT WINAPI Window::HandleMessageSetup(HWND handle, UINT message, WPARAM wParam, LPARAM lParam) noexcept
 {
@@ -4,6 +4,9 @@
 #include "EggCeption.h"
 #include "Keyboard.h"
 #include "Mouse.h"
+#include "Renderer.h"
+#include <memory>
+#include <optional>
 #include <sstream>
 
 /* Step 2: Create a class to represent a window. 
@@ -57,6 +60,10 @@ public:
 	Window(const Window&) = delete;
 	Window& operator=(const Window&) = delete;
 	void SetTitle(const std::string& title);
+	void SetTitle(const char* title);
+	Renderer& Gfx();
+	// Pumps all pending messages without blocking; returns the exit code once WM_QUIT shows up
+	static std::optional<int> ProcessMessages() noexcept;
 private:
 	// Static functions b/c WINAPI doesn't know about C++ features, like member functions. But static does the trick.
 	static LRESULT CALLBACK HandleMessageSetup(HWND handle, UINT message, WPARAM wParam, LPARAM lParam) noexcept;
@@ -71,6 +78,7 @@ private:
 	int width;
 	int height;
 	HWND handle;
+	std::unique_ptr<Renderer> pGfx;
 };
 
 // error exception helper macro - to get line number, and file name
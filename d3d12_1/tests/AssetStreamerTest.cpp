@@ -0,0 +1,273 @@
+// AssetStreamer: queue order and priorities, cancelling, re-requesting, LRU eviction under the budget,
+// and handles released on other threads while Update() evicts.
+// Build as a console program together with src/AssetStreamer.cpp, src/MappedFile.cpp and src/EggCeption.cpp.
+//
+//   AssetStreamerTest
+
+#include "../src/AssetStreamer.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// Holds every Open() until the test lets it through, and records the order they came in
+	class GatedSource : public AssetSource
+	{
+	public:
+		explicit GatedSource(std::string rootDirectory)
+			:
+			inner(std::move(rootDirectory))
+		{}
+		MappedFile Open(const std::string& path) override
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				opened.push_back(path);
+				gateChanged.wait(lock, [this] { return open; });
+			}
+			return inner.Open(path);
+		}
+		void SetOpen(bool isOpen)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				open = isOpen;
+			}
+			gateChanged.notify_all();
+		}
+		std::vector<std::string> GetOpened()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return opened;
+		}
+	private:
+		MappedFileSource inner;
+		std::mutex mutex;
+		std::condition_variable gateChanged;
+		bool open = true;
+		std::vector<std::string> opened;
+	};
+
+	template<typename F>
+	bool WaitFor(F&& condition)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + 5s;
+		while (!condition())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(100us);
+		}
+		return true;
+	}
+
+	bool IsSettled(const AssetHandle& handle)
+	{
+		const AssetState state = handle.GetState();
+		return state != AssetState::Queued && state != AssetState::Loading;
+	}
+
+	// a0 .. a19, 1000 + i bytes of the letter 'a' + i
+	std::filesystem::path MakeAssets()
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "AssetStreamerTest";
+		std::filesystem::create_directories(directory);
+		for (int i = 0; i < 20; i++)
+		{
+			std::ofstream file(directory / ("a" + std::to_string(i)), std::ios::binary);
+			file << std::string(1000u + i, char('a' + i));
+		}
+		return directory;
+	}
+
+	void TestQueueOrder(const std::filesystem::path& directory)
+	{
+		GatedSource source(directory.string());
+		AssetStreamer streamer(source, 1u << 20, 1u);
+		// Keep the only I/O thread busy so everything after this queues up
+		source.SetOpen(false);
+		const AssetHandle blocker = streamer.Request("a0");
+		CHECK(WaitFor([&] { return source.GetOpened().size() == 1u; }));
+		const AssetHandle low = streamer.Request("a1", 1);
+		const AssetHandle high = streamer.Request("a2", 10);
+		const AssetHandle cancelled = streamer.Request("a3", 5);
+		const AssetHandle sameAsCancelled = streamer.Request("a5", 5);
+		const AssetHandle bumped = streamer.Request("a4", 0);
+		const AssetHandle lowered = streamer.Request("a6", 50);
+		const AssetHandle missing = streamer.Request("nope", -1);
+		streamer.SetPriority(bumped, 20);
+		streamer.SetPriority(lowered, -5);
+		// Re-requesting with a higher priority raises it, with a lower one doesn't lower it
+		const AssetHandle raisedAgain = streamer.Request("a1", 15);
+		const AssetHandle notLowered = streamer.Request("a2", -100);
+		CHECK(streamer.GetStats().queued == 7u);
+		streamer.Cancel(cancelled);
+		CHECK(cancelled.GetState() == AssetState::Cancelled);
+		CHECK(streamer.GetStats().queued == 6u);
+		source.SetOpen(true);
+		CHECK(WaitFor([&] { return IsSettled(blocker) && IsSettled(low) && IsSettled(high) && IsSettled(sameAsCancelled) &&
+			IsSettled(bumped) && IsSettled(lowered) && IsSettled(missing); }));
+		// Highest first, FIFO among equals, the cancelled one never opened
+		CHECK(source.GetOpened() == std::vector<std::string>({ "a0", "a4", "a1", "a2", "a5", "nope", "a6" }));
+		CHECK(missing.GetState() == AssetState::Failed);
+		CHECK(high.IsReady() && high.GetBytes().size() == 1002u && char(high.GetBytes()[0]) == 'c');
+		CHECK(raisedAgain.IsReady() && raisedAgain.GetBytes().data() == low.GetBytes().data());
+
+		// Re-requesting after a cancel loads it after all, for the old handle too
+		const AssetHandle retried = streamer.Request("a3");
+		CHECK(WaitFor([&] { return IsSettled(retried); }));
+		CHECK(retried.IsReady() && cancelled.IsReady() && retried.GetBytes().size() == 1003u);
+		const AssetStreamer::Stats stats = streamer.GetStats();
+		CHECK(stats.loaded == 7u && stats.failed == 1u && stats.cancelled == 1u && stats.queued == 0u);
+	}
+
+	void TestCancelInFlight(const std::filesystem::path& directory)
+	{
+		GatedSource source(directory.string());
+		AssetStreamer streamer(source, 1u << 20, 1u);
+		source.SetOpen(false);
+		const AssetHandle handle = streamer.Request("a7");
+		CHECK(WaitFor([&] { return source.GetOpened().size() == 1u && handle.GetState() == AssetState::Loading; }));
+		// The read can't be interrupted: still loading until it finishes, then dropped
+		streamer.Cancel(handle);
+		CHECK(handle.GetState() == AssetState::Loading);
+		source.SetOpen(true);
+		CHECK(WaitFor([&] { return IsSettled(handle); }));
+		CHECK(handle.GetState() == AssetState::Cancelled);
+		AssetStreamer::Stats stats = streamer.GetStats();
+		CHECK(stats.cancelled == 1u && stats.resident == 0u && stats.residentBytes == 0u);
+
+		// Cancelled mid-read, then wanted again before the read is done: the result is kept
+		source.SetOpen(false);
+		const AssetHandle second = streamer.Request("a8");
+		CHECK(WaitFor([&] { return second.GetState() == AssetState::Loading; }));
+		streamer.Cancel(second);
+		const AssetHandle wantedAgain = streamer.Request("a8");
+		source.SetOpen(true);
+		CHECK(WaitFor([&] { return IsSettled(second); }));
+		CHECK(second.IsReady() && wantedAgain.IsReady());
+
+		// And re-requested after the cancel went through
+		const AssetHandle retried = streamer.Request("a7");
+		CHECK(WaitFor([&] { return IsSettled(retried); }));
+		CHECK(retried.IsReady() && handle.IsReady() && char(retried.GetBytes()[0]) == 'h');
+		stats = streamer.GetStats();
+		CHECK(stats.cancelled == 1u && stats.loaded == 2u && stats.resident == 2u);
+	}
+
+	void TestEviction(const std::filesystem::path& directory)
+	{
+		GatedSource source(directory.string());
+		AssetStreamer streamer(source, 1u << 20, 2u);
+		std::vector<AssetHandle> handles;
+		for (int i = 0; i < 6; i++)
+		{
+			handles.push_back(streamer.Request("a" + std::to_string(i)));
+		}
+		CHECK(WaitFor([&] { return std::all_of(handles.begin(), handles.end(), [](const AssetHandle& h) { return h.IsReady(); }); }));
+		// Released a frame apart in this order; a5 stays held
+		for (const int i : { 2, 0, 4, 1, 3 })
+		{
+			handles[i] = {};
+			streamer.Update();
+		}
+		// Still under budget: nothing goes, released assets stay cached
+		CHECK(streamer.GetStats().evicted == 0u && streamer.GetStats().resident == 6u);
+		// About three assets' worth: the three released longest ago have to go
+		streamer.SetBudget(3100u);
+		streamer.Update();
+		AssetStreamer::Stats stats = streamer.GetStats();
+		CHECK(stats.evicted == 3u && stats.residentBytes <= stats.budgetBytes);
+		// Requests for evicted assets start loading them again; keep those from finishing while checking
+		source.SetOpen(false);
+		const auto isResident = [&](int i)
+		{
+			return streamer.Request("a" + std::to_string(i)).IsReady();
+		};
+		CHECK(!isResident(2) && !isResident(0) && !isResident(4));
+		CHECK(isResident(1) && isResident(3) && isResident(5));
+		source.SetOpen(true);
+		CHECK(WaitFor([&] { return streamer.GetStats().queued == 0u && streamer.GetStats().loaded == 9u; }));
+
+		// A held asset is never evicted, even with no budget at all
+		streamer.SetBudget(0u);
+		streamer.Update();
+		stats = streamer.GetStats();
+		CHECK(handles[5].IsReady() && stats.resident == 1u && stats.residentBytes == 1005u);
+		handles.clear();
+		streamer.Update();
+		CHECK(streamer.GetStats().resident == 0u && streamer.GetStats().residentBytes == 0u);
+	}
+
+	// Handles dropped on worker threads while the game thread runs Update() with nothing to spare.
+	// Last one out used to stamp the slot after dropping its reference, racing with the eviction that frees it.
+	void TestReleaseWhileEvicting(const std::filesystem::path& directory)
+	{
+		MappedFileSource source(directory.string());
+		AssetStreamer streamer(source, 0u, 2u);
+		std::atomic<bool> done{ false };
+		for (int round = 0; round < 200; round++)
+		{
+			std::vector<AssetHandle> handles;
+			for (int i = 0; i < 20; i++)
+			{
+				handles.push_back(streamer.Request("a" + std::to_string(i), i));
+			}
+			CHECK(WaitFor([&] { return std::all_of(handles.begin(), handles.end(), [](const AssetHandle& h) { return IsSettled(h); }); }));
+			done = false;
+			std::vector<std::thread> releasers;
+			for (int t = 0; t < 4; t++)
+			{
+				// Each thread gets copies of five handles and drops them one by one
+				std::vector<AssetHandle> copies(handles.begin() + t * 5, handles.begin() + t * 5 + 5);
+				releasers.emplace_back([copies = std::move(copies)]() mutable
+				{
+					while (!copies.empty())
+					{
+						copies.pop_back();
+						std::this_thread::yield();
+					}
+				});
+			}
+			handles.clear();
+			std::thread evictor([&]
+			{
+				while (!done)
+				{
+					streamer.Update();
+				}
+			});
+			for (auto& thread : releasers)
+			{
+				thread.join();
+			}
+			done = true;
+			evictor.join();
+			streamer.Update();
+			CHECK(streamer.GetStats().resident == 0u);
+		}
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = MakeAssets();
+	TestQueueOrder(directory);
+	TestCancelInFlight(directory);
+	TestEviction(directory);
+	TestReleaseWhileEvicting(directory);
+	std::filesystem::remove_all(directory);
+	return Test::Finish("AssetStreamerTest");
+}
@@ -0,0 +1,283 @@
+// CommandList recording and NullExecutor validation: the stream reads back what was recorded across pages,
+// oversized commands are refused, and lists recorded in parallel replay the same as serially recorded ones.
+// Build as a console program together with src/CommandList.cpp, src/ThreadPool.cpp and src/EggCeption.cpp.
+//
+//   CommandListTest [--bench]
+//
+// --bench times recording a frame's worth of draws on one thread and spread over the default pool.
+
+#include "../src/CommandList.h"
+#include "../src/ThreadPool.h"
+#include "TestCommon.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	constexpr ResourceId vertexBuffer = 10u;
+	constexpr ResourceId indexBuffer = 11u;
+
+	// A typical run of draws for one recording thread; values depend on the first draw index so lists differ
+	void RecordDraws(CommandList& list, std::uint32_t firstDraw, std::uint32_t drawCount)
+	{
+		list.SetPipeline(1u, PipelineKind::Graphics);
+		list.SetViewport(0.0f, 0.0f, 1280.0f, 720.0f);
+		list.SetVertexBuffer(0u, vertexBuffer, 0u, 32u);
+		list.SetIndexBuffer(indexBuffer, 0u, true);
+		for (std::uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++)
+		{
+			if (draw % 64u == 0u)
+			{
+				list.SetPipeline(1u + draw / 64u % 4u, PipelineKind::Graphics);
+			}
+			const std::uint32_t constants[4] = { draw, draw * 3u, draw ^ 0x55u, 7u };
+			list.SetRootConstants(0u, constants, 4u);
+			list.DrawIndexed(36u + draw % 3u, 1u, draw * 36u);
+		}
+	}
+
+	bool SameStream(const CommandList& a, const CommandList& b)
+	{
+		if (a.GetCommandCount() != b.GetCommandCount() || a.GetByteSize() != b.GetByteSize())
+		{
+			return false;
+		}
+		auto itB = b.begin();
+		for (auto itA = a.begin(); itA != a.end(); ++itA, ++itB)
+		{
+			const CommandHeader& headerA = *itA;
+			const CommandHeader& headerB = *itB;
+			if (headerA.type != headerB.type || headerA.size != headerB.size ||
+				std::memcmp(&itA.Get<std::byte>(), &itB.Get<std::byte>(), headerA.size - sizeof(CommandHeader)) != 0)
+			{
+				return false;
+			}
+		}
+		return !(itB != b.end());
+	}
+
+	NullExecutor MakeExecutor()
+	{
+		NullExecutor executor;
+		executor.SetResourceState(vertexBuffer, ResourceState::VertexBuffer);
+		executor.SetResourceState(indexBuffer, ResourceState::IndexBuffer);
+		return executor;
+	}
+
+	void TestRoundTrip()
+	{
+		// Small pages so commands spill over several of them
+		CommandAllocator allocator(256u);
+		CommandList list;
+		list.Reset(allocator);
+		std::vector<std::uint32_t> values(Commands::SetRootConstants::maxCount);
+		for (std::uint32_t i = 0u; i < values.size(); i++)
+		{
+			values[i] = i * 101u;
+		}
+		for (std::uint32_t i = 0u; i < 100u; i++)
+		{
+			list.SetRootConstants(i, values.data(), 1u + i % 20u);
+			list.Draw(3u, 1u, i);
+		}
+		list.Close();
+		CHECK(list.GetCommandCount() == 200u && allocator.GetPageCount() > 1u);
+		std::uint32_t index = 0u;
+		bool matches = true;
+		for (auto it = list.begin(); it != list.end(); ++it, ++index)
+		{
+			const std::uint32_t i = index / 2u;
+			if (index % 2u == 0u)
+			{
+				const auto& cmd = it.Get<Commands::SetRootConstants>();
+				matches &= (*it).type == CommandType::SetRootConstants && cmd.rootIndex == i && cmd.count == 1u + i % 20u;
+				matches &= std::memcmp(it.GetTrailing<Commands::SetRootConstants>(), values.data(), cmd.count * sizeof(std::uint32_t)) == 0;
+			}
+			else
+			{
+				matches &= (*it).type == CommandType::Draw && it.Get<Commands::Draw>().startVertex == i;
+			}
+		}
+		CHECK(matches && index == 200u);
+		// Recycled pages are handed out again instead of new ones
+		const std::size_t pages = allocator.GetPageCount();
+		allocator.Reset();
+		list.Reset(allocator);
+		list.SetRootConstants(0u, values.data(), 8u);
+		CHECK(allocator.GetPageCount() == pages && list.GetCommandCount() == 1u);
+	}
+
+	void TestLimits()
+	{
+		const std::vector<std::uint32_t> values(Commands::SetRootConstants::maxCount + 1u, 1u);
+		CommandAllocator allocator;
+		CommandList list;
+		list.Reset(allocator);
+		list.SetRootConstants(0u, values.data(), Commands::SetRootConstants::maxCount);
+		bool threw = false;
+		try
+		{
+			list.SetRootConstants(0u, values.data(), Commands::SetRootConstants::maxCount + 1u);
+		}
+		catch (const CommandList::Exception&)
+		{
+			threw = true;
+		}
+		CHECK(threw && list.GetCommandCount() == 1u);
+
+		// A command that can't fit in one page is refused, and nothing is recorded for it
+		CommandAllocator tinyAllocator(64u);
+		CommandList tinyList;
+		tinyList.Reset(tinyAllocator);
+		tinyList.Draw(3u);
+		threw = false;
+		try
+		{
+			tinyList.SetRootConstants(0u, values.data(), 32u);
+		}
+		catch (const CommandList::Exception&)
+		{
+			threw = true;
+		}
+		CHECK(threw && tinyList.GetCommandCount() == 1u && tinyAllocator.GetPageCount() == 1u);
+		// The list carries on where it was
+		tinyList.Draw(6u);
+		tinyList.Close();
+		CHECK(tinyList.GetCommandCount() == 2u);
+	}
+
+	void TestValidation()
+	{
+		NullExecutor executor = MakeExecutor();
+		CommandQueue queue(executor);
+		CommandAllocator allocator;
+
+		// Fullscreen triangle: no vertex or index buffer at all, and that's fine
+		CommandList fullscreen;
+		fullscreen.Reset(allocator);
+		fullscreen.SetPipeline(2u, PipelineKind::Graphics);
+		fullscreen.SetViewport(0.0f, 0.0f, 1280.0f, 720.0f);
+		fullscreen.Draw(3u);
+		fullscreen.Close();
+		const CommandList* pList = &fullscreen;
+		queue.ExecuteCommandLists(&pList, 1u);
+		CHECK(executor.GetErrors().empty() && executor.GetStats().draws == 1u);
+
+		// Each of these is one error
+		CommandList broken;
+		broken.Reset(allocator);
+		const std::uint32_t constant = 1u;
+		broken.SetRootConstants(0u, &constant, 1u);					// no pipeline yet
+		broken.SetPipeline(2u, PipelineKind::Graphics);
+		broken.Draw(3u);											// no viewport
+		broken.SetViewport(0.0f, 0.0f, 1280.0f, 720.0f);
+		broken.DrawIndexed(3u);										// no index buffer
+		broken.Draw(3u, 0u);										// no instances
+		broken.Dispatch(1u);										// graphics pipeline bound
+		broken.ResourceBarrier(vertexBuffer, ResourceState::Common, ResourceState::CopyDest);	// really in VertexBuffer
+		broken.Close();
+		pList = &broken;
+		queue.ExecuteCommandLists(&pList, 1u);
+		const std::vector<NullExecutor::Error>& errors = executor.GetErrors();
+		CHECK(errors.size() == 6u);
+		const std::size_t expected[] = { 0u, 2u, 4u, 5u, 6u, 7u };
+		for (std::size_t i = 0u; i < errors.size() && i < 6u; i++)
+		{
+			CHECK(errors[i].listIndex == 1u && errors[i].commandIndex == expected[i]);
+		}
+		// Resource states carry over to the next list
+		CHECK(executor.GetResourceState(vertexBuffer) == ResourceState::CopyDest);
+	}
+
+	// Lists recorded on the pool replay exactly like the same lists recorded one after another
+	void TestParallelRecording()
+	{
+		constexpr std::size_t listCount = 16u;
+		constexpr std::uint32_t drawsPerList = 2000u;
+		ThreadPool pool(4u);
+		std::vector<std::unique_ptr<CommandAllocator>> allocators;
+		std::vector<CommandList> parallel(listCount);
+		std::vector<CommandList> serial(listCount);
+		CommandAllocator serialAllocator;
+		for (std::size_t i = 0u; i < listCount; i++)
+		{
+			allocators.push_back(std::make_unique<CommandAllocator>());
+			serial[i].Reset(serialAllocator);
+			RecordDraws(serial[i], static_cast<std::uint32_t>(i) * drawsPerList, drawsPerList);
+			serial[i].Close();
+		}
+		pool.ParallelFor(listCount, 1u, [&](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; i++)
+			{
+				parallel[i].Reset(*allocators[i]);
+				RecordDraws(parallel[i], static_cast<std::uint32_t>(i) * drawsPerList, drawsPerList);
+				parallel[i].Close();
+			}
+		});
+		bool same = true;
+		std::vector<const CommandList*> pLists;
+		for (std::size_t i = 0u; i < listCount; i++)
+		{
+			same &= SameStream(serial[i], parallel[i]);
+			pLists.push_back(&parallel[i]);
+		}
+		CHECK(same);
+		NullExecutor executor = MakeExecutor();
+		CommandQueue queue(executor);
+		queue.ExecuteCommandLists(pLists.data(), pLists.size());
+		CHECK(executor.GetErrors().empty() && executor.GetStats().draws == listCount * drawsPerList);
+		CHECK(executor.GetStats().listsExecuted == listCount && queue.GetSubmittedListCount() == listCount);
+	}
+
+	void Benchmark()
+	{
+		constexpr std::uint32_t drawCount = 200000u;
+		ThreadPool& pool = ThreadPool::Default();
+		const std::size_t listCount = pool.GetConcurrency() * 4u;
+		std::vector<std::unique_ptr<CommandAllocator>> allocators;
+		for (std::size_t i = 0u; i < listCount; i++)
+		{
+			allocators.push_back(std::make_unique<CommandAllocator>());
+		}
+		std::vector<CommandList> lists(listCount);
+		const double serialMs = Test::BestOfMs(5, [&]
+		{
+			allocators[0]->Reset();
+			lists[0].Reset(*allocators[0]);
+			RecordDraws(lists[0], 0u, drawCount);
+			lists[0].Close();
+		});
+		const std::size_t commands = lists[0].GetCommandCount();
+		const std::uint32_t drawsPerList = drawCount / static_cast<std::uint32_t>(listCount);
+		const double parallelMs = Test::BestOfMs(5, [&]
+		{
+			pool.ParallelFor(listCount, 1u, [&](std::size_t begin, std::size_t end)
+			{
+				for (std::size_t i = begin; i < end; i++)
+				{
+					allocators[i]->Reset();
+					lists[i].Reset(*allocators[i]);
+					RecordDraws(lists[i], static_cast<std::uint32_t>(i) * drawsPerList, drawsPerList);
+					lists[i].Close();
+				}
+			});
+		});
+		std::printf("record %u draws (%zu commands): 1 thread %.2f ms (%.1f M commands/s), %zu lists on %u threads %.2f ms (%.1f M commands/s)\n",
+			drawCount, commands, serialMs, commands / serialMs / 1e3, listCount, pool.GetConcurrency(), parallelMs, commands / parallelMs / 1e3);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TestRoundTrip();
+	TestLimits();
+	TestValidation();
+	TestParallelRecording();
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark();
+	}
+	return Test::Finish("CommandListTest");
+}
@@ -0,0 +1,239 @@
+// DescriptorAllocator on a NullDescriptorHeap: buddy splits and merges, frees held back until their fence,
+// per-frame transient regions (also from several threads), fragmentation stats, and random churn.
+// Build as a console program together with src/DescriptorAllocator.cpp.
+//
+//   DescriptorAllocatorTest
+
+#include "../src/DescriptorAllocator.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	void TestSplitAndMerge()
+	{
+		NullDescriptorHeap heap(64u, 32u);
+		DescriptorAllocator allocator(heap, 64u, 0u, 1u);
+		DescriptorAllocator::Stats stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1u && stats.largestFreeBlock == 64u && stats.GetFragmentation() == 0.0f);
+
+		// 64 splits all the way down: 1 handed out, 1 + 2 + 4 + 8 + 16 + 32 left over
+		const DescriptorHandle one = allocator.Allocate(1u);
+		CHECK(one.IsValid() && one.index == 0u && one.count == 1u);
+		CHECK(one.cpu == heap.GetCpuStart() && one.gpu == heap.GetGpuStart());
+		stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 6u && stats.largestFreeBlock == 32u);
+		// 3 rounds up to the free block of 4 at 4
+		const DescriptorHandle three = allocator.Allocate(3u);
+		CHECK(three.index == 4u && three.CpuAt(2u, allocator.GetIncrementSize()) == heap.GetCpuStart() + 6u * 32u);
+		// And 1 more takes the leftover single at 1
+		const DescriptorHandle another = allocator.Allocate(1u);
+		CHECK(another.index == 1u);
+		stats = allocator.GetStats();
+		CHECK(stats.persistentAllocated == 6u && stats.persistentRequested == 5u);
+		// Too big for anything left
+		CHECK(!allocator.Allocate(64u).IsValid() && allocator.GetStats().failedAllocations == 1u);
+
+		// Giving everything back merges the buddies into the one block it started as
+		allocator.Free(three, 0u);
+		allocator.Free(one, 0u);
+		allocator.Free(another, 0u);
+		allocator.Retire(0u);
+		stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1u && stats.largestFreeBlock == 64u && stats.persistentAllocated == 0u && stats.persistentRequested == 0u);
+		CHECK(allocator.Allocate(64u).index == 0u);
+
+		// Sizes that aren't a power of 2 are carved into aligned blocks: 100 = 64 + 32 + 4
+		NullDescriptorHeap oddHeap(100u);
+		DescriptorAllocator oddAllocator(oddHeap, 100u, 0u, 1u);
+		CHECK(oddAllocator.GetStats().freeBlockCount == 3u && oddAllocator.GetStats().largestFreeBlock == 64u);
+		CHECK(oddAllocator.Allocate(4u).index == 96u && oddAllocator.Allocate(32u).index == 64u && oddAllocator.Allocate(64u).index == 0u);
+		CHECK(!oddAllocator.Allocate(1u).IsValid());
+	}
+
+	void TestDeferredFree()
+	{
+		NullDescriptorHeap heap(16u);
+		DescriptorAllocator allocator(heap, 16u, 0u, 1u);
+		const DescriptorHandle a = allocator.Allocate(8u);
+		const DescriptorHandle b = allocator.Allocate(8u);
+		allocator.Free(a, 5u);
+		allocator.Free(b, 7u);
+		// Nothing comes back until its fence has completed
+		allocator.Retire(4u);
+		CHECK(allocator.GetStats().pendingFrees == 2u && !allocator.Allocate(1u).IsValid());
+		allocator.Retire(5u);
+		DescriptorAllocator::Stats stats = allocator.GetStats();
+		CHECK(stats.pendingFrees == 1u && stats.largestFreeBlock == 8u && stats.persistentAllocated == 8u);
+		// a's range is reusable, b's still isn't
+		const DescriptorHandle reused = allocator.Allocate(8u);
+		CHECK(reused.index == a.index && !allocator.Allocate(1u).IsValid());
+		allocator.Retire(100u);
+		CHECK(allocator.GetStats().pendingFrees == 0u && allocator.GetStats().largestFreeBlock == 8u);
+		// Freeing an invalid handle does nothing
+		allocator.Free(DescriptorHandle(), 100u);
+		CHECK(allocator.GetStats().pendingFrees == 0u);
+	}
+
+	void TestTransient()
+	{
+		constexpr std::uint32_t persistent = 32u;
+		constexpr std::uint32_t perFrame = 16u;
+		NullDescriptorHeap heap(persistent + perFrame * 3u);
+		DescriptorAllocator allocator(heap, persistent, perFrame, 3u);
+		allocator.BeginFrame(0u);
+		const DescriptorHandle first = allocator.AllocateTransient(10u);
+		CHECK(first.index == persistent && allocator.AllocateTransient(6u).index == persistent + 10u);
+		CHECK(!allocator.AllocateTransient(1u).IsValid());
+		// Each frame has its own slice, and coming back to one starts it over
+		allocator.BeginFrame(1u);
+		CHECK(allocator.AllocateTransient(4u).index == persistent + perFrame);
+		allocator.BeginFrame(2u);
+		CHECK(allocator.AllocateTransient(perFrame).index == persistent + perFrame * 2u);
+		allocator.BeginFrame(0u);
+		CHECK(allocator.AllocateTransient(1u).index == persistent);
+		const DescriptorAllocator::Stats stats = allocator.GetStats();
+		CHECK(stats.transientHighWaterMark == perFrame && stats.failedAllocations == 1u && stats.transientCapacityPerFrame == perFrame);
+		// Persistent allocations never reach into the transient slices
+		CHECK(!allocator.Allocate(persistent + 1u).IsValid() && allocator.Allocate(persistent).index == 0u);
+
+		// Several recording threads share a frame's slice: every descriptor handed out once, the rest refused
+		constexpr std::uint32_t bigSlice = 4096u;
+		NullDescriptorHeap bigHeap(bigSlice * 2u);
+		DescriptorAllocator shared(bigHeap, 0u, bigSlice, 2u);
+		shared.BeginFrame(1u);
+		std::vector<std::vector<std::uint32_t>> indices(4u);
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0u; t < indices.size(); t++)
+		{
+			threads.emplace_back([&, t]
+			{
+				for (int i = 0; i < 2000; i++)
+				{
+					const DescriptorHandle handle = shared.AllocateTransient(1u);
+					if (handle.IsValid())
+					{
+						indices[t].push_back(handle.index);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		std::vector<std::uint32_t> all;
+		for (const auto& perThread : indices)
+		{
+			all.insert(all.end(), perThread.begin(), perThread.end());
+		}
+		std::sort(all.begin(), all.end());
+		CHECK(all.size() == bigSlice && all.front() == bigSlice && all.back() == bigSlice * 2u - 1u);
+		CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+		CHECK(shared.GetStats().failedAllocations == 8000u - bigSlice);
+	}
+
+	void TestFragmentation()
+	{
+		NullDescriptorHeap heap(64u);
+		DescriptorAllocator allocator(heap, 64u, 0u, 1u);
+		std::vector<DescriptorHandle> handles;
+		for (int i = 0; i < 64; i++)
+		{
+			handles.push_back(allocator.Allocate(1u));
+		}
+		CHECK(allocator.GetStats().freeBlockCount == 0u && allocator.GetStats().GetFragmentation() == 0.0f);
+		// Every other one back: 32 free descriptors, none of them next to a free buddy
+		for (std::size_t i = 0u; i < handles.size(); i += 2u)
+		{
+			allocator.Free(handles[i], 1u);
+		}
+		allocator.Retire(1u);
+		DescriptorAllocator::Stats stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 32u && stats.largestFreeBlock == 1u);
+		CHECK(stats.GetFragmentation() == 1.0f - 1.0f / 32.0f);
+		CHECK(!allocator.Allocate(2u).IsValid());
+		// The other half merges it all back up
+		for (std::size_t i = 1u; i < handles.size(); i += 2u)
+		{
+			allocator.Free(handles[i], 2u);
+		}
+		allocator.Retire(2u);
+		stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1u && stats.largestFreeBlock == 64u && stats.GetFragmentation() == 0.0f);
+	}
+
+	// Random allocs and fenced frees, checked against a map of which descriptors are in use.
+	// Freed ranges only count as unused once their fence is retired, so early reuse shows up as an overlap.
+	void TestChurn()
+	{
+		constexpr std::uint32_t capacity = 1000u;
+		NullDescriptorHeap heap(capacity);
+		DescriptorAllocator allocator(heap, capacity, 0u, 1u);
+		std::vector<bool> used(capacity, false);
+		std::vector<DescriptorHandle> live;
+		std::vector<std::pair<DescriptorHandle, std::uint64_t>> pending;
+		std::mt19937 rng(29u);
+		std::uint64_t fence = 0u;
+		bool noOverlap = true;
+		for (int step = 0; step < 100000; step++)
+		{
+			if (live.empty() || rng() % 2u == 0u)
+			{
+				const std::uint32_t count = 1u + rng() % 24u;
+				const DescriptorHandle handle = allocator.Allocate(count);
+				if (handle.IsValid())
+				{
+					for (std::uint32_t i = handle.index; i < handle.index + count; i++)
+					{
+						noOverlap &= i < capacity && !used[i];
+						used[i] = true;
+					}
+					live.push_back(handle);
+				}
+			}
+			else
+			{
+				const std::size_t pick = rng() % live.size();
+				allocator.Free(live[pick], fence);
+				pending.emplace_back(live[pick], fence);
+				live[pick] = live.back();
+				live.pop_back();
+			}
+			// Two frames in flight
+			if (step % 16 == 0 && ++fence >= 2u)
+			{
+				allocator.Retire(fence - 2u);
+				const auto retired = std::partition(pending.begin(), pending.end(), [&](const auto& p) { return p.second > fence - 2u; });
+				for (auto it = retired; it != pending.end(); ++it)
+				{
+					std::fill(used.begin() + it->first.index, used.begin() + it->first.index + it->first.count, false);
+				}
+				pending.erase(retired, pending.end());
+			}
+		}
+		CHECK(noOverlap);
+		for (const DescriptorHandle& handle : live)
+		{
+			allocator.Free(handle, fence);
+		}
+		allocator.Retire(fence);
+		const DescriptorAllocator::Stats stats = allocator.GetStats();
+		// Back to 512 + 256 + 128 + 64 + 32 + 8
+		CHECK(stats.persistentAllocated == 0u && stats.pendingFrees == 0u && stats.freeBlockCount == 6u && stats.largestFreeBlock == 512u);
+	}
+}
+
+int main()
+{
+	TestSplitAndMerge();
+	TestDeferredFree();
+	TestTransient();
+	TestFragmentation();
+	TestChurn();
+	return Test::Finish("DescriptorAllocatorTest");
+}
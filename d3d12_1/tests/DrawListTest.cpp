@@ -0,0 +1,144 @@
+// DrawList::Sort (serial and over a pool) against std::stable_sort on the same keys, plus timings.
+// Build as a console program together with src/DrawList.cpp, src/CommandList.cpp, src/ThreadPool.cpp
+// and src/EggCeption.cpp.
+//
+//   DrawListTest [--bench]
+
+#include "../src/DrawList.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::vector<std::uint32_t> ReferenceOrder(const DrawList& list)
+	{
+		std::vector<std::uint32_t> order(list.Size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [&list](std::uint32_t a, std::uint32_t b)
+		{
+			return list.GetKey(a) < list.GetKey(b);
+		});
+		return order;
+	}
+
+	// What a frame looks like: few layers/passes, some pipelines and materials, lots of equal keys
+	std::uint64_t SceneKey(std::mt19937& rng)
+	{
+		return DrawKey::Make(rng() % 3u, rng() % 4u, rng() % 40u, rng() % 500u, DrawKey::QuantizeDepth(float(rng() % 1000u) / 1000.0f));
+	}
+
+	void Fill(DrawList& list, std::mt19937& rng, std::size_t count, int keyKind)
+	{
+		list.Reset();
+		list.Reserve(count);
+		for (std::size_t i = 0u; i < count; i++)
+		{
+			DrawItem item;
+			item.indexCount = static_cast<std::uint32_t>(i);
+			std::uint64_t key = 0u;
+			switch (keyKind)
+			{
+			case 0:
+				key = SceneKey(rng);
+				break;
+			case 1:
+				// Every bit random, so all eight passes run
+				key = (std::uint64_t(rng()) << 32u) | rng();
+				break;
+			case 2:
+				// Only a handful of distinct keys: stability is all that decides the order
+				key = DrawKey::Make(1u, 0u, rng() % 3u, 7u, 0u);
+				break;
+			default:
+				// Already sorted, and reverse sorted
+				key = keyKind == 3 ? i : count - i;
+				break;
+			}
+			list.Add(key, item);
+		}
+	}
+
+	void TestAgainstStableSort()
+	{
+		std::mt19937 rng(35u);
+		// Forces several blocks even on a single core machine
+		ThreadPool pool(4u);
+		std::size_t sorted = 0u;
+		bool serialMatches = true;
+		bool poolMatches = true;
+		// Around the block split threshold (2 x 16k) too
+		for (const std::size_t count : { 0u, 1u, 2u, 3u, 255u, 256u, 257u, 1000u, 32767u, 32768u, 32769u, 100001u, 1000000u })
+		{
+			for (int keyKind = 0; keyKind < 5; keyKind++)
+			{
+				DrawList list;
+				Fill(list, rng, count, keyKind);
+				const std::vector<std::uint32_t> reference = ReferenceOrder(list);
+				list.Sort();
+				serialMatches &= list.GetOrder() == reference;
+				list.Sort(pool);
+				poolMatches &= list.GetOrder() == reference;
+				// Submission order is kept in the items too
+				for (std::size_t i = 0u; i < count; i += 997u)
+				{
+					poolMatches &= list.GetItem(reference[i]).indexCount == reference[i];
+				}
+				sorted += count;
+			}
+		}
+		std::printf("sorted %zu draws\n", sorted);
+		CHECK(serialMatches);
+		CHECK(poolMatches);
+	}
+
+	void TestKeys()
+	{
+		constexpr std::uint64_t key = DrawKey::Make(DrawKey::layerMax, 3u, DrawKey::pipelineMax, 1234u, DrawKey::depthMax);
+		static_assert(DrawKey::GetLayer(key) == DrawKey::layerMax && DrawKey::GetPass(key) == 3u);
+		static_assert(DrawKey::GetPipeline(key) == DrawKey::pipelineMax && DrawKey::GetMaterial(key) == 1234u);
+		static_assert(DrawKey::GetDepth(key) == DrawKey::depthMax);
+		// Fields order the key most significant first
+		CHECK(DrawKey::Make(0u, 1u, 0u, 0u, 0u) > DrawKey::Make(0u, 0u, DrawKey::pipelineMax, DrawKey::materialMax, DrawKey::depthMax));
+		CHECK(DrawKey::Make(0u, 0u, 1u, 0u, 0u) > DrawKey::Make(0u, 0u, 0u, DrawKey::materialMax, DrawKey::depthMax));
+		CHECK(DrawKey::QuantizeDepth(0.0f) == 0u && DrawKey::QuantizeDepth(1.0f) == DrawKey::depthMax);
+		CHECK(DrawKey::QuantizeDepth(0.25f, true) > DrawKey::QuantizeDepth(0.75f, true));
+	}
+
+	void Benchmark()
+	{
+		std::mt19937 rng(5u);
+		ThreadPool& pool = ThreadPool::Default();
+		for (const std::size_t count : { 10000u, 100000u, 1000000u })
+		{
+			DrawList list;
+			Fill(list, rng, count, 0);
+			std::vector<std::uint32_t> order(count);
+			const double stableMs = Test::BestOfMs(5, [&]
+			{
+				std::iota(order.begin(), order.end(), 0u);
+				std::stable_sort(order.begin(), order.end(), [&list](std::uint32_t a, std::uint32_t b)
+				{
+					return list.GetKey(a) < list.GetKey(b);
+				});
+			});
+			const double serialMs = Test::BestOfMs(5, [&] { list.Sort(); });
+			const double poolMs = Test::BestOfMs(5, [&] { list.Sort(pool); });
+			std::printf("%7zu draws: radix %7.3f ms  radix on pool %7.3f ms  std::stable_sort %7.3f ms  (%u passes)\n",
+				count, serialMs, poolMs, stableMs, list.GetStats().radixPasses);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TestKeys();
+	TestAgainstStableSort();
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark();
+	}
+	return Test::Finish("DrawListTest");
+}
@@ -0,0 +1,359 @@
+// World / Archetype checks: component data survives random structural churn, and chunks stay dense.
+// Build as a console program together with src/Ecs.cpp and src/ThreadPool.cpp.
+//
+//   EcsTest [--bench]
+//
+// --bench times iterating 1M entities and a frame's worth of structural changes.
+
+#include "../src/Ecs.h"
+#include "TestCommon.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	// Not trivially movable, so archetype moves have to go through the registry's move/destroy
+	struct Name
+	{
+		std::string text;
+	};
+
+	struct Tag
+	{
+		int value;
+	};
+
+	enum : unsigned
+	{
+		hasVelocity = 1u,
+		hasName = 2u,
+		hasTag = 4u
+	};
+
+	// What the test expects each live entity to hold
+	struct Expected
+	{
+		Entity entity;
+		unsigned components = 0u;
+		float x = 0.0f;
+		std::string name;
+		int tag = 0;
+	};
+
+	unsigned ComponentsOf(World& world, Entity entity)
+	{
+		return (world.Has<Velocity>(entity) ? hasVelocity : 0u) | (world.Has<Name>(entity) ? hasName : 0u) | (world.Has<Tag>(entity) ? hasTag : 0u);
+	}
+
+	Entity CreateWith(World& world, unsigned components, float x, const std::string& name, int tag)
+	{
+		const Entity entity = world.Create(Position{ x, 0.0f, 0.0f });
+		if (components & hasVelocity)
+		{
+			world.Add(entity, Velocity{ 1.0f, 2.0f, 3.0f });
+		}
+		if (components & hasName)
+		{
+			world.Add(entity, Name{ name });
+		}
+		if (components & hasTag)
+		{
+			world.Add(entity, Tag{ tag });
+		}
+		return entity;
+	}
+
+	// Rows per chunk for an archetype, found by filling one until a second chunk shows up
+	std::size_t ChunkCapacity(unsigned components)
+	{
+		World world;
+		std::size_t firstChunk = 0u;
+		std::size_t chunkCount = 0u;
+		while (chunkCount < 2u)
+		{
+			CreateWith(world, components, 0.0f, "probe", 0);
+			chunkCount = 0u;
+			world.ForEachChunk<Position>([&](std::size_t count, const Entity*, Position*)
+			{
+				if (chunkCount++ == 0u)
+				{
+					firstChunk = count;
+				}
+			});
+		}
+		return firstChunk;
+	}
+
+	// Chunks of one archetype are visited back to back, so each run of same-archetype chunks is one archetype.
+	// All but the last chunk of each must be full.
+	bool ChunksAreDense(World& world, const std::vector<std::size_t>& capacities)
+	{
+		bool dense = true;
+		bool previousFull = true;
+		unsigned previousComponents = ~0u;
+		std::size_t nonEmptyChunks = 0u;
+		std::size_t archetypesSeen = 0u;
+		world.ForEachChunk<Position>([&](std::size_t count, const Entity* pEntities, Position*)
+		{
+			const unsigned components = ComponentsOf(world, pEntities[0]);
+			if (components != previousComponents)
+			{
+				archetypesSeen++;
+			}
+			else
+			{
+				dense &= previousFull;
+			}
+			previousFull = count == capacities[components];
+			previousComponents = components;
+			nonEmptyChunks++;
+		});
+		// Plus at most one empty spare per archetype (counted even for archetypes that are empty right now)
+		const World::Stats stats = world.GetStats();
+		dense &= stats.chunks <= nonEmptyChunks + stats.archetypes;
+		return dense && archetypesSeen <= stats.archetypes;
+	}
+
+	void TestChurn()
+	{
+		std::vector<std::size_t> capacities(8u);
+		for (unsigned components = 0u; components < 8u; components++)
+		{
+			capacities[components] = ChunkCapacity(components);
+		}
+
+		World world;
+		std::vector<Expected> alive;
+		std::mt19937 rng(33u);
+		int nextTag = 0;
+		bool dataMatches = true;
+		bool denseThroughout = true;
+		for (int step = 0; step < 200000; step++)
+		{
+			if (step % 1000 == 0)
+			{
+				denseThroughout &= ChunksAreDense(world, capacities);
+			}
+			// Bias toward growing early and shrinking late, so chunks fill up, drain and refill
+			const bool growing = (step / 25000) % 2 == 0;
+			// Growing: 4/8 create, 1/8 destroy. Shrinking: 1/8 create, 3/8 destroy. The rest add/remove a component.
+			const unsigned roll = rng() % 8u;
+			const unsigned createBelow = growing ? 4u : 1u;
+			const unsigned destroyBelow = growing ? 5u : 4u;
+			if (alive.empty() || roll < createBelow)
+			{
+				Expected e;
+				e.components = rng() % 8u;
+				e.x = static_cast<float>(step);
+				e.name = "entity " + std::to_string(step) + " with a name too long for the small string buffer";
+				e.tag = nextTag++;
+				e.entity = CreateWith(world, e.components, e.x, e.name, e.tag);
+				alive.push_back(std::move(e));
+				continue;
+			}
+			const std::size_t pick = rng() % alive.size();
+			Expected& e = alive[pick];
+			if (roll < destroyBelow)
+			{
+				world.Destroy(e.entity);
+				CHECK(!world.IsAlive(e.entity));
+				e = std::move(alive.back());
+				alive.pop_back();
+				continue;
+			}
+			switch (rng() % 3u)
+			{
+			case 0u:
+				if (e.components & hasTag)
+				{
+					world.Remove<Tag>(e.entity);
+				}
+				else
+				{
+					e.tag = nextTag++;
+					world.Add(e.entity, Tag{ e.tag });
+				}
+				e.components ^= hasTag;
+				break;
+			case 1u:
+				if (e.components & hasName)
+				{
+					world.Remove<Name>(e.entity);
+				}
+				else
+				{
+					world.Add(e.entity, Name{ e.name });
+				}
+				e.components ^= hasName;
+				break;
+			default:
+				if (e.components & hasVelocity)
+				{
+					world.Remove<Velocity>(e.entity);
+				}
+				else
+				{
+					world.Add(e.entity, Velocity{ 1.0f, 2.0f, 3.0f });
+				}
+				e.components ^= hasVelocity;
+				break;
+			}
+		}
+		for (const Expected& e : alive)
+		{
+			const Position* pPosition = world.Get<Position>(e.entity);
+			dataMatches &= world.IsAlive(e.entity) && ComponentsOf(world, e.entity) == e.components;
+			dataMatches &= pPosition != nullptr && pPosition->x == e.x;
+			if (e.components & hasName)
+			{
+				dataMatches &= world.Get<Name>(e.entity)->text == e.name;
+			}
+			if (e.components & hasTag)
+			{
+				dataMatches &= world.Get<Tag>(e.entity)->value == e.tag;
+			}
+		}
+		std::size_t visited = 0u;
+		world.ForEach<Position>([&](Entity entity, Position&)
+		{
+			dataMatches &= world.IsAlive(entity);
+			visited++;
+		});
+		std::printf("churn: %zu entities alive, %zu chunks\n", alive.size(), world.GetStats().chunks);
+		CHECK(dataMatches);
+		CHECK(visited == alive.size() && world.GetStats().entities == alive.size());
+		CHECK(denseThroughout);
+		CHECK(ChunksAreDense(world, capacities));
+	}
+
+	// Drain one archetype down to a partial chunk with a spare behind it, then refill it
+	void TestSpareChunkReuse()
+	{
+		const std::size_t capacity = ChunkCapacity(0u);
+		World world;
+		std::vector<Entity> entities;
+		for (std::size_t i = 0u; i < capacity * 2u; i++)
+		{
+			entities.push_back(world.Create(Position{ static_cast<float>(i), 0.0f, 0.0f }));
+		}
+		// Empty the second chunk (it stays as the spare) and take a few out of the first
+		for (std::size_t i = 0u; i < capacity + 3u; i++)
+		{
+			world.Destroy(entities.back());
+			entities.pop_back();
+		}
+		CHECK(world.GetStats().chunks == 2u);
+		for (int i = 0; i < 3; i++)
+		{
+			entities.push_back(world.Create(Position{}));
+		}
+		std::vector<std::size_t> counts;
+		world.ForEachChunk<Position>([&](std::size_t count, const Entity*, Position*)
+		{
+			counts.push_back(count);
+		});
+		CHECK(counts.size() == 1u && counts[0] == capacity);
+		// Next one goes into the spare
+		entities.push_back(world.Create(Position{}));
+		counts.clear();
+		world.ForEachChunk<Position>([&](std::size_t count, const Entity*, Position*)
+		{
+			counts.push_back(count);
+		});
+		CHECK(counts.size() == 2u && counts[0] == capacity && counts[1] == 1u);
+		CHECK(world.GetStats().chunks == 2u);
+	}
+
+	void Benchmark()
+	{
+		constexpr std::size_t entityCount = 1000000u;
+		World world;
+		std::vector<Entity> entities;
+		entities.reserve(entityCount);
+		for (std::size_t i = 0u; i < entityCount; i++)
+		{
+			entities.push_back(world.Create(Position{ static_cast<float>(i), 0.0f, 0.0f }, Velocity{ 1.0f, 2.0f, 3.0f }));
+		}
+		const auto integrate = [](std::size_t count, const Entity*, Position* pPositions, Velocity* pVelocities)
+		{
+			for (std::size_t i = 0u; i < count; i++)
+			{
+				pPositions[i].x += pVelocities[i].x * 0.016f;
+				pPositions[i].y += pVelocities[i].y * 0.016f;
+				pPositions[i].z += pVelocities[i].z * 0.016f;
+			}
+		};
+		const double forEachMs = Test::BestOfMs(5, [&]
+		{
+			world.ForEach<Position, Velocity>([](Entity, Position& p, Velocity& v)
+			{
+				p.x += v.x * 0.016f;
+				p.y += v.y * 0.016f;
+				p.z += v.z * 0.016f;
+			});
+		});
+		const double chunkMs = Test::BestOfMs(5, [&]
+		{
+			world.ForEachChunk<Position, Velocity>(integrate);
+		});
+		const double parallelMs = Test::BestOfMs(5, [&]
+		{
+			world.ParallelForEachChunk<Position, Velocity>(ThreadPool::Default(), integrate);
+		});
+		std::printf("iterate 1M: ForEach %.2f ms, ForEachChunk %.2f ms, ParallelForEachChunk %.2f ms\n", forEachMs, chunkMs, parallelMs);
+
+		// A busy frame: spawn, despawn and retag a few thousand entities each, on top of the 1M
+		constexpr std::size_t changesPerKind = 5000u;
+		constexpr int frames = 20;
+		std::mt19937 rng(7u);
+		const double frameMs = Test::BestOfMs(frames, [&]
+		{
+			for (std::size_t i = 0u; i < changesPerKind; i++)
+			{
+				entities.push_back(world.Create(Position{}, Velocity{}));
+			}
+			for (std::size_t i = 0u; i < changesPerKind; i++)
+			{
+				const std::size_t pick = rng() % entities.size();
+				world.Destroy(entities[pick]);
+				entities[pick] = entities.back();
+				entities.pop_back();
+			}
+			for (std::size_t i = 0u; i < changesPerKind; i++)
+			{
+				const Entity entity = entities[rng() % entities.size()];
+				if (world.Has<Tag>(entity))
+				{
+					world.Remove<Tag>(entity);
+				}
+				else
+				{
+					world.Add(entity, Tag{ 1 });
+				}
+			}
+		});
+		std::printf("structural changes: %.2f ms per frame of %zu (%.0f ns each)\n", frameMs, changesPerKind * 3u, frameMs * 1e6 / (changesPerKind * 3u));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TestSpareChunkReuse();
+	TestChurn();
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark();
+	}
+	return Test::Finish("EcsTest");
+}
@@ -0,0 +1,230 @@
+// FrameContextManager, GpuTimeline and UploadRing: BeginFrame() only blocks once the CPU is frameCount frames
+// ahead, deferred destroys run after their fence and never before, ring space is reused once its frame retires,
+// and frame pacing against a simulated GPU.
+// Build as a console program together with src/FrameContext.cpp, src/UploadRing.cpp, src/Fence.cpp,
+// src/MemoryArena.cpp, src/CommandList.cpp and src/EggCeption.cpp.
+//
+//   FrameContextTest
+
+#include "../src/FrameContext.h"
+#include "../src/UploadRing.h"
+#include "TestCommon.h"
+#include <atomic>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// Runs BeginFrame() on another thread and reports whether it came back within the timeout
+	class BeginFrameProbe
+	{
+	public:
+		explicit BeginFrameProbe(FrameContextManager& manager)
+			:
+			thread([this, &manager]
+			{
+				manager.BeginFrame();
+				returned = true;
+			})
+		{}
+		~BeginFrameProbe()
+		{
+			thread.join();
+		}
+		bool HasReturned(std::chrono::milliseconds timeout) const
+		{
+			const auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (!returned && std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::sleep_for(100us);
+			}
+			return returned;
+		}
+	private:
+		std::atomic<bool> returned{ false };
+		std::thread thread;
+	};
+
+	void TestBlocksOnlyWhenAhead()
+	{
+		for (unsigned int frameCount = 1u; frameCount <= 3u; frameCount++)
+		{
+			Fence fence;
+			FrameContextManager manager(fence, frameCount, 4096u);
+			// The GPU hasn't finished anything, and the CPU still gets frameCount frames in
+			for (unsigned int i = 0u; i < frameCount; i++)
+			{
+				CHECK(manager.BeginFrame().GetIndex() == i);
+				manager.EndFrame();
+			}
+			CHECK(manager.GetStats().waits == 0u);
+			{
+				// One more has to wait for the first frame, and only the first
+				BeginFrameProbe probe(manager);
+				CHECK(!probe.HasReturned(30ms));
+				fence.Complete(1u);
+				CHECK(probe.HasReturned(5000ms));
+			}
+			CHECK(manager.GetStats().waits == 1u && manager.Current().GetIndex() == 0u);
+			manager.EndFrame();
+			// Everything done: no waiting at all
+			fence.Complete(fence.GetSignaledValue());
+			for (unsigned int i = 0u; i < frameCount * 2u; i++)
+			{
+				manager.BeginFrame();
+				fence.Complete(manager.EndFrame());
+			}
+			CHECK(manager.GetStats().waits == 1u && manager.GetStats().framesBegun == frameCount * 3u + 1u);
+		}
+	}
+
+	void TestDeferredDestroy()
+	{
+		Fence fence;
+		std::atomic<int> destroyed{ 0 };
+		std::atomic<int> destroyedEarly{ 0 };
+		{
+			GpuTimeline gpu(fence, 300us);
+			FrameContextManager manager(fence, 2u, 4096u);
+			for (std::uint64_t frame = 1u; frame <= 50u; frame++)
+			{
+				FrameContext& context = manager.BeginFrame();
+				// The frame being recorded gets fence value `frame`; its destroys must wait for that
+				context.DeferDestroy([&, frame]
+				{
+					destroyedEarly += fence.IsComplete(frame) ? 0 : 1;
+					destroyed++;
+				});
+				const std::uint64_t fenceValue = manager.EndFrame();
+				CHECK(fenceValue == frame);
+				gpu.Submit(fenceValue);
+			}
+			// Each context recycles the destroys from its last use, so the last frameCount frames' are still pending
+			CHECK(destroyed == 48 && manager.GetStats().deferredDestroysRun == 48u);
+			manager.WaitIdle();
+			CHECK(destroyed == 50);
+		}
+		CHECK(destroyedEarly == 0);
+
+		// Destroys still pending when the manager goes away run after the GPU catches up
+		Fence slowFence;
+		destroyed = 0;
+		{
+			GpuTimeline gpu(slowFence, 20ms);
+			FrameContextManager manager(slowFence, 2u, 4096u);
+			FrameContext& context = manager.BeginFrame();
+			context.DeferDestroy([&]
+			{
+				destroyedEarly += slowFence.IsComplete(1u) ? 0 : 1;
+				destroyed++;
+			});
+			gpu.Submit(manager.EndFrame());
+		}
+		CHECK(destroyed == 1 && destroyedEarly == 0);
+	}
+
+	void TestUploadRingReuse()
+	{
+		Fence fence;
+		UploadRing ring(64u * 1024u, fence);
+		// Frame 1 takes most of the ring
+		const UploadRing::Allocation first = ring.Allocate(40u * 1024u);
+		ring.EndFrame(fence.Signal());
+		// Frame 2 fits in what's left, and doesn't overlap frame 1
+		const UploadRing::Allocation second = ring.Allocate(16u * 1024u);
+		CHECK(!second.isDedicated && second.gpuAddress >= first.gpuAddress + first.size);
+		ring.EndFrame(fence.Signal());
+		CHECK(ring.GetStats().used >= 56u * 1024u);
+		// Retiring a value nothing is tagged with yet frees nothing
+		ring.Retire(0u);
+		CHECK(ring.GetStats().used >= 56u * 1024u);
+		// Once frame 1 has completed its space comes back, starting from the front of the ring
+		fence.Complete(1u);
+		ring.Retire(fence.GetCompletedValue());
+		const UploadRing::Allocation reused = ring.Allocate(32u * 1024u);
+		CHECK(!reused.isDedicated && reused.gpuAddress == first.gpuAddress && ring.GetStats().stalls == 0u);
+		ring.EndFrame(fence.Signal());
+
+		// Full ring with frames still in flight: Allocate() stalls until the GPU finishes the oldest one
+		{
+			GpuTimeline gpu(fence, 10ms);
+			gpu.Submit(2u);
+			gpu.Submit(3u);
+			const UploadRing::Allocation stalled = ring.Allocate(24u * 1024u);
+			CHECK(!stalled.isDedicated && ring.GetStats().stalls == 1u);
+			// It only got space once frame 2 was done with it
+			CHECK(fence.IsComplete(2u) && stalled.gpuAddress == second.gpuAddress - 8u * 1024u);
+			ring.EndFrame(fence.Signal());
+			gpu.Submit(4u);
+		}
+		ring.Retire(fence.GetCompletedValue());
+		CHECK(ring.GetStats().used == 0u);
+
+		// Bigger than the whole ring: dedicated block, released through the same fence
+		const UploadRing::Allocation big = ring.Allocate(100u * 1024u, 512u);
+		CHECK(big.isDedicated && reinterpret_cast<std::uintptr_t>(big.pCpu) % 512u == 0u);
+		ring.EndFrame(fence.Signal());
+		ring.Retire(fence.GetCompletedValue());
+		CHECK(ring.GetStats().dedicatedBytesLive == 100u * 1024u);
+		fence.Complete(fence.GetSignaledValue());
+		ring.Retire(fence.GetCompletedValue());
+		CHECK(ring.GetStats().dedicatedBytesLive == 0u);
+	}
+
+	// CPU frames are nearly free and the GPU takes gpuTime each: the CPU ends up waiting every frame, never
+	// more than frameCount frames ahead, and the whole run takes as long as the GPU work
+	void TestPacing()
+	{
+		constexpr std::chrono::microseconds gpuTime = 2ms;
+		constexpr int frames = 50;
+		Fence fence;
+		GpuTimeline gpu(fence, gpuTime);
+		FrameContextManager manager(fence, 2u, 4096u);
+		bool neverTooFarAhead = true;
+		const auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			manager.BeginFrame();
+			neverTooFarAhead &= fence.GetSignaledValue() - fence.GetCompletedValue() < manager.GetFrameCount();
+			gpu.Submit(manager.EndFrame());
+		}
+		manager.WaitIdle();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		const FrameContextManager::Stats stats = manager.GetStats();
+		std::printf("pacing: %d frames of %lld us GPU work in %.1f ms, %llu waits totalling %.1f ms\n", frames,
+			static_cast<long long>(gpuTime.count()), std::chrono::duration<double, std::milli>(elapsed).count(),
+			static_cast<unsigned long long>(stats.waits), std::chrono::duration<double, std::milli>(stats.waitTime).count());
+		CHECK(neverTooFarAhead);
+		CHECK(elapsed >= gpuTime * frames);
+		CHECK(stats.waits >= static_cast<std::uint64_t>(frames) - 2u * manager.GetFrameCount());
+		// The timeline counts a submission just after completing its fence, so give it a moment to catch up
+		const auto deadline = std::chrono::steady_clock::now() + 1s;
+		while (gpu.GetStats().completed < static_cast<std::uint64_t>(frames) && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(100us);
+		}
+		CHECK(gpu.GetStats().completed == static_cast<std::uint64_t>(frames) && gpu.GetStats().busyTime == gpuTime * frames);
+
+		// With the CPU the slower side, BeginFrame() never has to wait
+		Fence cpuBoundFence;
+		GpuTimeline fastGpu(cpuBoundFence, 200us);
+		FrameContextManager cpuBound(cpuBoundFence, 2u, 4096u);
+		for (int frame = 0; frame < 20; frame++)
+		{
+			cpuBound.BeginFrame();
+			std::this_thread::sleep_for(3ms);
+			fastGpu.Submit(cpuBound.EndFrame());
+		}
+		CHECK(cpuBound.GetStats().waits <= 1u);
+	}
+}
+
+int main()
+{
+	TestBlocksOnlyWhenAhead();
+	TestDeferredDestroy();
+	TestUploadRingReuse();
+	TestPacing();
+	return Test::Finish("FrameContextTest");
+}
@@ -0,0 +1,304 @@
+// MeshFile and ObjImporter: a mesh written to disk and mapped back is identical, MeshView::Parse() refuses
+// truncated files, bad section offsets and string table entries past the end, and the OBJ corner cases
+// (negative indices, v//n corners, usemtl before any faces, generated normals).
+// Build as a console program together with src/MeshFile.cpp, src/ObjImporter.cpp, src/MappedFile.cpp
+// and src/EggCeption.cpp.
+//
+//   MeshFileTest
+
+#include "../src/MeshFile.h"
+#include "../src/ObjImporter.h"
+#include "TestCommon.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	// Two quads on different materials, the second one with no name
+	MeshData MakeMesh()
+	{
+		MeshData mesh;
+		for (int i = 0; i < 8; i++)
+		{
+			const float x = static_cast<float>(i % 2);
+			const float y = static_cast<float>(i / 2 % 2);
+			const float z = static_cast<float>(i / 4);
+			mesh.vertices.push_back({ { x, y, z }, { 0.0f, 0.0f, 1.0f }, { x, 1.0f - y } });
+		}
+		mesh.indices = { 0u, 1u, 3u, 0u, 3u, 2u, 4u, 5u, 7u, 4u, 7u, 6u };
+		mesh.submeshes.push_back({ "brick", 0u, 6u, { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } } });
+		mesh.submeshes.push_back({ "", 6u, 6u, { { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } } });
+		mesh.bounds = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+		return mesh;
+	}
+
+	bool SameAs(const MeshView& view, const MeshData& mesh)
+	{
+		bool same = view.GetVertices().size() == mesh.vertices.size() && view.GetIndices().size() == mesh.indices.size() &&
+			view.GetSubmeshes().size() == mesh.submeshes.size() &&
+			std::memcmp(view.GetVertices().data(), mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex)) == 0 &&
+			std::memcmp(view.GetIndices().data(), mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t)) == 0 &&
+			std::memcmp(&view.GetBounds(), &mesh.bounds, sizeof(MeshBounds)) == 0;
+		for (std::size_t i = 0u; same && i < mesh.submeshes.size(); i++)
+		{
+			const MeshSubmesh& submesh = view.GetSubmeshes()[i];
+			same = view.GetSubmeshName(i) == mesh.submeshes[i].material && submesh.indexStart == mesh.submeshes[i].indexStart &&
+				submesh.indexCount == mesh.submeshes[i].indexCount && std::memcmp(&submesh.bounds, &mesh.submeshes[i].bounds, sizeof(MeshBounds)) == 0;
+		}
+		return same;
+	}
+
+	bool ParseThrows(std::span<const std::byte> bytes)
+	{
+		try
+		{
+			MeshView::Parse(bytes);
+		}
+		catch (const MeshFile::Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	// Copy of image with its header (and submesh table) edited
+	std::vector<std::byte> Patch(const std::vector<std::byte>& image, const std::function<void(MeshFileHeader&, MeshSubmesh*)>& edit)
+	{
+		std::vector<std::byte> patched = image;
+		MeshFileHeader header;
+		std::memcpy(&header, patched.data(), sizeof(header));
+		std::vector<MeshSubmesh> submeshes(header.submeshCount);
+		std::memcpy(submeshes.data(), patched.data() + header.submeshOffset, submeshes.size() * sizeof(MeshSubmesh));
+		const std::uint64_t submeshOffset = header.submeshOffset;
+		edit(header, submeshes.data());
+		std::memcpy(patched.data(), &header, sizeof(header));
+		std::memcpy(patched.data() + submeshOffset, submeshes.data(), submeshes.size() * sizeof(MeshSubmesh));
+		return patched;
+	}
+
+	void TestRoundTrip(const std::filesystem::path& directory)
+	{
+		const MeshData mesh = MakeMesh();
+		const std::vector<std::byte> image = MeshFile::Serialize(mesh);
+		const MeshView view = MeshView::Parse(image);
+		CHECK(SameAs(view, mesh) && view.ValidateIndices());
+		// Blobs sit on their alignment, and the file ends right after the string table
+		const auto offsetOf = [&](const void* p) { return static_cast<std::size_t>(static_cast<const std::byte*>(p) - image.data()); };
+		CHECK(offsetOf(view.GetVertices().data()) % meshBlobAlignment == 0u && offsetOf(view.GetIndices().data()) % meshBlobAlignment == 0u &&
+			offsetOf(view.GetSubmeshes().data()) % meshBlobAlignment == 0u);
+		CHECK(image.size() == offsetOf(view.GetSubmeshName(0u).data()) + 5u);
+
+		// Through the disk and a mapping, byte for byte the same
+		const std::string path = (directory / "quads.emesh").string();
+		MeshFile::Write(mesh, path);
+		{
+			const MeshFile file(path);
+			CHECK(SameAs(file.View(), mesh));
+		}
+		// Serializing is deterministic, padding included
+		std::ifstream written(path, std::ios::binary);
+		const std::vector<char> bytes((std::istreambuf_iterator<char>(written)), std::istreambuf_iterator<char>());
+		CHECK(bytes.size() == image.size() && std::memcmp(bytes.data(), image.data(), image.size()) == 0);
+
+		// An empty mesh is still a valid file
+		const std::vector<std::byte> empty = MeshFile::Serialize(MeshData());
+		const MeshView emptyView = MeshView::Parse(empty);
+		CHECK(emptyView.GetVertices().empty() && emptyView.GetIndices().empty() && emptyView.GetSubmeshes().empty() && emptyView.ValidateIndices());
+
+		// Files cut short on disk are refused when mapped, including an empty one
+		for (const std::size_t size : { image.size() - 1u, std::size_t(50u), std::size_t(0u) })
+		{
+			std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(size));
+			bool refused = false;
+			try
+			{
+				MeshFile file(path);
+			}
+			catch (const MeshFile::Exception&)
+			{
+				refused = true;
+			}
+			CHECK(refused);
+		}
+	}
+
+	void TestParseRejects()
+	{
+		const std::vector<std::byte> image = MeshFile::Serialize(MakeMesh());
+		// Every truncation, and trailing data
+		bool truncationsRefused = true;
+		for (std::size_t size = 0u; size < image.size(); size++)
+		{
+			truncationsRefused &= ParseThrows(std::span(image).first(size));
+		}
+		CHECK(truncationsRefused);
+		std::vector<std::byte> longer = image;
+		longer.push_back(std::byte{ 0 });
+		CHECK(ParseThrows(longer));
+		// Misaligned start of the buffer
+		std::vector<std::byte> shifted(image.size() + 8u);
+		std::memcpy(shifted.data() + 4u, image.data(), image.size());
+		CHECK(ParseThrows(std::span(shifted).subspan(4u, image.size())));
+
+		// Header fields
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.magic[0] = 'X'; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.version++; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.headerSize += 4u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.vertexStride = 28u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.fileSize--; })));
+
+		// Section offsets: misaligned, past the end, wrapping around, and counts that run off the end
+		constexpr std::uint64_t huge = std::numeric_limits<std::uint64_t>::max() - 63u;
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.vertexOffset += 4u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.indexOffset = h.fileSize + meshBlobAlignment; })));
+		CHECK(ParseThrows(Patch(image, [&](MeshFileHeader& h, MeshSubmesh*) { h.submeshOffset = huge; })));
+		CHECK(ParseThrows(Patch(image, [&](MeshFileHeader& h, MeshSubmesh*) { h.stringTableOffset = huge + 60u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.vertexCount = 0xFFFFFFFFu; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.indexCount += 1000u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.submeshCount += 1u; })));
+		// An offset that's aligned and in bounds is fine even if it isn't where the writer put it
+		CHECK(!ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.indexOffset = h.vertexOffset; h.indexCount = 12u; })));
+
+		// String table entries that start or end past the table, or wrap a 32-bit sum
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader& h, MeshSubmesh*) { h.stringTableSize++; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[0].nameLength = 6u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[1].nameOffset = 6u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[0].nameOffset = 1u; pSubmeshes[0].nameLength = 0xFFFFFFFFu; })));
+		// Shorter is fine, it just names a different slice
+		const std::vector<std::byte> renamed = Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[0].nameOffset = 1u; pSubmeshes[0].nameLength = 3u; });
+		CHECK(!ParseThrows(renamed) && MeshView::Parse(renamed).GetSubmeshName(0u) == "ric");
+		// Submesh ranges past the index blob
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[1].indexCount = 7u; })));
+		CHECK(ParseThrows(Patch(image, [](MeshFileHeader&, MeshSubmesh* pSubmeshes) { pSubmeshes[1].indexStart = 0xFFFFFFFFu; })));
+
+		// Index values aren't part of Parse(), ValidateIndices() catches them
+		std::vector<std::byte> badIndex = image;
+		const std::uint32_t outOfRange = 8u;
+		MeshFileHeader header;
+		std::memcpy(&header, image.data(), sizeof(header));
+		std::memcpy(badIndex.data() + header.indexOffset + 11u * sizeof(std::uint32_t), &outOfRange, sizeof(outOfRange));
+		CHECK(!ParseThrows(badIndex) && !MeshView::Parse(badIndex).ValidateIndices());
+	}
+
+	bool NearlyEqual(const float* pA, std::initializer_list<float> b)
+	{
+		bool equal = true;
+		for (const float value : b)
+		{
+			equal &= std::abs(*pA++ - value) < 1e-5f;
+		}
+		return equal;
+	}
+
+	bool ObjThrows(std::string_view text)
+	{
+		try
+		{
+			ParseObj(text);
+		}
+		catch (const MeshFile::Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void TestObj()
+	{
+		// Negative indices count back from the latest element at the point of the face, not the end of the file
+		const MeshData relative = ParseObj(
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+			"vt 0 0\nvt 1 0\nvt 0 1\n"
+			"vn 0 0 1\n"
+			"f -3/-3/-1 -2/-2/-1 -1/-1/-1\n"
+			"v 5 5 5\n"
+			"f -4/1/1 -3/2/1 -2/3/1\n"
+			"f 1/1/1 2/2/1 -1/3/1\n");
+		CHECK(relative.vertices.size() == 4u && relative.indices.size() == 9u);
+		// The second face is the first one again, welded onto the same vertices
+		CHECK(relative.indices[3] == 0u && relative.indices[4] == 1u && relative.indices[5] == 2u);
+		CHECK(NearlyEqual(relative.vertices[relative.indices[8]].position, { 5.0f, 5.0f, 5.0f }));
+		// UVs flipped to a top-left origin
+		CHECK(NearlyEqual(relative.vertices[2].uv, { 0.0f, 0.0f }) && NearlyEqual(relative.vertices[0].uv, { 0.0f, 1.0f }));
+		CHECK(ObjThrows("v 0 0 0\nv 1 0 0\nf -1 -2 -3\n") && ObjThrows("v 0 0 0\nf 1 0 1\n") && ObjThrows("v 0 0 0\nf 1 1 2\n"));
+
+		// v//n: normal without a uv
+		const MeshData noUv = ParseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 -1\nvn 0 1 0\nf 1//1 2//1 3//2\n");
+		CHECK(noUv.vertices.size() == 3u);
+		CHECK(NearlyEqual(noUv.vertices[0].normal, { 0.0f, 0.0f, -1.0f }) && NearlyEqual(noUv.vertices[2].normal, { 0.0f, 1.0f, 0.0f }));
+		CHECK(NearlyEqual(noUv.vertices[0].uv, { 0.0f, 0.0f }));
+		// v/t with no normal, and a uv with only u
+		const MeshData noNormal = ParseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0.25\nf 1/1 2/1 3/1\n");
+		CHECK(noNormal.vertices.size() == 3u && NearlyEqual(noNormal.vertices[1].uv, { 0.25f, 1.0f }));
+		CHECK(ObjThrows("v 0 0 0\nf //1 1 1\n") && ObjThrows("v 0 0 0\nvn 0 0 1\nf 1//2 1//1 1//1\n"));
+
+		// usemtl before any faces names the first submesh, and repeated ones before faces only keep the last;
+		// faces before any usemtl get an unnamed submesh
+		const MeshData materials = ParseObj(
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+			"f 1 2 3\n"
+			"usemtl unused\n"
+			"usemtl wood\n"
+			"f 2 4 3\n"
+			"f 1 2 4\n"
+			"usemtl stone tiles\n"
+			"f 1 4 3\n"
+			"usemtl trailing\n");
+		CHECK(materials.submeshes.size() == 3u);
+		if (materials.submeshes.size() == 3u)
+		{
+			CHECK(materials.submeshes[0].material.empty() && materials.submeshes[0].indexStart == 0u && materials.submeshes[0].indexCount == 3u);
+			CHECK(materials.submeshes[1].material == "wood" && materials.submeshes[1].indexStart == 3u && materials.submeshes[1].indexCount == 6u);
+			CHECK(materials.submeshes[2].material == "stone tiles" && materials.submeshes[2].indexStart == 9u && materials.submeshes[2].indexCount == 3u);
+			CHECK(NearlyEqual(materials.submeshes[2].bounds.min, { 0.0f, 0.0f, 0.0f }) && NearlyEqual(materials.submeshes[2].bounds.max, { 1.0f, 1.0f, 0.0f }));
+		}
+		const MeshData named = ParseObj("usemtl first\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl second\nf 1 2 3\n");
+		CHECK(named.submeshes.size() == 1u && named.submeshes[0].material == "second");
+
+		// No normals anywhere: generated, pointing out of the counter-clockwise front, smoothed across shared corners
+		const MeshData generated = ParseObj(
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+			"v 0 0 -1\n"
+			"f 1 2 3 4\n"
+			"f 1 5 2\n");
+		CHECK(generated.vertices.size() == 5u && generated.indices.size() == 9u);
+		CHECK(NearlyEqual(generated.vertices[2].normal, { 0.0f, 0.0f, 1.0f }) && NearlyEqual(generated.vertices[3].normal, { 0.0f, 0.0f, 1.0f }));
+		CHECK(NearlyEqual(generated.vertices[4].normal, { 0.0f, -1.0f, 0.0f }));
+		// Corners shared with the side face get the area-weighted average: quad (area 1) + triangle (area 0.5)
+		const float length = std::sqrt(1.0f + 0.25f);
+		CHECK(NearlyEqual(generated.vertices[0].normal, { 0.0f, -0.5f / length, 1.0f / length }));
+
+		// Malformed input reports the line
+		bool reportsLine = false;
+		try
+		{
+			ParseObj("v 0 0 0\n# comment\nv 1 2\n");
+		}
+		catch (const MeshFile::Exception& e)
+		{
+			reportsLine = e.GetNote().find("line 3") != std::string::npos;
+		}
+		CHECK(reportsLine && ObjThrows("v 0 0 0\nv 1 1 1\nf 1 2\n"));
+
+		// And what comes out of the importer survives the file format
+		const std::vector<std::byte> image = MeshFile::Serialize(materials);
+		CHECK(SameAs(MeshView::Parse(image), materials));
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "MeshFileTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	TestRoundTrip(directory);
+	TestParseRejects();
+	TestObj();
+	std::filesystem::remove_all(directory);
+	return Test::Finish("MeshFileTest");
+}
@@ -0,0 +1,324 @@
+// PipelineCache: key normalization, one compile per state however many threads ask, remembered failures,
+// and the disk cache (round trip, compiler version change, corrupt or truncated files, concurrent saves).
+// Build as a console program together with src/PipelineCache.cpp, src/ThreadPool.cpp, src/MappedFile.cpp
+// and src/EggCeption.cpp.
+//
+//   PipelineCacheTest
+
+#include "../src/PipelineCache.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	PipelineDesc MakeDesc(int i)
+	{
+		PipelineDesc desc;
+		desc.rootSignature = 7u;
+		desc.vertexShader = 100u + i;
+		desc.pixelShader = 200u + i;
+		desc.inputLayout = { { "POSITION", 0u, VertexFormat::Float3, 0u, 0u }, { "TEXCOORD", 0u, VertexFormat::Float2, 0u, 12u } };
+		return desc;
+	}
+
+	std::vector<PipelineDesc> MakeDescs(int count)
+	{
+		std::vector<PipelineDesc> descs;
+		for (int i = 0; i < count; i++)
+		{
+			descs.push_back(MakeDesc(i));
+		}
+		return descs;
+	}
+
+	void TestNormalize()
+	{
+		const PipelineDesc a = MakeDesc(0);
+		// Layout order, semantic case, disabled blend state, unused render targets and shader stages don't matter
+		PipelineDesc b = a;
+		std::swap(b.inputLayout[0], b.inputLayout[1]);
+		b.inputLayout[0].semantic = "texcoord";
+		b.blend[0].src = BlendFactor::SrcAlpha;
+		b.blend[3].enable = true;
+		b.computeShader = 5u;
+		CHECK(PipelineCache::ComputeKey(a) == PipelineCache::ComputeKey(b));
+		// Without a depth buffer the depth state is ignored
+		PipelineDesc noDepth = a;
+		noDepth.depthFormat = PixelFormat::Unknown;
+		PipelineDesc noDepthGreater = noDepth;
+		noDepthGreater.depthFunc = CompareFunc::Greater;
+		CHECK(PipelineCache::ComputeKey(noDepth) == PipelineCache::ComputeKey(noDepthGreater));
+		CHECK(PipelineCache::ComputeKey(a) != PipelineCache::ComputeKey(noDepth));
+		PipelineDesc blended = a;
+		blended.blend[0].enable = true;
+		blended.blend[0].src = BlendFactor::SrcAlpha;
+		CHECK(PipelineCache::ComputeKey(a) != PipelineCache::ComputeKey(blended));
+		// Compute pipelines only care about the compute shader and root signature
+		PipelineDesc compute;
+		compute.kind = PipelineKind::Compute;
+		compute.computeShader = 9u;
+		compute.rootSignature = 7u;
+		PipelineDesc computeWithJunk = a;
+		computeWithJunk.kind = PipelineKind::Compute;
+		computeWithJunk.computeShader = 9u;
+		CHECK(PipelineCache::ComputeKey(compute) == PipelineCache::ComputeKey(computeWithJunk));
+	}
+
+	void TestConcurrentGet(ThreadPool& pool)
+	{
+		NullPipelineCompiler compiler(20ms);
+		PipelineCache cache(compiler, pool);
+		const PipelineDesc desc = MakeDesc(0);
+		// Equivalent descriptions from different threads all wait on the same compile
+		PipelineDesc reordered = desc;
+		std::swap(reordered.inputLayout[0], reordered.inputLayout[1]);
+		std::vector<PipelineId> results(8u);
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0u; t < results.size(); t++)
+		{
+			threads.emplace_back([&, t] { results[t] = cache.Get(t % 2u ? reordered : desc); });
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		CHECK(compiler.GetCompileCount() == 1u);
+		CHECK(std::all_of(results.begin(), results.end(), [&](PipelineId id) { return id == results[0] && id != 0u; }));
+		const PipelineCache::Stats stats = cache.GetStats();
+		CHECK(stats.requests == 8u && stats.compiles == 1u && stats.waits + stats.hits == 7u);
+
+		// Mixed Get / TryGet / Precompile from many threads still compiles each state once
+		NullPipelineCompiler slowCompiler(200us);
+		PipelineCache mixed(slowCompiler, pool);
+		const std::vector<PipelineDesc> descs = MakeDescs(40);
+		threads.clear();
+		for (int t = 0; t < 8; t++)
+		{
+			threads.emplace_back([&, t]
+			{
+				for (int r = 0; r < 200; r++)
+				{
+					const int i = (r * 7 + t) % 40;
+					PipelineId id;
+					if (r % 3 == 0)
+					{
+						mixed.TryGet(descs[i], id);
+					}
+					else if (r % 5 == 0)
+					{
+						mixed.Precompile(std::span(descs).subspan(i, 1));
+					}
+					else
+					{
+						mixed.Get(descs[i]);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		mixed.WaitForPrecompiles();
+		CHECK(slowCompiler.GetCompileCount() == 40u);
+	}
+
+	void TestFailures(ThreadPool& pool)
+	{
+		NullPipelineCompiler compiler;
+		PipelineCache cache(compiler, pool);
+		PipelineDesc broken = MakeDesc(0);
+		broken.vertexShader = 0u;
+		int throws = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			try
+			{
+				cache.Get(broken);
+			}
+			catch (const PipelineCache::Exception&)
+			{
+				throws++;
+			}
+		}
+		// Compiled (and failed) once, then the same error for every caller
+		PipelineId id = 0u;
+		bool tryGetThrew = false;
+		try
+		{
+			cache.TryGet(broken, id);
+		}
+		catch (const PipelineCache::Exception&)
+		{
+			tryGetThrew = true;
+		}
+		CHECK(throws == 3 && tryGetThrew);
+		CHECK(compiler.GetCompileCount() == 0u && cache.GetStats().failures == 1u);
+		// Other states are unaffected
+		CHECK(cache.Get(MakeDesc(1)) != 0u);
+	}
+
+	void TestDiskCache(ThreadPool& pool, const std::string& path)
+	{
+		const std::vector<PipelineDesc> descs = MakeDescs(40);
+		PipelineDesc broken = MakeDesc(99);
+		broken.vertexShader = 0u;
+		{
+			NullPipelineCompiler compiler;
+			PipelineCache cache(compiler, pool, path);
+			CHECK(cache.GetStats().recorded == 0u && !cache.GetStats().cacheFileRejected);
+			for (const PipelineDesc& desc : descs)
+			{
+				cache.Get(desc);
+			}
+			// Failed states aren't written
+			try
+			{
+				cache.Get(broken);
+			}
+			catch (const PipelineCache::Exception&)
+			{
+			}
+			CHECK(cache.Save());
+		}
+		// Next session: everything comes back and warms up from the blobs without a full compile
+		{
+			NullPipelineCompiler compiler;
+			PipelineCache cache(compiler, pool, path);
+			CHECK(cache.GetStats().recorded == 40u);
+			cache.PrecompileRecorded();
+			cache.WaitForPrecompiles();
+			CHECK(compiler.GetCompileCount() == 0u && compiler.GetBlobLoadCount() == 40u);
+			for (const PipelineDesc& desc : descs)
+			{
+				cache.Get(desc);
+			}
+			CHECK(cache.GetStats().hits == 40u && cache.GetStats().blobCompiles == 40u);
+		}
+		// Recorded states not used this session survive the next save
+		{
+			NullPipelineCompiler compiler;
+			{
+				PipelineCache cache(compiler, pool, path);
+				cache.Get(descs[0]);
+				CHECK(cache.Save());
+			}
+			PipelineCache cache(compiler, pool, path);
+			CHECK(cache.GetStats().recorded == 40u);
+		}
+		// A compiler update invalidates the whole file, and the next save replaces it
+		{
+			NullPipelineCompiler compiler(0us, 2u);
+			{
+				PipelineCache cache(compiler, pool, path);
+				CHECK(cache.GetStats().cacheFileRejected && cache.GetStats().recorded == 0u);
+				cache.Get(descs[0]);
+				CHECK(cache.Save());
+			}
+			PipelineCache cache(compiler, pool, path);
+			CHECK(!cache.GetStats().cacheFileRejected && cache.GetStats().recorded == 1u);
+		}
+	}
+
+	void TestCorruptFiles(ThreadPool& pool, const std::string& path)
+	{
+		// The file TestDiskCache left behind was written by compiler version 2
+		const std::uint64_t version = 2u;
+		{
+			NullPipelineCompiler compiler(0us, version);
+			PipelineCache cache(compiler, pool, path);
+			CHECK(!cache.GetStats().cacheFileRejected && cache.GetStats().recorded == 1u);
+		}
+		const std::uintmax_t size = std::filesystem::file_size(path);
+		const std::string copy = path + ".bad";
+		// One flipped byte anywhere: header fields, payload, last byte
+		for (const std::uintmax_t position : { std::uintmax_t(0u), std::uintmax_t(10u), std::uintmax_t(50u), size / 2u, size - 1u })
+		{
+			std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+			{
+				std::fstream file(copy, std::ios::in | std::ios::out | std::ios::binary);
+				file.seekg(static_cast<std::streamoff>(position));
+				char c = 0;
+				file.read(&c, 1);
+				c ^= 0x5A;
+				file.seekp(static_cast<std::streamoff>(position));
+				file.write(&c, 1);
+			}
+			NullPipelineCompiler compiler(0us, version);
+			PipelineCache cache(compiler, pool, copy);
+			CHECK(cache.GetStats().cacheFileRejected && cache.GetStats().recorded == 0u);
+			// Still usable, it just starts cold
+			CHECK(cache.Get(MakeDesc(0)) != 0u && compiler.GetCompileCount() == 1u);
+		}
+		// Cut short in the payload, in the header, and down to nothing
+		for (const std::uintmax_t newSize : { size - 3u, std::uintmax_t(5u), std::uintmax_t(0u) })
+		{
+			std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+			std::filesystem::resize_file(copy, newSize);
+			NullPipelineCompiler compiler(0us, version);
+			PipelineCache cache(compiler, pool, copy);
+			CHECK(cache.GetStats().cacheFileRejected && cache.GetStats().recorded == 0u);
+		}
+		std::filesystem::remove(copy);
+	}
+
+	// Several caches saving the same file at once each write their own temp file, so whichever rename lands last
+	// leaves a complete file behind
+	void TestConcurrentSaves(ThreadPool& pool, const std::string& path)
+	{
+		const std::vector<PipelineDesc> descs = MakeDescs(200);
+		for (int round = 0; round < 10; round++)
+		{
+			std::vector<std::thread> savers;
+			for (int t = 0; t < 4; t++)
+			{
+				savers.emplace_back([&, t]
+				{
+					NullPipelineCompiler compiler;
+					PipelineCache saver(compiler, pool, path);
+					for (int i = 0; i < 50 * (t + 1); i++)
+					{
+						saver.Get(descs[i]);
+					}
+					saver.Save();
+				});
+			}
+			for (auto& thread : savers)
+			{
+				thread.join();
+			}
+			NullPipelineCompiler compiler;
+			PipelineCache cache(compiler, pool, path);
+			CHECK(!cache.GetStats().cacheFileRejected && cache.GetStats().recorded >= 50u);
+		}
+		// No temp files left behind
+		std::size_t files = 0u;
+		for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(path).parent_path()))
+		{
+			files++;
+		}
+		CHECK(files == 1u);
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "PipelineCacheTest";
+	std::filesystem::remove_all(directory);
+	const std::string path = (directory / "pso.cache").string();
+	ThreadPool pool(4u);
+	TestNormalize();
+	TestConcurrentGet(pool);
+	TestFailures(pool);
+	TestDiskCache(pool, path);
+	TestCorruptFiles(pool, path);
+	TestConcurrentSaves(pool, path);
+	std::filesystem::remove_all(directory);
+	return Test::Finish("PipelineCacheTest");
+}
@@ -0,0 +1,390 @@
+// SimdMath accuracy against scalar / double precision references, plus throughput.
+// Header only, so build this file on its own as a console program, e.g.
+//   cl /std:c++latest /O2 /arch:AVX SimdMathTest.cpp      g++ -std=c++20 -O2 -mavx SimdMathTest.cpp
+// Add SIMDMATH_FORCE_SCALAR to check the scalar path.
+//
+//   SimdMathTest [--bench]
+
+#include "../src/SimdMath.h"
+#include "TestCommon.h"
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// The constexpr paths have to agree with the runtime ones
+	constexpr Mat4 constantProduct = Mat4::Translation(1.0f, 2.0f, 3.0f) * Mat4::Scaling(2.0f, 2.0f, 2.0f);
+	static_assert(constantProduct.m[3][0] == 2.0f && constantProduct.m[3][2] == 6.0f);
+	static_assert([] { Mat4 inverse; return constantProduct.Inverse(inverse) && inverse.m[0][0] == 0.5f && inverse.m[3][1] == -2.0f; }());
+
+	Mat4 RandomMatrix(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+		Mat4 r;
+		for (auto& row : r.m)
+		{
+			for (float& v : row)
+			{
+				v = dist(rng);
+			}
+		}
+		return r;
+	}
+
+	Quat RandomQuat(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		return Quat(dist(rng), dist(rng), dist(rng), dist(rng)).Normalized();
+	}
+
+	// Gauss-Jordan with partial pivoting in double, as ground truth
+	bool ReferenceInverse(const Mat4& a, double (*pOut)[4])
+	{
+		double m[4][8];
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				m[i][j] = a.m[i][j];
+				m[i][j + 4] = i == j ? 1.0 : 0.0;
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			int pivot = c;
+			for (int r = c + 1; r < 4; r++)
+			{
+				if (std::fabs(m[r][c]) > std::fabs(m[pivot][c]))
+				{
+					pivot = r;
+				}
+			}
+			if (m[pivot][c] == 0.0)
+			{
+				return false;
+			}
+			std::swap(m[c], m[pivot]);
+			const double scale = 1.0 / m[c][c];
+			for (double& v : m[c])
+			{
+				v *= scale;
+			}
+			for (int r = 0; r < 4; r++)
+			{
+				if (r != c)
+				{
+					const double f = m[r][c];
+					for (int k = 0; k < 8; k++)
+					{
+						m[r][k] -= f * m[c][k];
+					}
+				}
+			}
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				pOut[i][j] = m[i][j + 4];
+			}
+		}
+		return true;
+	}
+
+	// Textbook slerp in double
+	void ReferenceSlerp(const Quat& a, const Quat& b, double t, double* pOut)
+	{
+		double dot = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z + double(a.w) * b.w;
+		const double sign = dot < 0.0 ? -1.0 : 1.0;
+		dot = std::min(1.0, dot * sign);
+		const double theta = std::acos(dot);
+		double wa = 1.0 - t;
+		double wb = t;
+		if (theta > 1e-6)
+		{
+			wa = std::sin((1.0 - t) * theta) / std::sin(theta);
+			wb = std::sin(t * theta) / std::sin(theta);
+		}
+		wb *= sign;
+		pOut[0] = a.x * wa + b.x * wb;
+		pOut[1] = a.y * wa + b.y * wb;
+		pOut[2] = a.z * wa + b.z * wb;
+		pOut[3] = a.w * wa + b.w * wb;
+	}
+
+	void TestInverse(std::mt19937& rng)
+	{
+		double worstSimd = 0.0;
+		double worstScalar = 0.0;
+		int tested = 0;
+		for (int i = 0; i < 20000; i++)
+		{
+			const Mat4 a = RandomMatrix(rng);
+			double reference[4][4];
+			// Badly conditioned matrices say more about float than about the code
+			if (std::fabs(a.Determinant()) < 0.1f || !ReferenceInverse(a, reference))
+			{
+				continue;
+			}
+			Mat4 simd;
+			Mat4 scalar;
+			CHECK(a.Inverse(simd));
+			CHECK(a.InverseScalar(scalar));
+			for (int r = 0; r < 4; r++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					const double scale = 1.0 + std::fabs(reference[r][c]);
+					worstSimd = std::max(worstSimd, std::fabs(simd.m[r][c] - reference[r][c]) / scale);
+					worstScalar = std::max(worstScalar, std::fabs(scalar.m[r][c] - reference[r][c]) / scale);
+				}
+			}
+			tested++;
+		}
+		std::printf("inverse: %d matrices, worst relative error simd %.2e scalar %.2e\n", tested, worstSimd, worstScalar);
+		CHECK(tested > 10000);
+		CHECK(worstSimd < 1e-3);
+		CHECK(worstScalar < 1e-3);
+
+		// Singular: both report failure and leave the output alone
+		Mat4 singular = Mat4::Identity();
+		singular.m[2][0] = 1.0f;
+		singular.m[2][1] = 2.0f;
+		singular.m[2][2] = 0.0f;
+		singular.m[1][2] = 0.0f;
+		singular.m[0][2] = 0.0f;
+		const Mat4 sentinel = Mat4::Translation(7.0f, 7.0f, 7.0f);
+		Mat4 out = sentinel;
+		CHECK(!singular.Inverse(out));
+		CHECK(out.m[3][0] == 7.0f);
+		CHECK(!singular.InverseScalar(out));
+		CHECK(out.m[3][0] == 7.0f);
+
+		// M * inverse(M) = I for a typical world * view * projection chain. The near/far ratio makes it badly
+		// conditioned, so each entry's error is measured against the size of the terms that were summed for it.
+		const Mat4 viewProjection = Mat4::RotationY(0.7f) * Mat4::Translation(3.0f, -2.0f, 10.0f) *
+			Mat4::LookAtLH({ 0.0f, 5.0f, -10.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }) * Mat4::PerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+		Mat4 inverse;
+		CHECK(viewProjection.Inverse(inverse));
+		const Mat4 identity = viewProjection * inverse;
+		double worstIdentity = 0.0;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				double magnitude = 0.0;
+				for (int k = 0; k < 4; k++)
+				{
+					magnitude += std::fabs(double(viewProjection.m[r][k]) * inverse.m[k][c]);
+				}
+				worstIdentity = std::max(worstIdentity, std::fabs(identity.m[r][c] - (r == c ? 1.0 : 0.0)) / std::max(magnitude, 1.0));
+			}
+		}
+		std::printf("inverse: view projection * inverse off identity by %.2e\n", worstIdentity);
+		CHECK(worstIdentity < 1e-4);
+	}
+
+	void TestMultiply(std::mt19937& rng)
+	{
+		double worst = 0.0;
+		for (int i = 0; i < 20000; i++)
+		{
+			const Mat4 a = RandomMatrix(rng);
+			const Mat4 b = RandomMatrix(rng);
+			const Mat4 simd = a * b;
+			const Mat4 scalar = a.MultiplyScalar(b);
+			for (int r = 0; r < 4; r++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					double exact = 0.0;
+					for (int k = 0; k < 4; k++)
+					{
+						exact += double(a.m[r][k]) * b.m[k][c];
+					}
+					worst = std::max({ worst, std::fabs(simd.m[r][c] - exact), std::fabs(scalar.m[r][c] - exact) });
+				}
+			}
+		}
+		std::printf("multiply: worst absolute error %.2e\n", worst);
+		CHECK(worst < 1e-5);
+		// Order: translate then rotate
+		const Vec3 p = (Mat4::Translation(1.0f, 0.0f, 0.0f) * Mat4::RotationZ(1.5707964f)).TransformPoint({ 0.0f, 0.0f, 0.0f });
+		CHECK(std::fabs(p.x) < 1e-6f && std::fabs(p.y - 1.0f) < 1e-6f);
+	}
+
+	void TestTransformBatch(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+		const Mat4 m = Mat4::RotationX(0.3f) * Mat4::Scaling(1.5f, 0.5f, 2.0f) * Mat4::Translation(1.0f, -2.0f, 3.0f);
+		// Every count up to a few AVX widths, so each tail length gets run
+		for (std::size_t count = 0u; count <= 40u; count++)
+		{
+			std::vector<float> x(count), y(count), z(count);
+			for (std::size_t i = 0u; i < count; i++)
+			{
+				x[i] = dist(rng);
+				y[i] = dist(rng);
+				z[i] = dist(rng);
+			}
+			std::vector<float> outX(count), outY(count), outZ(count);
+			TransformPointsSoA(m, x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), count);
+			bool matches = true;
+			for (std::size_t i = 0u; i < count; i++)
+			{
+				const Vec3 expected = m.TransformPoint({ x[i], y[i], z[i] });
+				matches &= std::fabs(outX[i] - expected.x) <= 1e-4f * (1.0f + std::fabs(expected.x));
+				matches &= std::fabs(outY[i] - expected.y) <= 1e-4f * (1.0f + std::fabs(expected.y));
+				matches &= std::fabs(outZ[i] - expected.z) <= 1e-4f * (1.0f + std::fabs(expected.z));
+			}
+			CHECK(matches);
+			// In place
+			TransformPointsSoA(m, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count);
+			CHECK(x == outX && y == outY && z == outZ);
+		}
+	}
+
+	void TestQuaternions(std::mt19937& rng)
+	{
+		double worstSlerp = 0.0;
+		double worstLength = 0.0;
+		double worstRotate = 0.0;
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		for (int i = 0; i < 20000; i++)
+		{
+			const Quat a = RandomQuat(rng);
+			Quat b = RandomQuat(rng);
+			// Every so often make them nearly parallel to hit the lerp fallback
+			if (i % 8 == 0)
+			{
+				b = Quat(a.x + 0.001f, a.y, a.z, a.w).Normalized();
+			}
+			const float t = unit(rng);
+			const Quat q = Quat::Slerp(a, b, t);
+			double reference[4];
+			ReferenceSlerp(a, b, t, reference);
+			worstSlerp = std::max({ worstSlerp, std::fabs(q.x - reference[0]), std::fabs(q.y - reference[1]),
+				std::fabs(q.z - reference[2]), std::fabs(q.w - reference[3]) });
+			worstLength = std::max(worstLength, std::fabs(std::sqrt(double(q.Dot(q))) - 1.0));
+			// Rotate, matrix and composition all agree
+			const Vec3 v(unit(rng), unit(rng), unit(rng));
+			const Vec3 byQuat = (a * b).Rotate(v);
+			const Vec3 byMatrix = (a.ToMatrix() * b.ToMatrix()).TransformPoint(v);
+			worstRotate = std::max({ worstRotate, double(std::fabs(byQuat.x - byMatrix.x)), double(std::fabs(byQuat.y - byMatrix.y)),
+				double(std::fabs(byQuat.z - byMatrix.z)) });
+		}
+		std::printf("slerp: worst error %.2e, worst length error %.2e, rotate vs matrix %.2e\n", worstSlerp, worstLength, worstRotate);
+		CHECK(worstSlerp < 1e-4);
+		CHECK(worstLength < 1e-5);
+		CHECK(worstRotate < 1e-5);
+
+		// End points, shortest path and a known midpoint
+		const Quat a = Quat::FromAxisAngle({ 0.0f, 0.0f, 1.0f }, 0.0f);
+		const Quat b = Quat::FromAxisAngle({ 0.0f, 0.0f, 1.0f }, 2.0f);
+		const Quat quarter = Quat::Slerp(a, b, 0.25f);
+		const Quat expected = Quat::FromAxisAngle({ 0.0f, 0.0f, 1.0f }, 0.5f);
+		CHECK(std::fabs(quarter.z - expected.z) < 1e-6f && std::fabs(quarter.w - expected.w) < 1e-6f);
+		const Quat negated(-b.x, -b.y, -b.z, -b.w);
+		const Quat viaNegated = Quat::Slerp(a, negated, 0.25f);
+		CHECK(std::fabs(std::fabs(viaNegated.Dot(quarter)) - 1.0f) < 1e-6f);
+		const Quat start = Quat::Slerp(a, b, 0.0f);
+		const Quat end = Quat::Slerp(a, b, 1.0f);
+		CHECK(std::fabs(start.Dot(a) - 1.0f) < 1e-6f && std::fabs(end.Dot(b) - 1.0f) < 1e-6f);
+	}
+
+	void Benchmark(std::mt19937& rng)
+	{
+		constexpr int matrixCount = 1 << 16;
+		std::vector<Mat4> matrices(matrixCount);
+		for (Mat4& m : matrices)
+		{
+			m = RandomMatrix(rng);
+		}
+		std::vector<Mat4> results(matrixCount);
+		float sink = 0.0f;
+		const auto perMatrix = [&](auto&& op)
+		{
+			const double ms = Test::BestOfMs(5, [&]
+			{
+				for (int i = 0; i < matrixCount; i++)
+				{
+					op(matrices[i], matrices[(i + 1) & (matrixCount - 1)], results[i]);
+				}
+				sink += results[matrixCount / 2].m[1][1];
+			});
+			return ms * 1e6 / matrixCount;
+		};
+		const double mulSimd = perMatrix([](const Mat4& a, const Mat4& b, Mat4& out) { out = a * b; });
+		const double mulScalar = perMatrix([](const Mat4& a, const Mat4& b, Mat4& out) { out = a.MultiplyScalar(b); });
+		const double invSimd = perMatrix([](const Mat4& a, const Mat4&, Mat4& out) { a.Inverse(out); });
+		const double invScalar = perMatrix([](const Mat4& a, const Mat4&, Mat4& out) { a.InverseScalar(out); });
+		std::printf("multiply  %6.2f ns  (scalar %6.2f ns)\n", mulSimd, mulScalar);
+		std::printf("inverse   %6.2f ns  (scalar %6.2f ns)\n", invSimd, invScalar);
+
+		constexpr std::size_t pointCount = 1u << 20;
+		std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+		std::vector<float> x(pointCount), y(pointCount), z(pointCount), outX(pointCount), outY(pointCount), outZ(pointCount);
+		for (std::size_t i = 0u; i < pointCount; i++)
+		{
+			x[i] = dist(rng);
+			y[i] = dist(rng);
+			z[i] = dist(rng);
+		}
+		const Mat4 m = Mat4::RotationX(0.3f) * Mat4::Translation(1.0f, 2.0f, 3.0f);
+		const double batchMs = Test::BestOfMs(5, [&]
+		{
+			TransformPointsSoA(m, x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), pointCount);
+		});
+		const double oneByOneMs = Test::BestOfMs(5, [&]
+		{
+			for (std::size_t i = 0u; i < pointCount; i++)
+			{
+				const Vec3 p = m.TransformPoint({ x[i], y[i], z[i] });
+				outX[i] = p.x;
+				outY[i] = p.y;
+				outZ[i] = p.z;
+			}
+		});
+		std::printf("transform %6.2f ms per 1M points  (one at a time %6.2f ms)\n", batchMs, oneByOneMs);
+
+		std::vector<Quat> quats(matrixCount);
+		for (Quat& q : quats)
+		{
+			q = RandomQuat(rng);
+		}
+		const double slerpMs = Test::BestOfMs(5, [&]
+		{
+			for (int i = 0; i + 1 < matrixCount; i++)
+			{
+				sink += Quat::Slerp(quats[i], quats[i + 1], 0.3f).w;
+			}
+		});
+		std::printf("slerp     %6.2f ns\n", slerpMs * 1e6 / matrixCount);
+		std::printf("(checksum %g)\n", static_cast<double>(sink + outX[pointCount / 2]));
+	}
+}
+
+int main(int argc, char** argv)
+{
+#if defined(SIMDMATH_AVX)
+	std::printf("path: SSE + AVX\n");
+#elif defined(SIMDMATH_SSE)
+	std::printf("path: SSE\n");
+#elif defined(SIMDMATH_NEON)
+	std::printf("path: NEON\n");
+#else
+	std::printf("path: scalar\n");
+#endif
+	std::mt19937 rng(1234u);
+	TestInverse(rng);
+	TestMultiply(rng);
+	TestTransformBatch(rng);
+	TestQuaternions(rng);
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark(rng);
+	}
+	return Test::Finish("SimdMathTest");
+}
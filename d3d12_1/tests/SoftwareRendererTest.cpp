@@ -0,0 +1,230 @@
+// SoftwareRenderer: closed triangle fans of both windings cover every pixel exactly once, and a small scene
+// matches the golden image in tests/golden.
+// Build as a console program together with src/SoftwareRenderer.cpp, src/Framebuffer.cpp, src/ThreadPool.cpp
+// and src/EggCeption.cpp.
+//
+//   SoftwareRendererTest [--update-golden] [--bench]
+//
+// --update-golden rewrites the reference image after an intended change in output; look at it before committing.
+
+#include "../src/SoftwareRenderer.h"
+#include "TestCommon.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr float pi = 3.14159265f;
+
+	Renderer::Vertex AtPixel(const SoftwareRenderer& renderer, float x, float y, float z, std::uint32_t colorIndex)
+	{
+		// Color channels are the triangle index, exact after packing
+		const float red = static_cast<float>(colorIndex & 0xFFu) / 255.0f;
+		const float green = static_cast<float>(colorIndex >> 8u) / 255.0f;
+		return { x / renderer.GetWidth() * 2.0f - 1.0f, 1.0f - y / renderer.GetHeight() * 2.0f, z, 1.0f, red, green, 1.0f, 1.0f };
+	}
+
+	// Renders a fan whose outer ring is well off screen, so every pixel lies inside it. Triangle i is drawn with
+	// its index as its color, nearest last (frontToBack == false) or nearest first, and a depth test that keeps
+	// the nearest: a pixel covered twice shows a different triangle in each order, one never covered shows the clear.
+	std::vector<std::uint32_t> RenderFan(SoftwareRenderer& renderer, std::mt19937& rng, bool flipWinding, bool frontToBack)
+	{
+		constexpr int ringCount = 64;
+		std::uniform_real_distribution<float> centerX(0.0f, static_cast<float>(renderer.GetWidth()));
+		std::uniform_real_distribution<float> centerY(0.0f, static_cast<float>(renderer.GetHeight()));
+		std::uniform_real_distribution<float> jitter(-0.4f, 0.4f);
+		const float cx = centerX(rng);
+		const float cy = centerY(rng);
+		const float radius = 3.0f * static_cast<float>(std::max(renderer.GetWidth(), renderer.GetHeight()));
+		float ringX[ringCount];
+		float ringY[ringCount];
+		for (int i = 0; i < ringCount; i++)
+		{
+			const float angle = (static_cast<float>(i) + jitter(rng)) * 2.0f * pi / ringCount;
+			ringX[i] = cx + radius * std::cos(angle);
+			ringY[i] = cy + radius * std::sin(angle);
+		}
+		std::vector<Renderer::Vertex> vertices;
+		for (int i = 0; i < ringCount; i++)
+		{
+			const int next = (i + 1) % ringCount;
+			const std::uint32_t colorIndex = static_cast<std::uint32_t>(i + 1);
+			const float z = frontToBack ? 0.1f + 0.01f * i : 0.9f - 0.01f * i;
+			vertices.push_back(AtPixel(renderer, cx, cy, z, colorIndex));
+			vertices.push_back(AtPixel(renderer, flipWinding ? ringX[next] : ringX[i], flipWinding ? ringY[next] : ringY[i], z, colorIndex));
+			vertices.push_back(AtPixel(renderer, flipWinding ? ringX[i] : ringX[next], flipWinding ? ringY[i] : ringY[next], z, colorIndex));
+		}
+		std::vector<std::uint32_t> indices(vertices.size());
+		for (std::uint32_t i = 0u; i < indices.size(); i++)
+		{
+			indices[i] = i;
+		}
+		renderer.BeginFrame();
+		renderer.ClearBuffer(0.0f, 0.0f, 0.0f);
+		renderer.DrawIndexed(vertices.data(), vertices.size(), indices.data(), indices.size());
+		renderer.EndFrame();
+		const Framebuffer& framebuffer = renderer.GetFramebuffer();
+		return std::vector<std::uint32_t>(framebuffer.GetColorData(), framebuffer.GetColorData() + renderer.GetWidth() * renderer.GetHeight());
+	}
+
+	void TestWatertight()
+	{
+		SoftwareRenderer renderer(512, 512);
+		std::mt19937 rng(27u);
+		const std::uint32_t clear = Framebuffer::PackColor(0.0f, 0.0f, 0.0f);
+		std::size_t uncovered = 0u;
+		std::size_t coveredTwice = 0u;
+		for (int fan = 0; fan < 300; fan++)
+		{
+			// Same fan both ways round: reseed so the second pass gets identical vertices
+			const std::uint32_t seed = rng();
+			std::mt19937 fanRng(seed);
+			const std::vector<std::uint32_t> backToFront = RenderFan(renderer, fanRng, fan % 2 == 1, false);
+			fanRng.seed(seed);
+			const std::vector<std::uint32_t> frontToBack = RenderFan(renderer, fanRng, fan % 2 == 1, true);
+			for (std::size_t i = 0u; i < backToFront.size(); i++)
+			{
+				uncovered += backToFront[i] == clear;
+				coveredTwice += backToFront[i] != frontToBack[i];
+			}
+		}
+		std::printf("300 fans: %zu pixels uncovered, %zu covered twice\n", uncovered, coveredTwice);
+		CHECK(uncovered == 0u && coveredTwice == 0u);
+	}
+
+	// Overlapping and intersecting triangles, perspective-correct color, a triangle partly off screen,
+	// one behind the camera and a degenerate one
+	void RenderScene(SoftwareRenderer& renderer)
+	{
+		const Renderer::Vertex vertices[] =
+		{
+			// Full-screen backdrop gradient, far away
+			{ -1.0f, -1.0f, 0.99f, 1.0f, 0.1f, 0.1f, 0.3f, 1.0f },
+			{ 3.0f, -1.0f, 0.99f, 1.0f, 0.1f, 0.1f, 0.3f, 1.0f },
+			{ -1.0f, 3.0f, 0.99f, 1.0f, 0.4f, 0.1f, 0.1f, 1.0f },
+			// Two triangles intersecting in depth
+			{ -0.8f, -0.6f, 0.2f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f },
+			{ 0.6f, -0.4f, 0.8f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f },
+			{ -0.2f, 0.8f, 0.5f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f },
+			{ -0.6f, 0.5f, 0.8f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f },
+			{ 0.7f, 0.6f, 0.2f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f },
+			{ 0.1f, -0.9f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+			// Receding quad with very different w per corner
+			{ -1.0f, -1.0f, 0.1f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+			{ -0.2f, -1.0f, 0.1f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+			{ -0.5f, -0.5f, 3.0f, 4.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+			{ 0.3f, -0.5f, 3.0f, 4.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+			// Mostly off the right edge
+			{ 0.9f, 0.9f, 0.05f, 1.0f, 1.0f, 0.5f, 0.0f, 1.0f },
+			{ 2.5f, 0.0f, 0.05f, 1.0f, 1.0f, 0.5f, 0.0f, 1.0f },
+			{ 0.8f, -0.2f, 0.05f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+			// Behind the camera
+			{ 0.0f, 0.0f, 0.1f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+		};
+		const std::uint32_t indices[] =
+		{
+			0u, 1u, 2u,
+			3u, 4u, 5u,
+			6u, 7u, 8u,
+			9u, 10u, 11u, 10u, 12u, 11u,
+			13u, 14u, 15u,
+			3u, 4u, 16u,
+			// Degenerate: all three on a line
+			3u, 3u, 4u,
+		};
+		renderer.BeginFrame();
+		renderer.ClearBuffer(0.0f, 0.0f, 0.0f);
+		renderer.DrawIndexed(vertices, std::size(vertices), indices, std::size(indices));
+		renderer.EndFrame();
+	}
+
+	std::vector<std::uint8_t> LoadPpm(const std::filesystem::path& path, int& width, int& height)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::string magic;
+		int maxValue = 0;
+		file >> magic >> width >> height >> maxValue;
+		file.get();
+		if (!file || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0)
+		{
+			return {};
+		}
+		std::vector<std::uint8_t> pixels(static_cast<std::size_t>(width) * height * 3u);
+		file.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+		return file ? pixels : std::vector<std::uint8_t>();
+	}
+
+	// Compilers may round interpolated colors a little differently, so allow a small per-channel difference
+	// and a handful of pixels beyond that
+	void TestGolden(bool update)
+	{
+		const std::filesystem::path golden = std::filesystem::path(__FILE__).parent_path() / "golden" / "SoftwareRendererScene.ppm";
+		SoftwareRenderer renderer(160, 120);
+		RenderScene(renderer);
+		const SoftwareRenderer::Stats stats = renderer.GetStats();
+		CHECK(stats.trianglesSubmitted == 8u && stats.trianglesRejected == 2u);
+		if (update)
+		{
+			renderer.GetFramebuffer().SavePpm(golden.string());
+			std::printf("wrote %s\n", golden.string().c_str());
+			return;
+		}
+		int width = 0;
+		int height = 0;
+		const std::vector<std::uint8_t> reference = LoadPpm(golden, width, height);
+		CHECK(!reference.empty() && width == renderer.GetWidth() && height == renderer.GetHeight());
+		if (reference.empty() || width != renderer.GetWidth() || height != renderer.GetHeight())
+		{
+			return;
+		}
+		std::size_t differing = 0u;
+		int largestDifference = 0;
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const std::uint32_t pixel = renderer.GetFramebuffer().GetPixel(x, y);
+				const std::uint8_t* pReference = &reference[(static_cast<std::size_t>(y) * width + x) * 3u];
+				int difference = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					const int channel = static_cast<int>((pixel >> (16 - 8 * c)) & 0xFFu);
+					difference = std::max(difference, std::abs(channel - pReference[c]));
+				}
+				differing += difference > 2;
+				largestDifference = std::max(largestDifference, difference);
+			}
+		}
+		if (differing > 8u)
+		{
+			const std::filesystem::path actual = std::filesystem::temp_directory_path() / "SoftwareRendererScene.ppm";
+			renderer.GetFramebuffer().SavePpm(actual.string());
+			std::printf("%zu pixels differ from the golden image (largest difference %d), see %s\n", differing, largestDifference, actual.string().c_str());
+		}
+		CHECK(differing <= 8u);
+	}
+
+	void Benchmark()
+	{
+		SoftwareRenderer renderer(1920, 1080);
+		std::mt19937 rng(5u);
+		const double fanMs = Test::BestOfMs(10, [&] { RenderFan(renderer, rng, false, false); });
+		std::printf("1080p frame of a 64 triangle full-screen fan: %.2f ms\n", fanMs);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TestWatertight();
+	TestGolden(Test::HasFlag(argc, argv, "--update-golden"));
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark();
+	}
+	return Test::Finish("SoftwareRendererTest");
+}
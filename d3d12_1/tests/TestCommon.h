@@ -0,0 +1,58 @@
+#pragma once
+
+// Bits shared by the standalone test programs in this folder.
+// Each program checks its module against a reference and returns non-zero
+// on any failure; pass --bench to also print timings.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+
+namespace Test
+{
+	inline int failures = 0;
+
+	inline void Check(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed)
+		{
+			failures++;
+			std::printf("FAILED %s(%d): %s\n", file, line, expression);
+		}
+	}
+
+	inline bool HasFlag(int argc, char** argv, std::string_view flag)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (flag == argv[i])
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Best of several runs, which is steadier than the mean on a busy machine
+	template<typename F>
+	double BestOfMs(int runs, F&& f)
+	{
+		double best = 1e30;
+		for (int i = 0; i < runs; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	inline int Finish(const char* name)
+	{
+		std::printf("%s: %s (%d failed)\n", name, failures == 0 ? "passed" : "FAILED", failures);
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(expression) Test::Check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
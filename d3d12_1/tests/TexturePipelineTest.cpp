@@ -0,0 +1,418 @@
+// TexturePipeline and the BC1/BC3 encoders: encode -> decode error bounds (with BC1 punch-through alpha),
+// decoding BMP/ICO/PPM including src/derp.ico, mip chain layout and filtering of odd sizes, and the disk cache
+// (a miss then an identical hit, corrupt or truncated .etex files treated as misses).
+// Build as a console program together with src/TexturePipeline.cpp, src/BlockCompression.cpp,
+// src/ThreadPool.cpp, src/MappedFile.cpp and src/EggCeption.cpp.
+//
+//   TexturePipelineTest
+
+#include "../src/TexturePipeline.h"
+#include "../src/BlockCompression.h"
+#include "TestCommon.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct BlockError
+	{
+		int maxColor = 0;		// largest per-channel error over opaque pixels
+		double rmsColor = 0.0;
+		int maxAlpha = 0;
+	};
+
+	BlockError Compare(const std::uint8_t* pExpected, const std::uint8_t* pDecoded, bool punchThrough)
+	{
+		BlockError error;
+		double sum = 0.0;
+		int count = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			const std::uint8_t* pE = pExpected + i * 4;
+			const std::uint8_t* pD = pDecoded + i * 4;
+			// Punch-through pixels only have to come back transparent, their color is black
+			if (punchThrough && pE[3] < 128u)
+			{
+				error.maxAlpha = std::max(error.maxAlpha, static_cast<int>(pD[3]));
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				const int d = std::abs(pE[k] - pD[k]);
+				error.maxColor = std::max(error.maxColor, d);
+				sum += d * d;
+				count++;
+			}
+			error.maxAlpha = std::max(error.maxAlpha, std::abs((punchThrough ? 255 : pE[3]) - pD[3]));
+		}
+		error.rmsColor = count > 0 ? std::sqrt(sum / count) : 0.0;
+		return error;
+	}
+
+	// Smooth gradients, flat colors and two-color blocks are what the encoders are tuned for
+	void MakeBlock(std::mt19937& rng, int kind, std::uint8_t* pRgba)
+	{
+		std::uniform_int_distribution<int> byte(0, 255);
+		int a[4], b[4];
+		for (int k = 0; k < 4; k++)
+		{
+			a[k] = byte(rng);
+			b[k] = kind == 0 ? a[k] : byte(rng);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			// Gradient along x + y, or two colors split down the middle
+			const float t = kind == 2 ? (i % 4 < 2 ? 0.0f : 1.0f) : static_cast<float>(i % 4 + i / 4) / 6.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				pRgba[i * 4 + k] = static_cast<std::uint8_t>(std::lround(a[k] + (b[k] - a[k]) * t));
+			}
+		}
+	}
+
+	void TestBlockCompression()
+	{
+		std::mt19937 rng(37u);
+		BlockError worstBc1[3];
+		BlockError worstBc3[3];
+		double rmsBc1 = 0.0;
+		double rmsBc3 = 0.0;
+		constexpr int blocksPerKind = 2000;
+		for (int kind = 0; kind < 3; kind++)
+		{
+			for (int n = 0; n < blocksPerKind; n++)
+			{
+				std::uint8_t source[64];
+				std::uint8_t opaque[64];
+				std::uint8_t block[16];
+				std::uint8_t decoded[64];
+				MakeBlock(rng, kind, source);
+				std::memcpy(opaque, source, sizeof(opaque));
+				for (int i = 0; i < 16; i++)
+				{
+					opaque[i * 4 + 3] = 255u;
+				}
+				EncodeBc1Block(opaque, block);
+				DecodeBc1Block(block, decoded);
+				BlockError e = Compare(opaque, decoded, false);
+				worstBc1[kind].maxColor = std::max(worstBc1[kind].maxColor, e.maxColor);
+				worstBc1[kind].maxAlpha = std::max(worstBc1[kind].maxAlpha, e.maxAlpha);
+				rmsBc1 += e.rmsColor * e.rmsColor;
+				EncodeBc3Block(source, block);
+				DecodeBc3Block(block, decoded);
+				e = Compare(source, decoded, false);
+				worstBc3[kind].maxColor = std::max(worstBc3[kind].maxColor, e.maxColor);
+				worstBc3[kind].maxAlpha = std::max(worstBc3[kind].maxAlpha, e.maxAlpha);
+				rmsBc3 += e.rmsColor * e.rmsColor;
+			}
+		}
+		rmsBc1 = std::sqrt(rmsBc1 / (3 * blocksPerKind));
+		rmsBc3 = std::sqrt(rmsBc3 / (3 * blocksPerKind));
+		std::printf("BC1 max error flat/gradient/split %d/%d/%d, rms %.2f; BC3 %d/%d/%d, rms %.2f, alpha max %d/%d/%d\n",
+			worstBc1[0].maxColor, worstBc1[1].maxColor, worstBc1[2].maxColor, rmsBc1,
+			worstBc3[0].maxColor, worstBc3[1].maxColor, worstBc3[2].maxColor, rmsBc3,
+			worstBc3[0].maxAlpha, worstBc3[1].maxAlpha, worstBc3[2].maxAlpha);
+		// Flat blocks only lose the 5:6:5 rounding, gradients and two-color blocks land on or between endpoints
+		CHECK(worstBc1[0].maxColor <= 4 && worstBc3[0].maxColor <= 4);
+		CHECK(worstBc1[1].maxColor <= 40 && worstBc3[1].maxColor <= 40);
+		CHECK(worstBc1[2].maxColor <= 24 && worstBc3[2].maxColor <= 24);
+		CHECK(rmsBc1 <= 8.0 && rmsBc3 <= 8.0);
+		CHECK(worstBc1[0].maxAlpha == 0 && worstBc1[1].maxAlpha == 0);
+		// BC3 alpha: flat exact, otherwise within half a step of its 8-level ramp
+		CHECK(worstBc3[0].maxAlpha == 0 && worstBc3[1].maxAlpha <= 19 && worstBc3[2].maxAlpha <= 1);
+
+		// BC1 punch-through: alpha < 128 comes back fully transparent, the rest opaque
+		std::uint8_t source[64];
+		std::uint8_t block[8];
+		std::uint8_t decoded[64];
+		int worstPunchThrough = 0;
+		int worstPunchThroughColor = 0;
+		for (int n = 0; n < 1000; n++)
+		{
+			MakeBlock(rng, 1, source);
+			for (int i = 0; i < 16; i++)
+			{
+				source[i * 4 + 3] = (i * 7 + n) % 5 == 0 ? 0u : 255u;
+			}
+			EncodeBc1Block(source, block, true);
+			DecodeBc1Block(block, decoded);
+			const BlockError e = Compare(source, decoded, true);
+			worstPunchThrough = std::max(worstPunchThrough, e.maxAlpha);
+			worstPunchThroughColor = std::max(worstPunchThroughColor, e.maxColor);
+		}
+		std::printf("BC1 punch-through max error %d\n", worstPunchThroughColor);
+		// Only 3 colors left once one index means transparent
+		CHECK(worstPunchThrough == 0 && worstPunchThroughColor <= 48);
+		// Without allowAlpha the block stays opaque
+		EncodeBc1Block(source, block, false);
+		DecodeBc1Block(block, decoded);
+		bool allOpaque = true;
+		for (int i = 0; i < 16; i++)
+		{
+			allOpaque &= decoded[i * 4 + 3] == 255u;
+		}
+		CHECK(allOpaque);
+	}
+
+	std::vector<std::byte> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<char> chars((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		std::vector<std::byte> bytes(chars.size());
+		std::memcpy(bytes.data(), chars.data(), chars.size());
+		return bytes;
+	}
+
+	void Put32(std::vector<std::byte>& bytes, std::size_t offset, std::uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			bytes[offset + i] = static_cast<std::byte>(value >> (8 * i));
+		}
+	}
+
+	// 2x1 32bpp BI_BITFIELDS BMP with a V4-sized header (108 bytes) holding the given masks
+	std::vector<std::byte> MakeBitfieldsBmp(std::uint32_t redMask, std::uint32_t greenMask, std::uint32_t blueMask, std::uint32_t alphaMask)
+	{
+		std::vector<std::byte> bmp(14u + 108u + 8u);
+		bmp[0] = std::byte{ 'B' };
+		bmp[1] = std::byte{ 'M' };
+		Put32(bmp, 2u, static_cast<std::uint32_t>(bmp.size()));
+		Put32(bmp, 10u, 14u + 108u);
+		Put32(bmp, 14u, 108u);
+		Put32(bmp, 18u, 2u);
+		Put32(bmp, 22u, 1u);
+		Put32(bmp, 26u, 1u | 32u << 16);
+		Put32(bmp, 30u, 3u);
+		Put32(bmp, 54u, redMask);
+		Put32(bmp, 58u, greenMask);
+		Put32(bmp, 62u, blueMask);
+		Put32(bmp, 66u, alphaMask);
+		// B, G, R, A
+		Put32(bmp, 122u, 0x80102030u);
+		Put32(bmp, 126u, 0x40506070u);
+		return bmp;
+	}
+
+	bool DecodeThrows(std::span<const std::byte> bytes)
+	{
+		try
+		{
+			TexturePipeline::Decode(bytes);
+		}
+		catch (const TexturePipeline::Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void TestDecode()
+	{
+		// 16x16 4bpp icon with an AND mask
+		const std::filesystem::path icoPath = std::filesystem::path(__FILE__).parent_path() / ".." / "src" / "derp.ico";
+		const Image ico = TexturePipeline::DecodeFile(icoPath.string());
+		CHECK(ico.width == 16u && ico.height == 16u && ico.rgba.size() == 16u * 16u * 4u);
+		std::size_t transparent = 0u;
+		std::size_t opaque = 0u;
+		for (std::size_t i = 3u; i < ico.rgba.size(); i += 4u)
+		{
+			transparent += ico.rgba[i] == 0u;
+			opaque += ico.rgba[i] == 255u;
+		}
+		CHECK(transparent > 0u && opaque > 0u && transparent + opaque == 256u);
+		// Same thing from memory
+		const std::vector<std::byte> icoBytes = ReadFile(icoPath);
+		CHECK(TexturePipeline::Decode(icoBytes).rgba == ico.rgba);
+		// Cut short anywhere, it's an error rather than a crash
+		bool truncatedThrows = true;
+		for (std::size_t size = 0u; size < icoBytes.size(); size += 7u)
+		{
+			truncatedThrows &= DecodeThrows(std::span(icoBytes).first(size));
+		}
+		CHECK(truncatedThrows);
+
+		// BI_BITFIELDS: BGRA masks decode, anything else is refused
+		const Image bgra = TexturePipeline::Decode(MakeBitfieldsBmp(0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0xFF000000u));
+		CHECK(bgra.width == 2u && bgra.height == 1u);
+		CHECK(bgra.rgba == std::vector<std::uint8_t>({ 0x10, 0x20, 0x30, 0x80, 0x50, 0x60, 0x70, 0x40 }));
+		// No alpha mask: the 4th byte is padding
+		const Image noAlpha = TexturePipeline::Decode(MakeBitfieldsBmp(0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0u));
+		CHECK(noAlpha.rgba[3] == 255u && noAlpha.rgba[7] == 255u);
+		CHECK(DecodeThrows(MakeBitfieldsBmp(0x000000FFu, 0x0000FF00u, 0x00FF0000u, 0xFF000000u)));
+		CHECK(DecodeThrows(MakeBitfieldsBmp(0x0000F800u, 0x000007E0u, 0x0000001Fu, 0u)));
+		CHECK(DecodeThrows(MakeBitfieldsBmp(0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0x000000FFu)));
+	}
+
+	Image MakeImage(std::uint32_t width, std::uint32_t height, std::mt19937& rng)
+	{
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.rgba.resize(static_cast<std::size_t>(width) * height * 4u);
+		for (std::uint8_t& value : image.rgba)
+		{
+			value = static_cast<std::uint8_t>(rng());
+		}
+		return image;
+	}
+
+	void TestMips(ThreadPool& pool)
+	{
+		TexturePipeline pipeline(pool);
+		std::mt19937 rng(7u);
+		// Every level halves, rounding down, until 1x1
+		const Texture rgba = pipeline.Build(MakeImage(100u, 40u, rng), { TextureFormat::RGBA8, true, true });
+		const std::uint32_t expected[][2] = { { 100u, 40u }, { 50u, 20u }, { 25u, 10u }, { 12u, 5u }, { 6u, 2u }, { 3u, 1u }, { 1u, 1u } };
+		CHECK(rgba.mips.size() == std::size(expected));
+		std::uint64_t offset = 0u;
+		for (std::size_t level = 0u; level < rgba.mips.size() && level < std::size(expected); level++)
+		{
+			const Texture::Mip& mip = rgba.mips[level];
+			CHECK(mip.width == expected[level][0] && mip.height == expected[level][1]);
+			CHECK(mip.rowPitch == mip.width * 4u && mip.rowCount == mip.height && mip.offset == offset && mip.size == mip.rowPitch * mip.rowCount);
+			offset += mip.size;
+		}
+		CHECK(rgba.data.size() == offset);
+		// Block compressed: pitch and row count are in 4x4 blocks, with partial blocks at the small end
+		const Texture bc1 = pipeline.Build(MakeImage(64u, 32u, rng), { TextureFormat::BC1, true, true });
+		CHECK(bc1.mips.size() == 7u && bc1.mips[0].rowPitch == 16u * bc1BlockSize && bc1.mips[0].rowCount == 8u);
+		CHECK(bc1.mips[5].width == 2u && bc1.mips[5].height == 1u && bc1.mips[5].rowPitch == bc1BlockSize && bc1.mips[5].size == bc1BlockSize);
+		const Texture bc3 = pipeline.Build(MakeImage(64u, 32u, rng), { TextureFormat::BC3, true, false });
+		CHECK(bc3.mips.size() == 1u && bc3.data.size() == 16u * 8u * bc3BlockSize);
+
+		// Odd sizes: 5 -> 2 still takes in the last column, weighted by how much of it each output pixel covers
+		Image edge;
+		edge.width = 5u;
+		edge.height = 1u;
+		edge.rgba.assign(20u, 0u);
+		for (int k = 0; k < 4; k++)
+		{
+			edge.rgba[16 + k] = 250u;
+		}
+		const Texture edgeTexture = pipeline.Build(edge, { TextureFormat::RGBA8, false, true });
+		const std::uint8_t* pMip1 = edgeTexture.data.data() + edgeTexture.mips[1].offset;
+		CHECK(edgeTexture.mips[1].width == 2u && pMip1[0] == 0u && pMip1[4] == 100u && pMip1[7] == 100u);
+		// 1x1 is the average of the whole 5 wide image
+		CHECK(edgeTexture.data[edgeTexture.mips[2].offset] == 50u);
+
+		// And so each level keeps the image's average, odd or even (not in sRGB, which averages in linear light).
+		// A ramp brightest at the right and bottom edges shows any row or column that gets dropped.
+		Image odd;
+		odd.width = 45u;
+		odd.height = 27u;
+		for (std::uint32_t y = 0u; y < odd.height; y++)
+		{
+			for (std::uint32_t x = 0u; x < odd.width; x++)
+			{
+				odd.rgba.push_back(static_cast<std::uint8_t>(x * 255u / (odd.width - 1u)));
+				odd.rgba.push_back(static_cast<std::uint8_t>(y * 255u / (odd.height - 1u)));
+				odd.rgba.push_back(static_cast<std::uint8_t>((x + y) * 255u / (odd.width + odd.height - 2u)));
+				odd.rgba.push_back(255u);
+			}
+		}
+		const Texture oddTexture = pipeline.Build(odd, { TextureFormat::RGBA8, false, true });
+		double sourceMean = 0.0;
+		for (const std::uint8_t value : odd.rgba)
+		{
+			sourceMean += value;
+		}
+		sourceMean /= static_cast<double>(odd.rgba.size());
+		bool meansMatch = true;
+		for (const Texture::Mip& mip : oddTexture.mips)
+		{
+			double mean = 0.0;
+			for (std::uint64_t i = 0u; i < mip.size; i++)
+			{
+				mean += oddTexture.data[mip.offset + i];
+			}
+			mean /= static_cast<double>(mip.size);
+			meansMatch &= std::abs(mean - sourceMean) < 1.0;
+		}
+		CHECK(meansMatch);
+	}
+
+	void TestCache(ThreadPool& pool, const std::filesystem::path& directory)
+	{
+		std::mt19937 rng(9u);
+		const Image image = MakeImage(64u, 64u, rng);
+		const TextureSettings settings = { TextureFormat::BC3, true, true };
+		TexturePipeline pipeline(pool, directory.string());
+		const Texture built = pipeline.Build(image, settings);
+		CHECK(pipeline.GetStats().cacheMisses == 1u && pipeline.GetStats().cacheHits == 0u && pipeline.GetStats().cacheWriteFailures == 0u);
+		const auto sameTexture = [&](const Texture& texture)
+		{
+			return texture.width == built.width && texture.height == built.height && texture.format == built.format &&
+				texture.srgb == built.srgb && texture.mips.size() == built.mips.size() && texture.data == built.data &&
+				std::memcmp(texture.mips.data(), built.mips.data(), built.mips.size() * sizeof(Texture::Mip)) == 0;
+		};
+		// A fresh pipeline (next run of the game) finds it
+		{
+			TexturePipeline nextRun(pool, directory.string());
+			CHECK(sameTexture(nextRun.Build(image, settings)));
+			CHECK(nextRun.GetStats().cacheHits == 1u && nextRun.GetStats().texturesBuilt == 0u);
+			// Different settings are a different entry
+			nextRun.Build(image, { TextureFormat::BC1, true, true });
+			CHECK(nextRun.GetStats().cacheMisses == 1u);
+		}
+
+		const std::filesystem::path path = directory / ([&]
+		{
+			char name[32];
+			std::snprintf(name, sizeof(name), "%016llx.etex", static_cast<unsigned long long>(TexturePipeline::ComputeKey(image, settings)));
+			return std::string(name);
+		}());
+		CHECK(std::filesystem::exists(path));
+		const std::vector<std::byte> good = ReadFile(path);
+		const auto writeFile = [&](const std::vector<std::byte>& bytes)
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		};
+		// Header fields (magic, version, key, mip count, data size) and the mip table (an offset past the end)
+		std::vector<std::vector<std::byte>> corrupt;
+		for (const std::size_t offset : { 0u, 4u, 8u, 32u, 40u, 48u + 16u })
+		{
+			std::vector<std::byte> bytes = good;
+			bytes[offset + 3u] ^= std::byte{ 0x40 };
+			corrupt.push_back(std::move(bytes));
+		}
+		// Truncated: mid data, mid mip table, mid header, empty
+		for (const std::size_t size : { good.size() - 1u, std::size_t(60u), std::size_t(20u), std::size_t(0u) })
+		{
+			corrupt.emplace_back(good.begin(), good.begin() + size);
+		}
+		// Trailing garbage
+		corrupt.push_back(good);
+		corrupt.back().push_back(std::byte{ 0 });
+		std::size_t rebuilt = 0u;
+		for (const std::vector<std::byte>& bytes : corrupt)
+		{
+			writeFile(bytes);
+			TexturePipeline pipelineAfterCorruption(pool, directory.string());
+			const Texture texture = pipelineAfterCorruption.Build(image, settings);
+			rebuilt += pipelineAfterCorruption.GetStats().cacheMisses == 1u && pipelineAfterCorruption.GetStats().texturesBuilt == 1u;
+			CHECK(sameTexture(texture));
+			// The miss rewrote a good entry
+			CHECK(ReadFile(path) == good);
+		}
+		CHECK(rebuilt == corrupt.size());
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "TexturePipelineTest";
+	std::filesystem::remove_all(directory);
+	ThreadPool pool(4u);
+	TestBlockCompression();
+	TestDecode();
+	TestMips(pool);
+	TestCache(pool, directory);
+	std::filesystem::remove_all(directory);
+	return Test::Finish("TexturePipelineTest");
+}
@@ -0,0 +1,217 @@
+// Frustum culling: the SIMD and thread pool paths must return exactly what CullSpheresScalar / CullBoxesScalar do.
+// Build as a console program together with src/Visibility.cpp and src/ThreadPool.cpp; add /arch:AVX (-mavx)
+// to check the 8-wide path, SIMDMATH_FORCE_SCALAR for the plain one.
+//
+//   VisibilityTest [--bench]
+//
+// --bench times every path on 100k and 1M objects.
+
+#include "../src/Visibility.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Scene
+	{
+		BoundingSpheres spheres;
+		BoundingBoxes boxes;
+	};
+
+	Frustum RandomFrustum(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> fov(0.3f, 2.0f);
+		const Vec3 eye(position(rng), position(rng), position(rng));
+		const Vec3 target(position(rng), position(rng), position(rng));
+		return Frustum::FromViewProjection(Mat4::LookAtLH(eye, target, { 0.0f, 1.0f, 0.0f }) *
+			Mat4::PerspectiveFovLH(fov(rng), 16.0f / 9.0f, 0.5f, 150.0f));
+	}
+
+	// An axis-aligned box [-10, 10]^3 as a frustum. Its planes are exact in float, so objects can sit exactly on them.
+	Frustum BoxFrustum()
+	{
+		Frustum frustum;
+		frustum.planes[Frustum::Left] = { 1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[Frustum::Right] = { -1.0f, 0.0f, 0.0f, 10.0f };
+		frustum.planes[Frustum::Bottom] = { 0.0f, 1.0f, 0.0f, 10.0f };
+		frustum.planes[Frustum::Top] = { 0.0f, -1.0f, 0.0f, 10.0f };
+		frustum.planes[Frustum::Near] = { 0.0f, 0.0f, 1.0f, 10.0f };
+		frustum.planes[Frustum::Far] = { 0.0f, 0.0f, -1.0f, 10.0f };
+		return frustum;
+	}
+
+	void AddRandom(Scene& scene, std::mt19937& rng, std::size_t count)
+	{
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.0f, 5.0f);
+		for (std::size_t i = 0u; i < count; i++)
+		{
+			const Vec3 center(position(rng), position(rng), position(rng));
+			const float r = size(rng);
+			scene.spheres.Add(center, r);
+			scene.boxes.Add(center - Vec3(r, r * 0.5f, r * 2.0f), center + Vec3(r, r * 0.5f, r * 2.0f));
+		}
+	}
+
+	// Objects lying on, just touching or just missing each plane, where the comparison is decided by the last bit
+	void AddOnPlanes(Scene& scene, const Frustum& frustum, std::mt19937& rng, std::size_t count)
+	{
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> size(0.0f, 3.0f);
+		std::uniform_int_distribution<int> nudge(-2, 2);
+		for (std::size_t i = 0u; i < count; i++)
+		{
+			const Vec4& plane = frustum.planes[i % 6u];
+			const Vec3 normal = plane.Xyz();
+			const Vec3 p(position(rng), position(rng), position(rng));
+			const float r = i % 7u == 0u ? 0.0f : size(rng);
+			// Project onto the plane, then push out so the surface touches it, give or take an ulp or two
+			float offset = -r;
+			for (int step = nudge(rng); step != 0; step += step > 0 ? -1 : 1)
+			{
+				offset = std::nextafter(offset, step > 0 ? 1e30f : -1e30f);
+			}
+			const Vec3 center = p - normal * (normal.Dot(p) + plane.w) + normal * offset;
+			scene.spheres.Add(center, r);
+			// A cube of the same half size reaches at least r along any normal, so it's never culled where the sphere isn't
+			const Vec3 half(r, r, r);
+			scene.boxes.Add(center - half, center + half);
+		}
+	}
+
+	bool Compare(ThreadPool& pool, const Frustum& frustum, const Scene& scene, std::size_t& visibleSpheres, std::size_t& visibleBoxes)
+	{
+		const std::size_t count = scene.spheres.Size();
+		std::vector<std::uint32_t> reference(count);
+		std::vector<std::uint32_t> simd(count);
+		std::vector<std::uint32_t> parallel(count);
+		const auto same = [&](std::size_t a, std::size_t b, std::size_t c)
+		{
+			return a == b && a == c && std::equal(reference.begin(), reference.begin() + a, simd.begin()) &&
+				std::equal(reference.begin(), reference.begin() + a, parallel.begin());
+		};
+		visibleSpheres = CullSpheresScalar(frustum, scene.spheres, reference.data());
+		bool matches = same(visibleSpheres, CullSpheres(frustum, scene.spheres, simd.data()), CullSpheres(pool, frustum, scene.spheres, parallel.data()));
+		visibleBoxes = CullBoxesScalar(frustum, scene.boxes, reference.data());
+		matches &= same(visibleBoxes, CullBoxes(frustum, scene.boxes, simd.data()), CullBoxes(pool, frustum, scene.boxes, parallel.data()));
+		return matches;
+	}
+
+	void TestRandomScenes(ThreadPool& pool)
+	{
+		std::mt19937 rng(34u);
+		std::size_t tested = 0u;
+		std::size_t visible = 0u;
+		// Odd sizes for the SIMD tails, and a few big enough to be split over the pool
+		for (const std::size_t count : { 0u, 1u, 3u, 7u, 8u, 9u, 31u, 1000u, 16385u, 100003u })
+		{
+			for (int trial = 0; trial < 4; trial++)
+			{
+				const Frustum frustum = RandomFrustum(rng);
+				Scene scene;
+				AddRandom(scene, rng, count - count / 4u);
+				AddOnPlanes(scene, frustum, rng, count / 4u);
+				std::size_t visibleSpheres = 0u;
+				std::size_t visibleBoxes = 0u;
+				CHECK(Compare(pool, frustum, scene, visibleSpheres, visibleBoxes));
+				visible += visibleSpheres + visibleBoxes;
+				tested += count * 2u;
+			}
+		}
+		std::printf("random scenes: %zu objects culled, %zu visible\n", tested, visible);
+		// Neither everything nor nothing, or the comparison doesn't say much
+		CHECK(visible > tested / 100u && visible < tested / 2u);
+	}
+
+	void TestExactPlanes(ThreadPool& pool)
+	{
+		const Frustum frustum = BoxFrustum();
+		Scene scene;
+		// Touching from outside counts as visible, a hair further out doesn't
+		scene.spheres.Add({ -12.0f, 0.0f, 0.0f }, 2.0f);
+		scene.spheres.Add({ 0.0f, 0.0f, 12.0f }, 2.0f);
+		scene.spheres.Add({ 0.0f, std::nextafter(-12.0f, -100.0f), 0.0f }, 2.0f);
+		scene.spheres.Add({ 0.0f, 0.0f, std::nextafter(12.0f, 100.0f) }, 2.0f);
+		// Points exactly on a plane, and on an edge and corner
+		scene.spheres.Add({ 10.0f, 0.0f, 0.0f }, 0.0f);
+		scene.spheres.Add({ 10.0f, -10.0f, 0.0f }, 0.0f);
+		scene.spheres.Add({ 10.0f, 10.0f, -10.0f }, 0.0f);
+		scene.spheres.Add({ std::nextafter(10.0f, 100.0f), 0.0f, 0.0f }, 0.0f);
+		scene.boxes.Add({ -14.0f, -1.0f, -1.0f }, { -10.0f, 1.0f, 1.0f });
+		scene.boxes.Add({ -1.0f, -1.0f, 10.0f }, { 1.0f, 1.0f, 14.0f });
+		scene.boxes.Add({ -1.0f, std::nextafter(-14.0f, -100.0f), -1.0f }, { 1.0f, std::nextafter(-10.0f, -100.0f), 1.0f });
+		scene.boxes.Add({ -1.0f, -1.0f, 11.0f }, { 1.0f, 1.0f, 12.0f });
+		scene.boxes.Add({ 10.0f, 0.0f, 0.0f }, { 10.0f, 0.0f, 0.0f });
+		scene.boxes.Add({ 10.0f, -10.0f, 0.0f }, { 10.0f, -10.0f, 0.0f });
+		scene.boxes.Add({ 10.0f, 10.0f, -10.0f }, { 10.0f, 10.0f, -10.0f });
+		scene.boxes.Add({ 11.0f, 0.0f, 0.0f }, { 11.0f, 0.0f, 0.0f });
+		std::size_t visibleSpheres = 0u;
+		std::size_t visibleBoxes = 0u;
+		CHECK(Compare(pool, frustum, scene, visibleSpheres, visibleBoxes));
+		std::uint32_t visible[8];
+		CHECK(CullSpheres(frustum, scene.spheres, visible) == 5u);
+		CHECK(visible[0] == 0u && visible[1] == 1u && visible[2] == 4u && visible[3] == 5u && visible[4] == 6u);
+		CHECK(CullBoxes(frustum, scene.boxes, visible) == 5u);
+		CHECK(visible[0] == 0u && visible[1] == 1u && visible[2] == 4u && visible[3] == 5u && visible[4] == 6u);
+
+		// Same thing a few hundred times over, so every object lands in every SIMD lane and the tails
+		Scene repeated;
+		for (int copy = 0; copy < 333; copy++)
+		{
+			for (std::uint32_t i = 0u; i < 8u; i++)
+			{
+				repeated.spheres.Add({ scene.spheres.GetX()[i], scene.spheres.GetY()[i], scene.spheres.GetZ()[i] }, scene.spheres.GetRadius()[i]);
+				const Vec3 center(scene.boxes.GetX()[i], scene.boxes.GetY()[i], scene.boxes.GetZ()[i]);
+				const Vec3 extent(scene.boxes.GetExtentX()[i], scene.boxes.GetExtentY()[i], scene.boxes.GetExtentZ()[i]);
+				repeated.boxes.Add(center - extent, center + extent);
+			}
+			// Shift the pattern by one lane each copy
+			repeated.spheres.Add({ 0.0f, 0.0f, 0.0f }, 1.0f);
+			repeated.boxes.Add({ -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f });
+		}
+		CHECK(Compare(pool, frustum, repeated, visibleSpheres, visibleBoxes));
+		CHECK(visibleSpheres == 333u * 6u && visibleBoxes == 333u * 6u);
+	}
+
+	void Benchmark(ThreadPool& pool)
+	{
+		std::mt19937 rng(99u);
+		const Frustum frustum = RandomFrustum(rng);
+		for (const std::size_t count : { 100000u, 1000000u })
+		{
+			Scene scene;
+			scene.spheres.Reserve(count);
+			scene.boxes.Reserve(count);
+			AddRandom(scene, rng, count);
+			std::vector<std::uint32_t> visible(count);
+			const auto time = [&](auto&& cull)
+			{
+				return Test::BestOfMs(10, [&] { cull(visible.data()); });
+			};
+			const double spheresScalar = time([&](std::uint32_t* p) { CullSpheresScalar(frustum, scene.spheres, p); });
+			const double spheresSimd = time([&](std::uint32_t* p) { CullSpheres(frustum, scene.spheres, p); });
+			const double spheresParallel = time([&](std::uint32_t* p) { CullSpheres(pool, frustum, scene.spheres, p); });
+			const double boxesScalar = time([&](std::uint32_t* p) { CullBoxesScalar(frustum, scene.boxes, p); });
+			const double boxesSimd = time([&](std::uint32_t* p) { CullBoxes(frustum, scene.boxes, p); });
+			const double boxesParallel = time([&](std::uint32_t* p) { CullBoxes(pool, frustum, scene.boxes, p); });
+			std::printf("%7zu spheres: scalar %7.3f ms  simd %7.3f ms  parallel %7.3f ms\n", count, spheresScalar, spheresSimd, spheresParallel);
+			std::printf("%7zu boxes:   scalar %7.3f ms  simd %7.3f ms  parallel %7.3f ms\n", count, boxesScalar, boxesSimd, boxesParallel);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ThreadPool pool;
+	TestExactPlanes(pool);
+	TestRandomScenes(pool);
+	if (Test::HasFlag(argc, argv, "--bench"))
+	{
+		Benchmark(pool);
+	}
+	return Test::Finish("VisibilityTest");
+}